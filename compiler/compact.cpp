@@ -0,0 +1,193 @@
+#include "compact.h"
+
+#include <limits>
+#include <unordered_set>
+
+#include "../instructions/bytecode.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::bytecode;
+using namespace oops_bcode_compiler::compiler;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    //Bits an instruction word may have set and still fit one unit: the opcode and the low bytes of dest, src1 and src2
+    constexpr std::uint64_t unit_bits = 0xffull << 56 | 0xffull << 32 | 0xffull << 16 | 0xffull;
+    //The flags and dest fields, which hold a branch's direction and distance
+    constexpr std::uint64_t branch_bits = 0xffull << 48 | 0xffffull;
+    constexpr std::size_t lanes = sizeof(std::uint64_t) / sizeof(std::uint16_t);
+
+    bool is_branch(itype type)
+    {
+        return (type >= itype::IBGE and type <= itype::VBNEQI) or type == itype::BU;
+    }
+
+    std::size_t branch_target(std::uint64_t word, std::size_t at)
+    {
+        auto distance = static_cast<std::size_t>(word & 0xffff);
+        return (word >> 48) & 0xff ? at + 1 - distance : at + 1 + distance;
+    }
+
+    struct layout
+    {
+        //First unit of every word, then the unit count
+        std::vector<std::size_t> units;
+        //Call argument and jump table words, copied as two units without a WIDE prefix
+        std::vector<bool> data;
+        std::vector<bool> wide;
+    };
+
+    std::optional<::layout> plan(const oops_bcode_compiler::compiler::method &mtd)
+    {
+        auto &words = mtd.instructions;
+        ::layout out{std::vector<std::size_t>(words.size() + 1), std::vector<bool>(words.size()), std::vector<bool>(words.size())};
+        std::unordered_set<std::uint32_t> thunked;
+        for (auto &thk : mtd.thunks)
+        {
+            thunked.insert(thk.instruction_idx);
+        }
+        for (auto &call : mtd.calls)
+        {
+            for (std::size_t i = 1; i <= (call.argument_types.size() + ::lanes - 1) / ::lanes and call.instruction_idx + i < words.size(); i++)
+            {
+                out.data[call.instruction_idx + i] = true;
+            }
+        }
+        for (std::size_t i = 0; i < words.size(); i++)
+        {
+            if (out.data[i])
+            {
+                continue;
+            }
+            auto type = opcode(words[i]);
+            if (type == itype::BADR)
+            {
+                std::size_t entries = words[i] & 0xffff;
+                auto table = 1 + ((words[i] >> 48) & sparse_table ? entries : (entries + 1) / 2);
+                for (std::size_t j = 1; j <= table and i + j < words.size(); j++)
+                {
+                    out.data[i + j] = true;
+                }
+            }
+            //Branches start short and only grow while their distances settle below
+            auto fits = ::is_branch(type) ? ::unit_bits | ::branch_bits : ::unit_bits;
+            out.wide[i] = thunked.count(i) or words[i] & ~fits;
+        }
+        while (true)
+        {
+            std::size_t unit = 0;
+            for (std::size_t i = 0; i < words.size(); i++)
+            {
+                out.units[i] = unit;
+                unit += out.data[i] ? 2 : out.wide[i] ? 3 : 1;
+            }
+            out.units.back() = unit;
+            if (unit > std::numeric_limits<std::uint16_t>::max())
+            {
+                return {};
+            }
+            bool grew = false;
+            for (std::size_t i = 0; i < words.size(); i++)
+            {
+                if (out.data[i] or out.wide[i] or !::is_branch(opcode(words[i])))
+                {
+                    continue;
+                }
+                //A short branch has no flags byte, so it can only jump forward
+                auto target = ::branch_target(words[i], i);
+                if (target <= i or out.units[target] - out.units[i] - 1 > 0xff)
+                {
+                    out.wide[i] = true;
+                    grew = true;
+                }
+            }
+            if (!grew)
+            {
+                return out;
+            }
+        }
+    }
+} // namespace
+
+std::optional<std::size_t> oops_bcode_compiler::compiler::compact_size(const method &mtd)
+{
+    if (auto planned = ::plan(mtd))
+    {
+        return planned->units.back();
+    }
+    return {};
+}
+
+void oops_bcode_compiler::compiler::compact(method &mtd)
+{
+    auto planned = ::plan(mtd);
+    if (!planned)
+    {
+        logger.builder(logging::level::error) << "Method " << mtd.name << " does not fit the compact encoding" << logging::logbuilder::end;
+        return;
+    }
+    auto &units = planned->units;
+    auto words = mtd.instructions;
+    mtd.units.clear();
+    mtd.units.reserve(units.back());
+    for (std::size_t i = 0; i < words.size(); i++)
+    {
+        auto word = words[i];
+        auto type = opcode(word);
+        if (planned->data[i])
+        {
+            mtd.units.push_back(static_cast<std::uint32_t>(word));
+            mtd.units.push_back(static_cast<std::uint32_t>(word >> 32));
+            continue;
+        }
+        if (::is_branch(type))
+        {
+            auto target = units[::branch_target(word, i)], after = units[i] + (planned->wide[i] ? 3 : 1);
+            bool backward = target < after;
+            word = (word & ~::branch_bits) | (backward ? after - target : target - after) | static_cast<std::uint64_t>(backward) << 48;
+        }
+        else if (type == itype::BADR)
+        {
+            //Rebases the offsets in the table words, which are copied once the loop reaches them
+            auto rebase = [&](std::uint32_t offset) {
+                auto target = units[i + static_cast<std::int32_t>(offset)];
+                return static_cast<std::uint64_t>(static_cast<std::uint32_t>(static_cast<std::int32_t>(target - units[i])));
+            };
+            std::size_t entries = word & 0xffff;
+            bool sparse = (word >> 48) & sparse_table;
+            words[i + 1] = (words[i + 1] & ~0xffffffffull) | rebase(words[i + 1]);
+            for (std::size_t j = 0; j < entries; j++)
+            {
+                auto &entry = words[i + 2 + (sparse ? j : j / 2)];
+                auto shift = sparse ? 0 : j % 2 * 32;
+                entry = (entry & ~(0xffffffffull << shift)) | rebase(entry >> shift) << shift;
+            }
+        }
+        if (planned->wide[i])
+        {
+            mtd.units.push_back(static_cast<std::uint32_t>(itype::WIDE) << 24);
+            mtd.units.push_back(static_cast<std::uint32_t>(word));
+            mtd.units.push_back(static_cast<std::uint32_t>(word >> 32));
+        }
+        else
+        {
+            mtd.units.push_back(static_cast<std::uint32_t>(type) << 24 | (word >> 32 & 0xff) << 16 | (word >> 16 & 0xff) << 8 | (word & 0xff));
+        }
+    }
+    for (auto &map : mtd.stack_maps)
+    {
+        map.instruction_idx = units[map.instruction_idx];
+    }
+    for (auto &call : mtd.calls)
+    {
+        call.instruction_idx = units[call.instruction_idx];
+    }
+    for (auto &handler : mtd.handlers)
+    {
+        handler.begin = units[handler.begin];
+        handler.end = units[handler.end];
+        handler.target = units[handler.target];
+    }
+    logger.builder(logging::level::debug) << "Compacted " << mtd.name << " from " << words.size() << " words to " << mtd.units.size() << " units" << logging::logbuilder::end;
+}
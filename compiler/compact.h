@@ -0,0 +1,26 @@
+#ifndef COMPILER_COMPACT
+#define COMPILER_COMPACT
+
+#include <cstdint>
+#include <optional>
+
+#include "compiler.h"
+
+namespace oops_bcode_compiler
+{
+    namespace compiler
+    {
+        //Number of 32-bit units mtd takes in the compact encoding, or nothing if some unit offset would not fit.
+        //Words carrying a thunk are always laid out wide, so the count holds once the thunks are resolved.
+        std::optional<std::size_t> compact_size(const method &mtd);
+
+        //Fills mtd.units with the compact encoding of mtd.instructions and moves the word indexes of its stack maps,
+        //call descriptors and exception handlers to unit indexes. An instruction fits one unit when its flags are clear and
+        //dest, src1 and src2 are below 256: opcode in the top byte, then src2, src1 and dest. Any other word takes a WIDE unit
+        //followed by the word itself, low half first. Call argument and jump table words are copied as two units each.
+        //Branch distances and jump table offsets count units instead of words.
+        void compact(method &mtd);
+    } // namespace compiler
+} // namespace oops_bcode_compiler
+
+#endif /* COMPILER_COMPACT */
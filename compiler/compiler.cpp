@@ -2,14 +2,27 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <map>
 #include <numeric>
 #include <sstream>
+#include <unordered_map>
 
+#include "compact.h"
+#include "fusion.h"
+#include "native.h"
+#include "../instructions/bytecode.h"
 #include "../instructions/keywords.h"
+#include "../instructions/semantics.h"
+#include "../optimizer/dataflow.h"
+#include "../optimizer/ir.h"
+#include "../optimizer/passes.h"
 #include "../utils/hashing.h"
 #include "../utils/puns.h"
+#include "../verifier/verifier.h"
 #include "../debug/logs.h"
 
+using namespace oops_bcode_compiler::bytecode;
 using namespace oops_bcode_compiler::compiler;
 using namespace oops_bcode_compiler::debug;
 
@@ -20,269 +33,6 @@ namespace
         std::uint16_t offset;
         std::uint8_t type;
     };
-    enum class itype : unsigned char
-    {
-#pragma region DO NOT UNFOLD ME
-        //Done
-        NOP,
-        IADD,
-        LADD,
-        FADD,
-        DADD,
-        ISUB,
-        LSUB,
-        FSUB,
-        DSUB,
-        IMUL,
-        LMUL,
-        FMUL,
-        DMUL,
-        IDIV,
-        LDIV,
-        FDIV,
-        DDIV,
-        IMOD,
-        LMOD,
-        IDIVU,
-        LDIVU,
-        IADDI,
-        LADDI,
-        FADDI,
-        DADDI,
-        ISUBI,
-        LSUBI,
-        FSUBI,
-        DSUBI,
-        IMULI,
-        LMULI,
-        FMULI,
-        DMULI,
-        IDIVI,
-        LDIVI,
-        FDIVI,
-        DDIVI,
-        IMODI,
-        LMODI,
-        IDIVUI,
-        LDIVUI,
-        //TODO
-        INEG,
-        LNEG,
-        FNEG,
-        DNEG,
-        LUI,
-        LDI,
-        LNL,
-        ICSTL,
-        ICSTF,
-        ICSTD,
-        LCSTI,
-        LCSTF,
-        LCSTD,
-        FCSTI,
-        FCSTL,
-        FCSTD,
-        DCSTI,
-        DCSTL,
-        DCSTF,
-        //Done
-        IAND,
-        LAND,
-        IOR,
-        LOR,
-        IXOR,
-        LXOR,
-        ISLL,
-        LSLL,
-        ISRL,
-        LSRL,
-        ISRA,
-        LSRA,
-        IANDI,
-        LANDI,
-        IORI,
-        LORI,
-        IXORI,
-        LXORI,
-        ISLLI,
-        LSLLI,
-        ISRLI,
-        LSRLI,
-        ISRAI,
-        LSRAI,
-        IBGE,
-        LBGE,
-        FBGE,
-        DBGE,
-        IBLT,
-        LBLT,
-        FBLT,
-        DBLT,
-        IBLE,
-        LBLE,
-        FBLE,
-        DBLE,
-        IBGT,
-        LBGT,
-        FBGT,
-        DBGT,
-        IBEQ,
-        LBEQ,
-        FBEQ,
-        DBEQ,
-        VBEQ,
-        IBNEQ,
-        LBNEQ,
-        FBNEQ,
-        DBNEQ,
-        VBNEQ,
-        IBGEI,
-        LBGEI,
-        FBGEI,
-        DBGEI,
-        IBLTI,
-        LBLTI,
-        FBLTI,
-        DBLTI,
-        IBLEI,
-        LBLEI,
-        FBLEI,
-        DBLEI,
-        IBGTI,
-        LBGTI,
-        FBGTI,
-        DBGTI,
-        IBEQI,
-        LBEQI,
-        FBEQI,
-        DBEQI,
-        VBEQI,
-        IBNEQI,
-        LBNEQI,
-        FBNEQI,
-        DBNEQI,
-        VBNEQI,
-        //TODO
-        IBCMP,
-        LBCMP,
-        FBCMP,
-        DBCMP,
-        BADR,
-        BU,
-        CVLLD,
-        SVLLD,
-        IVLLD,
-        LVLLD,
-        FVLLD,
-        DVLLD,
-        VVLLD,
-        CVLSR,
-        SVLSR,
-        IVLSR,
-        LVLSR,
-        FVLSR,
-        DVLSR,
-        VVLSR,
-        CALD,
-        SALD,
-        IALD,
-        LALD,
-        FALD,
-        DALD,
-        VALD,
-        CASR,
-        SASR,
-        IASR,
-        LASR,
-        FASR,
-        DASR,
-        VASR,
-        CSTLD,
-        SSTLD,
-        ISTLD,
-        LSTLD,
-        FSTLD,
-        DSTLD,
-        VSTLD,
-        CSTSR,
-        SSTSR,
-        ISTSR,
-        LSTSR,
-        FSTSR,
-        DSTSR,
-        VSTSR,
-        VNEW,
-        //Done
-        CANEW,
-        SANEW,
-        IANEW,
-        LANEW,
-        FANEW,
-        DANEW,
-        VANEW,
-        //TODO
-        IOF,
-        VINV,
-        SINV,
-        IINV,
-        IRET,
-        LRET,
-        FRET,
-        DRET,
-        VRET,
-        EXC
-#pragma endregion
-    };
-
-    std::uint64_t construct3(itype type, std::uint8_t flags, std::uint16_t dest, std::uint16_t src1, std::uint16_t src2)
-    {
-        std::uint64_t out = 0;
-        out <<= CHAR_BIT * sizeof(type);
-        out |= static_cast<std::uint8_t>(type);
-        out <<= CHAR_BIT * sizeof(flags);
-        out |= flags;
-        out <<= CHAR_BIT * sizeof(src2);
-        out |= src2;
-        out <<= CHAR_BIT * sizeof(src1);
-        out |= src1;
-        out <<= CHAR_BIT * sizeof(dest);
-        out |= dest;
-        return out;
-    }
-    std::uint64_t construct24(itype type, std::uint16_t dest, std::uint16_t src1, std::uint32_t imm24)
-    {
-        std::uint64_t out = 0;
-        out <<= CHAR_BIT * sizeof(type);
-        out |= static_cast<std::uint8_t>(type);
-        out <<= CHAR_BIT * (sizeof(imm24) - sizeof(type));
-        out |= imm24;
-        out <<= sizeof(src1);
-        out |= src1;
-        out <<= sizeof(dest);
-        out |= dest;
-        return out;
-    }
-    std::uint64_t construct32(itype type, std::uint8_t flags, std::uint16_t dest, std::uint32_t imm32)
-    {
-        std::uint64_t out = 0;
-        out <<= CHAR_BIT * sizeof(type);
-        out |= static_cast<std::uint8_t>(type);
-        out <<= CHAR_BIT * sizeof(flags);
-        out |= static_cast<std::uint8_t>(flags);
-        out <<= CHAR_BIT * sizeof(imm32);
-        out |= imm32;
-        out <<= CHAR_BIT * sizeof(dest);
-        out |= dest;
-        return out;
-    }
-    std::uint64_t construct40(itype type, std::uint16_t dest, std::uint64_t imm40)
-    {
-        imm40 |= static_cast<std::uint64_t>(type) << 40;
-        imm40 <<= CHAR_BIT * sizeof(dest);
-        imm40 |= dest;
-        return imm40;
-    }
-
     std::variant<std::int32_t, std::string> parse_int(const std::string &str)
     {
 #define pfail return "'" + str + "' could not be parsed as an integer"
@@ -469,41 +219,176 @@ namespace
         return std::get<std::string>(parsed);
     }
 
+    //Whether instr has an int immediate too large for its imm24 or imm16 field, which is then loaded into the
+    //scratch slot so the register form of the instruction can be emitted instead
+    bool wide_immediate(const oops_bcode_compiler::optimizer::instruction &instr)
+    {
+        if (instr.operands.size() < 3 or !std::holds_alternative<std::int32_t>(::parse_int(instr.operands[2])))
+        {
+            return false;
+        }
+        switch (instr.itype)
+        {
+        case oops_bcode_compiler::keywords::keyword::ADDI:
+        case oops_bcode_compiler::keywords::keyword::SUBI:
+        case oops_bcode_compiler::keywords::keyword::MULI:
+        case oops_bcode_compiler::keywords::keyword::DIVI:
+        case oops_bcode_compiler::keywords::keyword::MODI:
+        case oops_bcode_compiler::keywords::keyword::DIVUI:
+        case oops_bcode_compiler::keywords::keyword::ANDI:
+        case oops_bcode_compiler::keywords::keyword::ORI:
+        case oops_bcode_compiler::keywords::keyword::XORI:
+        case oops_bcode_compiler::keywords::keyword::SLLI:
+        case oops_bcode_compiler::keywords::keyword::SRLI:
+        case oops_bcode_compiler::keywords::keyword::SRAI:
+            return std::holds_alternative<std::string>(::to24(instr.operands[2]));
+        case oops_bcode_compiler::keywords::keyword::BEQI:
+        case oops_bcode_compiler::keywords::keyword::BNEQI:
+        case oops_bcode_compiler::keywords::keyword::BLTI:
+        case oops_bcode_compiler::keywords::keyword::BGTI:
+        case oops_bcode_compiler::keywords::keyword::BLEI:
+        case oops_bcode_compiler::keywords::keyword::BGEI:
+            return std::holds_alternative<std::string>(::to16(instr.operands[2]));
+        default:
+            return false;
+        }
+    }
+
     constexpr std::uint8_t cast_types(std::uint8_t src, std::uint8_t dest)
     {
         return src * 16 + dest;
     }
 
+    //Whether a slot of this type code takes 8 bytes
+    bool wide(std::uint8_t type)
+    {
+        return type == 3 or type == 5 or (type == 6 and sizeof(char *) > sizeof(std::int32_t));
+    }
+
     std::size_t round_off(std::size_t in, std::size_t align)
     {
         return (in + align - 1) & ~(align - 1);
     }
+
+    std::uint8_t access_flags(const oops_bcode_compiler::optimizer::instruction &instr)
+    {
+        return (instr.proven_nonnull ? oops_bcode_compiler::bytecode::unchecked_null : 0) | (instr.proven_in_bounds ? oops_bcode_compiler::bytecode::unchecked_bounds : 0);
+    }
+
+    //Whether the call at body[call] runs nothing but the RET of its destination afterwards, following labels and unconditional branches
+    bool in_tail_position(const std::vector<oops_bcode_compiler::optimizer::instruction> &body, std::size_t call)
+    {
+        auto &dest = body[call].operands[0];
+        auto idx = call + 1;
+        //Bounds the walk in case the branches form a cycle
+        for (std::size_t steps = 0; idx < body.size() and steps < body.size(); steps++)
+        {
+            switch (body[idx].itype)
+            {
+            case oops_bcode_compiler::keywords::keyword::LBL:
+            case oops_bcode_compiler::keywords::keyword::DEF:
+            case oops_bcode_compiler::keywords::keyword::NOP:
+                idx++;
+                break;
+            case oops_bcode_compiler::keywords::keyword::BU:
+            {
+                auto &target = body[idx].operands[0];
+                idx = std::find_if(body.begin(), body.end(), [&target](const oops_bcode_compiler::optimizer::instruction &instr) { return instr.itype == oops_bcode_compiler::keywords::keyword::LBL and instr.operands[0] == target; }) - body.begin();
+                break;
+            }
+            case oops_bcode_compiler::keywords::keyword::RET:
+                return body[idx].operands[0] == dest;
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    struct jump_table
+    {
+        //Sorted by key
+        std::vector<std::pair<std::int32_t, std::string>> cases;
+        bool sparse;
+        //One per case in a sparse table, one per key from the smallest case to the largest in a dense one
+        std::size_t entries;
+
+        //Words after the BADR word itself
+        std::size_t words() const
+        {
+            return 1 + (this->sparse ? this->entries : (this->entries + 1) / 2);
+        }
+    };
+
+    //Sorts the cases of a BADR and picks its encoding
+    std::variant<::jump_table, std::string> build_jump_table(const oops_bcode_compiler::optimizer::instruction &instr)
+    {
+        ::jump_table table;
+        for (std::size_t i = 2; i + 1 < instr.operands.size(); i += 2)
+        {
+            auto key = ::parse_int(instr.operands[i]);
+            if (std::holds_alternative<std::string>(key))
+            {
+                return std::get<std::string>(key);
+            }
+            table.cases.emplace_back(std::get<std::int32_t>(key), instr.operands[i + 1]);
+        }
+        if (table.cases.empty())
+        {
+            return "Jump table has no cases";
+        }
+        std::stable_sort(table.cases.begin(), table.cases.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+        if (auto twice = std::adjacent_find(table.cases.begin(), table.cases.end(), [](const auto &a, const auto &b) { return a.first == b.first; }); twice != table.cases.end())
+        {
+            return "Case " + std::to_string(twice->first) + " appears twice in jump table";
+        }
+        //A dense table takes half a word per key in its range and a sparse one a word per case, so the smaller wins
+        auto span = static_cast<std::int64_t>(table.cases.back().first) - table.cases.front().first + 1;
+        table.sparse = span > 2 * static_cast<std::int64_t>(table.cases.size());
+        table.entries = table.sparse ? table.cases.size() : span;
+        if (table.entries > std::numeric_limits<std::uint16_t>::max())
+        {
+            return "Jump table has more than " + std::to_string(std::numeric_limits<std::uint16_t>::max()) + " entries";
+        }
+        return table;
+    }
 } // namespace
 
 constexpr static std::uint8_t static_method_type = 5, virtual_method_type = 4;
 
-std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::compile(oops_bcode_compiler::parsing::cls::procedure &proc)
+std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::compile(oops_bcode_compiler::optimizer::function &fn, const options &options)
 {
     static const std::unordered_map<std::string, std::uint8_t> type_map = {{"int", 2}, {"long", 3}, {"float", 4}, {"double", 5}, {"ref", 6}};
     std::vector<std::string> errors;
+    oops_bcode_compiler::optimizer::optimize(fn, options);
+    std::vector<double> frequencies;
+    auto body = oops_bcode_compiler::optimizer::linearize(fn, &frequencies);
 #define compile_error(error, line, col)                                                       \
     std::stringstream error_builder;                                                          \
     error_builder << error << " at line " << line << ", column " << col;                      \
     logger.builder(logging::level::debug) << error_builder.str() << logging::logbuilder::end; \
     errors.push_back(error_builder.str())
-    method mtd;
-    mtd.name = proc.name;
-    mtd.method_type = proc.is_static ? static_method_type : virtual_method_type;
-    if (auto type = type_map.find(proc.return_type_name); type != type_map.end())
+    method mtd{};
+    mtd.name = fn.name;
+    mtd.method_type = fn.is_static ? static_method_type : virtual_method_type;
+    if (auto type = type_map.find(fn.return_type_name); type != type_map.end())
     {
         mtd.return_type = type->second;
     }
     else
     {
-        compile_error("Invalid return type " << proc.return_type_name, proc.line_number, proc.column_number);
+        compile_error("Invalid return type " << fn.return_type_name, fn.line_number, fn.column_number);
     }
+    mtd.aligned_frame = options.align_frame;
+    //In an aligned frame every 8-byte slot, arguments included, starts at an even 32-bit offset
+    auto align_wide = [&](std::uint8_t type) {
+        if (mtd.aligned_frame and ::wide(type) and mtd.stack_size % 2)
+        {
+            mtd.stack_size++;
+        }
+    };
     std::unordered_map<std::string, var> local_variables;
-    for (auto &param : proc.parameters)
+    for (auto &param : fn.parameters)
     {
         if (local_variables.find(param.name) != local_variables.end())
         {
@@ -512,6 +397,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         }
         if (auto type = type_map.find(param.host_name); type != type_map.end())
         {
+            align_wide(type->second);
             local_variables[param.name] = {mtd.stack_size, type->second};
             mtd.arg_types.push_back(type->second);
             switch (type->second)
@@ -538,6 +424,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         else
         {
             mtd.arg_types.push_back(6);
+            align_wide(6);
             mtd.handle_map.push_back(mtd.stack_size);
             local_variables[param.name] = {mtd.stack_size, 6};
             mtd.stack_size += sizeof(char *) / sizeof(std::int32_t);
@@ -556,50 +443,84 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
     logger.builder(logging::level::debug) << "Stack offset of " #name " " << instr.operands[off] << " (argument " << std::to_string(static_cast<int>(off)) << ") is " << name##_it->second.offset << " and has type " << name##_it->second.type << " (Source line & col " << instr.line_number << ", " << instr.column_number << "), called from " << __LINE__ << logging::logbuilder::end; \
     auto name = name##_it->second
 #pragma endregion
-    unsigned instr_count;
-    typedef keywords::keyword ktype;
-    for (auto &instr : proc.instructions)
+    //Locals are laid out before the body is walked, so an aligned frame can put the 8-byte slots first
+    std::vector<const oops_bcode_compiler::optimizer::instruction *> definitions;
+    for (auto &instr : body)
     {
-        switch (instr.itype)
+        if (instr.itype == keywords::keyword::DEF)
         {
-        case ktype::DEF:
+            definitions.push_back(&instr);
+        }
+    }
+    if (mtd.aligned_frame)
+    {
+        auto is_wide = [&](const oops_bcode_compiler::optimizer::instruction *def) {
+            auto type = type_map.find(def->operands[0]);
+            return type != type_map.end() and ::wide(type->second);
+        };
+        std::stable_partition(definitions.begin(), definitions.end(), is_wide);
+        //One 4-byte local fills the hole an odd run of arguments leaves, instead of padding
+        if (auto narrow = std::find_if_not(definitions.begin(), definitions.end(), is_wide); mtd.stack_size % 2 and narrow != definitions.end())
         {
-            if (local_variables.find(instr.operands[1]) != local_variables.end())
+            std::rotate(definitions.begin(), narrow, narrow + 1);
+        }
+    }
+    for (auto definition : definitions)
+    {
+        auto &instr = *definition;
+        if (local_variables.find(instr.operands[1]) != local_variables.end())
+        {
+            compile_error("Redefining local variable " << instr.operands[1], instr.line_number, instr.column_number);
+            continue;
+        }
+        if (auto type = type_map.find(instr.operands[0]); type != type_map.end())
+        {
+            align_wide(type->second);
+            local_variables[instr.operands[1]] = {mtd.stack_size, type->second};
+            mtd.local_types.emplace_back(mtd.stack_size, type->second);
+            switch (type->second)
             {
-                compile_error("Redefining local variable " << instr.operands[1], instr.line_number, instr.column_number);
-                continue;
-            }
-            if (auto type = type_map.find(instr.operands[0]); type != type_map.end())
+            case 2:
+                mtd.stack_size += sizeof(std::int32_t) / sizeof(std::int32_t);
+                break;
+            case 3:
+                mtd.stack_size += sizeof(std::int64_t) / sizeof(std::int32_t);
+                break;
+            case 4:
+                mtd.stack_size += sizeof(float) / sizeof(std::int32_t);
+                break;
+            case 5:
+                mtd.stack_size += sizeof(double) / sizeof(std::int32_t);
+                break;
+            case 6:
             {
-                local_variables[instr.operands[1]] = {mtd.stack_size, type->second};
-                switch (type->second)
-                {
-                case 2:
-                    mtd.stack_size += sizeof(std::int32_t) / sizeof(std::int32_t);
-                    break;
-                case 3:
-                    mtd.stack_size += sizeof(std::int64_t) / sizeof(std::int32_t);
-                    break;
-                case 4:
-                    mtd.stack_size += sizeof(float) / sizeof(std::int32_t);
-                    break;
-                case 5:
-                    mtd.stack_size += sizeof(double) / sizeof(std::int32_t);
-                    break;
-                case 6:
-                {
-                    mtd.handle_map.push_back(mtd.stack_size);
-                    mtd.stack_size += sizeof(char *) / sizeof(std::int32_t);
-                    break;
-                }
-                }
+                mtd.handle_map.push_back(mtd.stack_size);
+                mtd.stack_size += sizeof(char *) / sizeof(std::int32_t);
+                break;
             }
-            else
-            {
-                compile_error("Invalid type " << instr.operands[0], instr.line_number, instr.column_number);
             }
-            break;
         }
+        else
+        {
+            compile_error("Invalid type " << instr.operands[0], instr.line_number, instr.column_number);
+        }
+    }
+    //One slot wide enough for any type holds the immediates too large for their field
+    std::uint16_t scratch = 0;
+    if (std::any_of(body.begin(), body.end(), ::wide_immediate))
+    {
+        align_wide(3);
+        scratch = mtd.stack_size;
+        mtd.stack_size += sizeof(std::int64_t) / sizeof(std::int32_t);
+    }
+    unsigned instr_count = 0;
+    typedef keywords::keyword ktype;
+    for (auto &instr : body)
+    {
+        switch (instr.itype)
+        {
+        case ktype::DEF:
+            break;
         case ktype::LBL:
         {
             if (labels.find(instr.operands[0]) != labels.end())
@@ -612,13 +533,24 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         }
         case ktype::SINV:
         {
-            instr_count += 1 + (instr.operands.size() - 1 + sizeof(std::uint64_t) / sizeof(std::uint16_t) - 1) / (sizeof(std::uint64_t) / sizeof(std::uint16_t));
+            instr_count += 1 + (instr.operands.size() - 2 + sizeof(std::uint64_t) / sizeof(std::uint16_t) - 1) / (sizeof(std::uint64_t) / sizeof(std::uint16_t));
             break;
         }
         case ktype::IINV:
         case ktype::VINV:
         {
-            instr_count += 1 + (instr.operands.size() - 2 + sizeof(std::uint64_t) / sizeof(std::uint16_t) - 1) / (sizeof(std::uint64_t) / sizeof(std::uint16_t));
+            instr_count += 1 + (instr.operands.size() - 3 + sizeof(std::uint64_t) / sizeof(std::uint16_t) - 1) / (sizeof(std::uint64_t) / sizeof(std::uint16_t));
+            break;
+        }
+        case ktype::BADR:
+        {
+            auto table = ::build_jump_table(instr);
+            if (std::holds_alternative<std::string>(table))
+            {
+                compile_error(std::get<std::string>(table), instr.line_number, instr.column_number);
+                continue;
+            }
+            instr_count += 1 + std::get<::jump_table>(table).words();
             break;
         }
         case ktype::LI:
@@ -713,8 +645,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
                     {
                         continue;
                     }
-                    std::string out;
-                    out.reserve(sizeof(std::int32_t));
+                    std::string out(sizeof(std::int32_t), '\0');
                     utils::pun_write(&out[0], imm);
                     instr.operands[1] = out;
                     instr_count++;
@@ -730,8 +661,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
                     }
                     else
                     {
-                        std::string out;
-                        out.reserve(sizeof(std::int32_t));
+                        std::string out(sizeof(std::int32_t), '\0');
                         utils::pun_write(&out[0], std::get<std::int32_t>(parsed));
                         instr.operands[1] = out;
                     }
@@ -749,17 +679,16 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
                 }
                 else
                 {
-                    std::string out;
-                    out.reserve(sizeof(std::int64_t));
+                    std::string out(sizeof(std::int64_t), '\0');
                     utils::pun_write(&out[0], std::get<std::int64_t>(parsed));
                     instr.operands[1] = out;
-                    instr_count += 1 + (std::get<std::int64_t>(parsed) << (sizeof(std::uint64_t) - sizeof(std::uint16_t) - sizeof(std::uint8_t)) * CHAR_BIT);
+                    instr_count++;
                 }
                 break;
             }
             case 4:
             {
-                auto parsed = ::parse_float(instr.operands[2]);
+                auto parsed = ::parse_float(instr.operands[1]);
                 if (std::holds_alternative<std::string>(parsed))
                 {
                     compile_error("Error compiling float immediate: " << std::get<std::string>(parsed), instr.line_number, instr.column_number);
@@ -767,8 +696,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
                 }
                 else
                 {
-                    std::string out;
-                    out.reserve(sizeof(float));
+                    std::string out(sizeof(float), '\0');
                     utils::pun_write(&out[0], std::get<float>(parsed));
                     instr.operands[1] = out;
                 }
@@ -777,7 +705,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             }
             case 5:
             {
-                auto parsed = ::parse_double(instr.operands[2]);
+                auto parsed = ::parse_double(instr.operands[1]);
                 if (std::holds_alternative<std::string>(parsed))
                 {
                     compile_error("Error compiling double immediate: " << std::get<std::string>(parsed), instr.line_number, instr.column_number);
@@ -785,13 +713,11 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
                 }
                 else
                 {
-                    std::string out;
-                    out.reserve(sizeof(double));
+                    std::string out(sizeof(double), '\0');
                     utils::pun_write(&out[0], std::get<double>(parsed));
                     instr.operands[1] = out;
-                    instr_count += 1 + (utils::pun_reinterpret<std::uint64_t>(std::get<double>(parsed)) << (sizeof(double) - sizeof(std::uint16_t) - sizeof(std::uint8_t)) * CHAR_BIT);
+                    instr_count++;
                 }
-                instr_count++;
                 break;
             }
             case 6:
@@ -808,10 +734,85 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             break;
         }
         default:
-            instr_count++;
+            instr_count += 1 + ::wide_immediate(instr);
             break;
         }
     }
+    for (auto &handler : fn.handlers)
+    {
+        auto begin = labels.find(handler.begin), end = labels.find(handler.end), target = labels.find(handler.target);
+        auto local = local_variables.find(handler.local);
+        if (begin == labels.end() or end == labels.end() or target == labels.end())
+        {
+            compile_error("Undefined label in handler for " << handler.class_name, handler.line_number, handler.column_number);
+            continue;
+        }
+        if (local == local_variables.end() or local->second.type != 6)
+        {
+            compile_error("Handler for " << handler.class_name << " catches into " << handler.local << ", which is not a ref local", handler.line_number, handler.column_number);
+            continue;
+        }
+        if (begin->second >= end->second)
+        {
+            compile_error("Handler for " << handler.class_name << " protects no instructions between " << handler.begin << " and " << handler.end, handler.line_number, handler.column_number);
+            continue;
+        }
+        mtd.handlers.push_back({begin->second, end->second, target->second, local->second.offset, handler.class_name});
+    }
+    //Each class, member or constant the body names is split and interned once, however many instructions refer to it.
+    //The thunk patches the next instruction pushed.
+    std::map<std::pair<thunk_type, std::string>, std::uint32_t> symbol_indexes;
+    auto refer = [&](thunk_type type, const std::string &qualified, location where) {
+        auto [interned, added] = symbol_indexes.emplace(std::make_pair(type, qualified), mtd.symbols.size());
+        if (added)
+        {
+            switch (type)
+            {
+            case thunk_type::CLASS:
+                mtd.symbols.push_back({type, qualified, ""});
+                break;
+            case thunk_type::CONSTANT:
+                mtd.symbols.push_back({type, "", qualified});
+                break;
+            default:
+            {
+                //Method names may contain dots in their signature, so the class ends at the last dot before it
+                auto cls_split = qualified.find_last_of('.', type == thunk_type::METHOD ? qualified.find_first_of('(') : std::string::npos);
+                mtd.symbols.push_back({type, qualified.substr(0, cls_split), qualified.substr(cls_split + 1)});
+                break;
+            }
+            }
+        }
+        mtd.thunks.push_back({static_cast<std::uint32_t>(mtd.instructions.size()), where, interned->second});
+    };
+    //The pool is shared by every method of the class, so LDC gets its index from a thunk
+    auto load_constant = [&](std::uint16_t slot, std::uint64_t bits) {
+        std::string raw(sizeof(bits), '\0');
+        utils::pun_write(&raw[0], bits);
+        refer(thunk_type::CONSTANT, raw, location::IMM32);
+        mtd.instructions.push_back(::construct32(::itype::LDC, 0, slot, 0));
+    };
+    //Loads imm into the scratch slot as an instruction on type would read it from its immediate field
+    auto load_immediate = [&](std::uint8_t type, std::int32_t imm) {
+        switch (type)
+        {
+        case 2:
+            mtd.instructions.push_back(::construct32(::itype::LDI, 0, scratch, imm));
+            break;
+        case 3:
+            load_constant(scratch, static_cast<std::int64_t>(imm));
+            break;
+        case 4:
+            mtd.instructions.push_back(::construct32(::itype::LDI, 0, scratch, utils::pun_reinterpret<std::int32_t>(static_cast<float>(imm))));
+            break;
+        case 5:
+            load_constant(scratch, utils::pun_reinterpret<std::int64_t>(static_cast<double>(imm)));
+            break;
+        }
+    };
+    auto protected_word = [&](std::size_t word) {
+        return std::any_of(mtd.handlers.begin(), mtd.handlers.end(), [word](const exception_handler &handler) { return word >= handler.begin and word < handler.end; });
+    };
 #pragma region
 
 #define match_types(var1, var2)                                                                                                                                      \
@@ -820,13 +821,51 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         compile_error("Expected " #var1 " (" << var1.type << ") and " #var2 " (" << var2.type << ") to have the same type", instr.line_number, instr.column_number); \
     }
 #pragma endregion
-    for (auto &instr : proc.instructions)
+    //GC roots are the ref slots live at each safepoint, as bits over handle_map
+    auto live = oops_bcode_compiler::optimizer::compute_liveness(body, fn.handlers);
+    std::unordered_map<std::uint16_t, std::size_t> handle_indexes;
+    for (std::size_t i = 0; i < mtd.handle_map.size(); i++)
     {
+        handle_indexes[mtd.handle_map[i]] = i;
+    }
+    auto record_safepoint = [&](std::size_t word, const oops_bcode_compiler::optimizer::variable_set &roots, const std::string &skipped) {
+        stack_map map{static_cast<std::uint32_t>(word), std::vector<std::uint16_t>((mtd.handle_map.size() + 15) / 16)};
+        for (auto &name : roots)
+        {
+            auto slot = local_variables.find(name);
+            if (name == skipped or slot == local_variables.end() or slot->second.type != 6)
+            {
+                continue;
+            }
+            auto idx = handle_indexes[slot->second.offset];
+            map.live_handles[idx / 16] |= 1u << (idx % 16);
+        }
+        mtd.stack_maps.push_back(std::move(map));
+    };
+    std::vector<std::uint32_t> instruction_starts;
+    //Profiled executions of each instruction start; every instruction counts once without a profile
+    std::vector<std::uint64_t> execution_counts;
+    for (std::size_t body_idx = 0; body_idx < body.size(); body_idx++)
+    {
+        auto &instr = body[body_idx];
+        auto word = mtd.instructions.size();
+        if (instruction_starts.empty() or instruction_starts.back() != mtd.instructions.size())
+        {
+            instruction_starts.push_back(mtd.instructions.size());
+            execution_counts.push_back(fn.profile ? std::llround(frequencies[body_idx] * fn.profile->invocations) : 1);
+        }
         logger.builder(logging::level::debug) << "Instruction " << keywords::keyword_to_string[static_cast<unsigned>(instr.itype)] << logging::logbuilder::end;
         for (auto &operand : instr.operands)
         {
             logger.builder(logging::level::debug) << "Operand " << operand << logging::logbuilder::end;
         }
+        //The RET stays behind the tail invoke, both as a branch target and for VMs that run it as a plain invoke
+        //A tail call would drop this frame, and with it any handler protecting the call
+        bool tail_call = options.optimization_level > 0 and keywords::is_call(instr.itype) and ::in_tail_position(body, body_idx) and !protected_word(word);
+        if (tail_call)
+        {
+            logger.builder(logging::level::debug) << "Tail call at line " << instr.line_number << logging::logbuilder::end;
+        }
         switch (instr.itype)
         {
 #pragma region
@@ -868,23 +907,32 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
 #pragma region
 
 #define lookup_imm24                                                                                                            \
+    bool wide_imm = ::wide_immediate(instr);                                                                                    \
     auto imm24_var = ::to24(instr.operands[2]);                                                                                 \
-    if (std::holds_alternative<std::string>(imm24_var))                                                                         \
+    if (!wide_imm and std::holds_alternative<std::string>(imm24_var))                                                           \
     {                                                                                                                           \
         compile_error("Error parsing immediate: " << std::get<std::string>(imm24_var), instr.line_number, instr.column_number); \
         continue;                                                                                                               \
     }                                                                                                                           \
-    std::int32_t imm24 = std::get<std::int32_t>(imm24_var)
+    std::int32_t imm24 = wide_imm ? std::get<std::int32_t>(::parse_int(instr.operands[2])) : std::get<std::int32_t>(imm24_var)
 #pragma endregion
 #pragma region
 
-#define pinsti(type, letter, keyword)                                                                         \
-    case type:                                                                                                \
-        mtd.instructions.push_back(::construct24(::itype::letter##keyword, dest.offset, src1.offset, imm24)); \
+#define pinsti(type, letter, keyword, reg)                                                                        \
+    case type:                                                                                                    \
+        if (wide_imm)                                                                                             \
+        {                                                                                                         \
+            load_immediate(type, imm24);                                                                          \
+            mtd.instructions.push_back(::construct3(::itype::letter##reg, 0, dest.offset, src1.offset, scratch)); \
+        }                                                                                                         \
+        else                                                                                                      \
+        {                                                                                                         \
+            mtd.instructions.push_back(::construct24(::itype::letter##keyword, dest.offset, src1.offset, imm24)); \
+        }                                                                                                         \
         break
 #pragma endregion
 #pragma region
-#define pkeyi(keyword)                                                                                                                              \
+#define pkeyi(keyword, reg)                                                                                                                         \
     case ktype::keyword:                                                                                                                            \
     {                                                                                                                                               \
         lookup_variable(dest, 0);                                                                                                                   \
@@ -893,10 +941,10 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         lookup_imm24;                                                                                                                               \
         switch (dest.type)                                                                                                                          \
         {                                                                                                                                           \
-            pinsti(2, I, keyword);                                                                                                                  \
-            pinsti(3, L, keyword);                                                                                                                  \
-            pinsti(4, F, keyword);                                                                                                                  \
-            pinsti(5, D, keyword);                                                                                                                  \
+            pinsti(2, I, keyword, reg);                                                                                                             \
+            pinsti(3, L, keyword, reg);                                                                                                             \
+            pinsti(4, F, keyword, reg);                                                                                                             \
+            pinsti(5, D, keyword, reg);                                                                                                             \
         default:                                                                                                                                    \
         {                                                                                                                                           \
             compile_error("Operands of type " << dest.type << " cannot be used for instruction " #keyword, instr.line_number, instr.column_number); \
@@ -906,10 +954,10 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         break;                                                                                                                                      \
     }
 #pragma endregion
-            pkeyi(ADDI);
-            pkeyi(SUBI);
-            pkeyi(MULI);
-            pkeyi(DIVI);
+            pkeyi(ADDI, ADD);
+            pkeyi(SUBI, SUB);
+            pkeyi(MULI, MUL);
+            pkeyi(DIVI, DIV);
 #pragma region
 
 #define ikey(keyword)                                                                                                                               \
@@ -943,7 +991,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             ikey(SRA);
 #pragma region
 
-#define ikeyi(keyword)                                                                                                                              \
+#define ikeyi(keyword, reg)                                                                                                                         \
     case ktype::keyword:                                                                                                                            \
     {                                                                                                                                               \
         lookup_variable(dest, 0);                                                                                                                   \
@@ -952,8 +1000,8 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         lookup_imm24;                                                                                                                               \
         switch (dest.type)                                                                                                                          \
         {                                                                                                                                           \
-            pinsti(2, I, keyword);                                                                                                                  \
-            pinsti(3, L, keyword);                                                                                                                  \
+            pinsti(2, I, keyword, reg);                                                                                                             \
+            pinsti(3, L, keyword, reg);                                                                                                             \
         default:                                                                                                                                    \
         {                                                                                                                                           \
             compile_error("Operands of type " << dest.type << " cannot be used for instruction " #keyword, instr.line_number, instr.column_number); \
@@ -963,14 +1011,14 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         break;                                                                                                                                      \
     }
 #pragma endregion
-            ikeyi(MODI);
-            ikeyi(DIVUI);
-            ikeyi(ANDI);
-            ikeyi(ORI);
-            ikeyi(XORI);
-            ikeyi(SLLI);
-            ikeyi(SRLI);
-            ikeyi(SRAI);
+            ikeyi(MODI, MOD);
+            ikeyi(DIVUI, DIVU);
+            ikeyi(ANDI, AND);
+            ikeyi(ORI, OR);
+            ikeyi(XORI, XOR);
+            ikeyi(SLLI, SLL);
+            ikeyi(SRLI, SRL);
+            ikeyi(SRAI, SRA);
         case ktype::NEG:
         {
             lookup_variable(dest, 0);
@@ -1011,11 +1059,14 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             case 5:
             {
                 std::uint64_t imm = utils::pun_read<std::int64_t>(instr.operands[1].c_str());
-                mtd.instructions.push_back(::construct40(::itype::LUI, dest.offset, imm >> (sizeof(std::uint64_t) - sizeof(std::uint16_t) - sizeof(std::uint8_t)) * CHAR_BIT));
-                imm <<= (sizeof(std::uint64_t) - sizeof(std::uint16_t) - sizeof(std::uint8_t)) * CHAR_BIT;
-                if (imm)
+                //LUI alone covers constants with clear low 24 bits; the rest take one pool load instead of LUI and LADDI
+                if (imm & 0xffffff)
                 {
-                    mtd.instructions.push_back(::construct24(::itype::LADDI, dest.offset, dest.offset, imm >> (sizeof(std::uint64_t) - sizeof(std::uint16_t) - sizeof(std::uint8_t)) * CHAR_BIT));
+                    load_constant(dest.offset, imm);
+                }
+                else
+                {
+                    mtd.instructions.push_back(::construct40(::itype::LUI, dest.offset, imm >> 24));
                 }
                 break;
             }
@@ -1058,6 +1109,15 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             }
             break;
         }
+        case ktype::MOV:
+        {
+            lookup_variable(dest, 0);
+            lookup_variable(src1, 1);
+            match_types(dest, src1);
+            //There is no move opcode, so OR the raw bits of a one or two slot value with zero
+            mtd.instructions.push_back(::construct24(dest.type == 2 or dest.type == 4 ? ::itype::IORI : ::itype::LORI, dest.offset, src1.offset, 0));
+            break;
+        }
         case ktype::RCVT:
         {
             lookup_variable(dest, 0);
@@ -1124,43 +1184,62 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             bop(BGT);
             bop(BLE);
             bop(BGE);
-#define binsti(type, letter, keyword)                                                                                     \
-    case type:                                                                                                            \
-        mtd.instructions.push_back(::construct3(::itype::letter##keyword, dest > 0, std::abs(dest), src1.offset, imm16)); \
+#define binsti(type, letter, keyword, reg)                                                                                          \
+    case type:                                                                                                                      \
+        if (wide_imm)                                                                                                               \
+        {                                                                                                                           \
+            load_immediate(type, imm16);                                                                                            \
+            word = mtd.instructions.size();                                                                                         \
+            mtd.instructions.push_back(::construct3(::itype::letter##reg, dest + 1 > 0, std::abs(dest + 1), src1.offset, scratch)); \
+        }                                                                                                                           \
+        else                                                                                                                        \
+        {                                                                                                                           \
+            mtd.instructions.push_back(::construct3(::itype::letter##keyword, dest > 0, std::abs(dest), src1.offset, imm16));       \
+        }                                                                                                                           \
         break
-#define parse_imm16                                                                              \
-    auto imm16_var = ::to16(instr.operands[2]);                                                  \
-    if (std::holds_alternative<std::string>(imm16_var))                                          \
-    {                                                                                            \
-        compile_error("Error parsing 16 bit immediate", instr.line_number, instr.column_number); \
-        continue;                                                                                \
-    }                                                                                            \
-    auto imm16 = std::get<std::int16_t>(imm16_var);
-#define beopi(keyword)                                                                                                                                                                \
-    case ktype::keyword:                                                                                                                                                              \
-    {                                                                                                                                                                                 \
-        lookup_variable(src1, 1);                                                                                                                                                     \
-        lookup_label;                                                                                                                                                                 \
-        if (src1.type != 6)                                                                                                                                                           \
-        {                                                                                                                                                                             \
-            parse_imm16;                                                                                                                                                              \
-            mtd.instructions.push_back(::construct3(static_cast<::itype>(static_cast<unsigned>(::itype::I##keyword) + src1.type - 2), dest > 0, std::abs(dest), src1.offset, imm16)); \
-            break;                                                                                                                                                                    \
-        }                                                                                                                                                                             \
-        else                                                                                                                                                                          \
-        {                                                                                                                                                                             \
-            if (instr.operands[2] != "null")                                                                                                                                          \
-            {                                                                                                                                                                         \
-                compile_error("Equals immediates may only be null!", instr.line_number, instr.column_number);                                                                         \
-                continue;                                                                                                                                                             \
-            }                                                                                                                                                                         \
-            mtd.instructions.push_back(::construct3(::itype::V##keyword, dest > 0, std::abs(dest), src1.offset, 0));                                                                  \
-            break;                                                                                                                                                                    \
-        }                                                                                                                                                                             \
+#define parse_imm16                                                                                                             \
+    bool wide_imm = ::wide_immediate(instr);                                                                                    \
+    auto imm16_var = ::to16(instr.operands[2]);                                                                                 \
+    if (!wide_imm and std::holds_alternative<std::string>(imm16_var))                                                           \
+    {                                                                                                                           \
+        compile_error("Error parsing 16 bit immediate", instr.line_number, instr.column_number);                                \
+        continue;                                                                                                               \
+    }                                                                                                                           \
+    std::int32_t imm16 = wide_imm ? std::get<std::int32_t>(::parse_int(instr.operands[2])) : std::get<std::int16_t>(imm16_var);
+#define beopi(keyword, reg)                                                                                                                                                                     \
+    case ktype::keyword:                                                                                                                                                                        \
+    {                                                                                                                                                                                           \
+        lookup_variable(src1, 1);                                                                                                                                                               \
+        lookup_label;                                                                                                                                                                           \
+        if (src1.type != 6)                                                                                                                                                                     \
+        {                                                                                                                                                                                       \
+            parse_imm16;                                                                                                                                                                        \
+            if (wide_imm)                                                                                                                                                                       \
+            {                                                                                                                                                                                   \
+                load_immediate(src1.type, imm16);                                                                                                                                               \
+                word = mtd.instructions.size();                                                                                                                                                 \
+                mtd.instructions.push_back(::construct3(static_cast<::itype>(static_cast<unsigned>(::itype::I##reg) + src1.type - 2), dest + 1 > 0, std::abs(dest + 1), src1.offset, scratch)); \
+            }                                                                                                                                                                                   \
+            else                                                                                                                                                                                \
+            {                                                                                                                                                                                   \
+                mtd.instructions.push_back(::construct3(static_cast<::itype>(static_cast<unsigned>(::itype::I##keyword) + src1.type - 2), dest > 0, std::abs(dest), src1.offset, imm16));       \
+            }                                                                                                                                                                                   \
+            break;                                                                                                                                                                              \
+        }                                                                                                                                                                                       \
+        else                                                                                                                                                                                    \
+        {                                                                                                                                                                                       \
+            if (instr.operands[2] != "null")                                                                                                                                                    \
+            {                                                                                                                                                                                   \
+                compile_error("Equals immediates may only be null!", instr.line_number, instr.column_number);                                                                                   \
+                continue;                                                                                                                                                                       \
+            }                                                                                                                                                                                   \
+            mtd.instructions.push_back(::construct3(::itype::V##keyword, dest > 0, std::abs(dest), src1.offset, 0));                                                                            \
+            break;                                                                                                                                                                              \
+        }                                                                                                                                                                                       \
     }
-            beopi(BEQI);
-            beopi(BNEQI);
-#define bopi(keyword)                                                                                                                                                                                          \
+            beopi(BEQI, BEQ);
+            beopi(BNEQI, BNEQ);
+#define bopi(keyword, reg)                                                                                                                                                                                     \
     case ktype::keyword:                                                                                                                                                                                       \
     {                                                                                                                                                                                                          \
         lookup_variable(src1, 1);                                                                                                                                                                              \
@@ -1168,10 +1247,10 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         lookup_label;                                                                                                                                                                                          \
         switch (src1.type)                                                                                                                                                                                     \
         {                                                                                                                                                                                                      \
-            binsti(2, I, keyword);                                                                                                                                                                             \
-            binsti(3, L, keyword);                                                                                                                                                                             \
-            binsti(4, F, keyword);                                                                                                                                                                             \
-            binsti(5, D, keyword);                                                                                                                                                                             \
+            binsti(2, I, keyword, reg);                                                                                                                                                                        \
+            binsti(3, L, keyword, reg);                                                                                                                                                                        \
+            binsti(4, F, keyword, reg);                                                                                                                                                                        \
+            binsti(5, D, keyword, reg);                                                                                                                                                                        \
         default:                                                                                                                                                                                               \
         {                                                                                                                                                                                                      \
             compile_error("Cannot perform comparison operation " << keywords::keyword_to_string[static_cast<unsigned>(instr.itype)] << " on operands of object type", instr.line_number, instr.column_number); \
@@ -1180,10 +1259,10 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         }                                                                                                                                                                                                      \
         break;                                                                                                                                                                                                 \
     }
-            bopi(BLTI);
-            bopi(BGTI);
-            bopi(BLEI);
-            bopi(BGEI);
+            bopi(BLTI, BLT);
+            bopi(BGTI, BGT);
+            bopi(BLEI, BLE);
+            bopi(BGEI, BGE);
         case ktype::BU:
         {
             lookup_label;
@@ -1238,7 +1317,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             require_type(2, dest, instr.operands[0]);
             require_type(6, src1, instr.operands[1]);
             require_type(2, src2, instr.operands[2]);
-            mtd.instructions.push_back(::construct3(::itype::CALD, 0, dest.offset, src1.offset, src2.offset));
+            mtd.instructions.push_back(::construct3(::itype::CALD, ::access_flags(instr), dest.offset, src1.offset, src2.offset));
             break;
         }
         case ktype::SALD:
@@ -1249,7 +1328,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             require_type(2, dest, instr.operands[0]);
             require_type(6, src1, instr.operands[1]);
             require_type(2, src2, instr.operands[2]);
-            mtd.instructions.push_back(::construct3(::itype::SALD, 0, dest.offset, src1.offset, src2.offset));
+            mtd.instructions.push_back(::construct3(::itype::SALD, ::access_flags(instr), dest.offset, src1.offset, src2.offset));
             break;
         }
         case ktype::ALD:
@@ -1259,7 +1338,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(src2, 2);
             require_type(6, src1, instr.operands[1]);
             require_type(2, src2, instr.operands[2]);
-            mtd.instructions.push_back(::construct3(static_cast<::itype>(static_cast<unsigned>(::itype::CALD) + dest.type), 0, dest.offset, src1.offset, src2.offset));
+            mtd.instructions.push_back(::construct3(static_cast<::itype>(static_cast<unsigned>(::itype::CALD) + dest.type), ::access_flags(instr), dest.offset, src1.offset, src2.offset));
             break;
         }
         case ktype::CASR:
@@ -1270,7 +1349,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             require_type(6, dest, instr.operands[0]);
             require_type(2, src1, instr.operands[1]);
             require_type(2, src2, instr.operands[2]);
-            mtd.instructions.push_back(::construct3(::itype::CASR, 0, dest.offset, src1.offset, src2.offset));
+            mtd.instructions.push_back(::construct3(::itype::CASR, ::access_flags(instr), dest.offset, src1.offset, src2.offset));
             break;
         }
         case ktype::SASR:
@@ -1281,7 +1360,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             require_type(6, dest, instr.operands[0]);
             require_type(2, src1, instr.operands[1]);
             require_type(2, src2, instr.operands[2]);
-            mtd.instructions.push_back(::construct3(::itype::SASR, 0, dest.offset, src1.offset, src2.offset));
+            mtd.instructions.push_back(::construct3(::itype::SASR, ::access_flags(instr), dest.offset, src1.offset, src2.offset));
             break;
         }
         case ktype::ASR:
@@ -1291,7 +1370,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(src2, 2);
             require_type(6, dest, instr.operands[0]);
             require_type(2, src2, instr.operands[2]);
-            mtd.instructions.push_back(::construct3(static_cast<::itype>(static_cast<unsigned>(::itype::CASR) + src1.type), 0, dest.offset, src1.offset, src2.offset));
+            mtd.instructions.push_back(::construct3(static_cast<::itype>(static_cast<unsigned>(::itype::CASR) + src1.type), ::access_flags(instr), dest.offset, src1.offset, src2.offset));
             break;
         }
         case ktype::RET:
@@ -1301,6 +1380,17 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             mtd.instructions.push_back(::construct3(static_cast<::itype>(static_cast<unsigned>(::itype::IRET) + src1.type - 2), 0, 0, src1.offset, 0));
             break;
         }
+        case ktype::CNT:
+        {
+            auto parsed = ::parse_int(instr.operands[0]);
+            if (!options.instrument or !std::holds_alternative<std::int32_t>(parsed) or std::get<std::int32_t>(parsed) < 0 or static_cast<std::size_t>(std::get<std::int32_t>(parsed)) >= fn.counters.size())
+            {
+                compile_error("CNT is reserved for instrumented builds", instr.line_number, instr.column_number);
+                continue;
+            }
+            mtd.instructions.push_back(::construct32(::itype::CNT, 0, 0, std::get<std::int32_t>(parsed)));
+            break;
+        }
         case ktype::NOP:
         {
             mtd.instructions.push_back(::construct40(::itype::NOP, 0, 0));
@@ -1312,7 +1402,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(src1, 1);
             require_type(2, dest, instr.operands[0]);
             require_type(6, src1, instr.operands[1]);
-            mtd.thunks.push_back({instr.operands[2], static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[2], location::IMM24, thunk_type::CLASS});
+            refer(thunk_type::CLASS, instr.operands[2], location::IMM24);
             mtd.instructions.push_back(::construct24(::itype::IOF, dest.offset, src1.offset, 0));
             break;
         }
@@ -1320,8 +1410,8 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         {
             lookup_variable(dest, 0);
             require_type(6, dest, instr.operands[0]);
-            mtd.thunks.push_back({instr.operands[1], static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[1], location::IMM24, thunk_type::CLASS});
-            mtd.instructions.push_back(::construct24(::itype::VNEW, dest.offset, 0, 0));
+            refer(thunk_type::CLASS, instr.operands[1], location::IMM24);
+            mtd.instructions.push_back(::construct24(instr.no_escape ? ::itype::VNEWF : ::itype::VNEW, dest.offset, 0, 0));
             break;
         }
         case ktype::CVLLD:
@@ -1330,7 +1420,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(src1, 1);
             require_type(2, dest, instr.operands[0]);
             require_type(6, src1, instr.operands[1]);
-            mtd.thunks.push_back({instr.operands[2].substr(instr.operands[2].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[2].substr(0, instr.operands[2].find_last_of('.')), location::IMM24, thunk_type::IVAR});
+            refer(thunk_type::IVAR, instr.operands[2], location::IMM24);
             mtd.instructions.push_back(::construct24(::itype::CVLLD, dest.offset, src1.offset, 0));
             break;
         }
@@ -1340,7 +1430,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(src1, 1);
             require_type(2, dest, instr.operands[0]);
             require_type(6, src1, instr.operands[1]);
-            mtd.thunks.push_back({instr.operands[2].substr(instr.operands[2].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[2].substr(0, instr.operands[2].find_last_of('.')), location::IMM24, thunk_type::IVAR});
+            refer(thunk_type::IVAR, instr.operands[2], location::IMM24);
             mtd.instructions.push_back(::construct24(::itype::SVLLD, dest.offset, src1.offset, 0));
             break;
         }
@@ -1349,7 +1439,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(dest, 0);
             lookup_variable(src1, 1);
             require_type(6, src1, instr.operands[1]);
-            mtd.thunks.push_back({instr.operands[2].substr(instr.operands[2].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[2].substr(0, instr.operands[2].find_last_of('.')), location::IMM24, thunk_type::IVAR});
+            refer(thunk_type::IVAR, instr.operands[2], location::IMM24);
             mtd.instructions.push_back(::construct24(static_cast<::itype>(static_cast<unsigned>(::itype::CVLLD) + dest.type), dest.offset, src1.offset, 0));
             break;
         }
@@ -1359,7 +1449,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(src1, 1);
             require_type(6, dest, instr.operands[0]);
             require_type(2, src1, instr.operands[1]);
-            mtd.thunks.push_back({instr.operands[2].substr(instr.operands[2].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[2].substr(0, instr.operands[2].find_last_of('.')), location::IMM24, thunk_type::IVAR});
+            refer(thunk_type::IVAR, instr.operands[2], location::IMM24);
             mtd.instructions.push_back(::construct24(::itype::CVLSR, dest.offset, src1.offset, 0));
             break;
         }
@@ -1369,7 +1459,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(src1, 1);
             require_type(6, dest, instr.operands[0]);
             require_type(2, src1, instr.operands[1]);
-            mtd.thunks.push_back({instr.operands[2].substr(instr.operands[2].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[2].substr(0, instr.operands[2].find_last_of('.')), location::IMM24, thunk_type::IVAR});
+            refer(thunk_type::IVAR, instr.operands[2], location::IMM24);
             mtd.instructions.push_back(::construct24(::itype::SVLSR, dest.offset, src1.offset, 0));
             break;
         }
@@ -1378,7 +1468,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(dest, 0);
             lookup_variable(src1, 1);
             require_type(6, dest, instr.operands[0]);
-            mtd.thunks.push_back({instr.operands[2].substr(instr.operands[2].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[2].substr(0, instr.operands[2].find_last_of('.')), location::IMM24, thunk_type::IVAR});
+            refer(thunk_type::IVAR, instr.operands[2], location::IMM24);
             mtd.instructions.push_back(::construct24(static_cast<::itype>(static_cast<unsigned>(::itype::CVLSR) + src1.type), dest.offset, src1.offset, 0));
             break;
         }
@@ -1386,7 +1476,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         {
             lookup_variable(dest, 0);
             require_type(2, dest, instr.operands[0]);
-            mtd.thunks.push_back({instr.operands[1].substr(instr.operands[1].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[1].substr(0, instr.operands[1].find_last_of('.')), location::IMM32, thunk_type::SVAR});
+            refer(thunk_type::SVAR, instr.operands[1], location::IMM32);
             mtd.instructions.push_back(::construct32(::itype::CSTLD, 0, dest.offset, 0));
             break;
         }
@@ -1394,14 +1484,14 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         {
             lookup_variable(dest, 0);
             require_type(2, dest, instr.operands[0]);
-            mtd.thunks.push_back({instr.operands[1].substr(instr.operands[1].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[1].substr(0, instr.operands[1].find_last_of('.')), location::IMM32, thunk_type::SVAR});
+            refer(thunk_type::SVAR, instr.operands[1], location::IMM32);
             mtd.instructions.push_back(::construct32(::itype::SSTLD, 0, dest.offset, 0));
             break;
         }
         case ktype::STLD:
         {
             lookup_variable(dest, 0);
-            mtd.thunks.push_back({instr.operands[1].substr(instr.operands[1].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[1].substr(0, instr.operands[1].find_last_of('.')), location::IMM32, thunk_type::SVAR});
+            refer(thunk_type::SVAR, instr.operands[1], location::IMM32);
             mtd.instructions.push_back(::construct32(static_cast<::itype>(static_cast<unsigned>(::itype::CSTLD) + dest.type), 0, dest.offset, 0));
             break;
         }
@@ -1409,7 +1499,7 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         {
             lookup_variable(dest, 0);
             require_type(2, dest, instr.operands[0]);
-            mtd.thunks.push_back({instr.operands[1].substr(instr.operands[1].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[1].substr(0, instr.operands[1].find_last_of('.')), location::IMM32, thunk_type::SVAR});
+            refer(thunk_type::SVAR, instr.operands[1], location::IMM32);
             mtd.instructions.push_back(::construct32(::itype::CSTSR, 0, dest.offset, 0));
             break;
         }
@@ -1417,22 +1507,23 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
         {
             lookup_variable(dest, 0);
             require_type(2, dest, instr.operands[0]);
-            mtd.thunks.push_back({instr.operands[1].substr(instr.operands[1].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[1].substr(0, instr.operands[1].find_last_of('.')), location::IMM32, thunk_type::SVAR});
+            refer(thunk_type::SVAR, instr.operands[1], location::IMM32);
             mtd.instructions.push_back(::construct32(::itype::SSTSR, 0, dest.offset, 0));
             break;
         }
         case ktype::STSR:
         {
             lookup_variable(dest, 0);
-            mtd.thunks.push_back({instr.operands[1].substr(instr.operands[1].find_last_of('.') + 1), static_cast<std::uint16_t>(mtd.instructions.size()), instr.operands[1].substr(0, instr.operands[1].find_last_of('.')), location::IMM32, thunk_type::SVAR});
+            refer(thunk_type::SVAR, instr.operands[1], location::IMM32);
             mtd.instructions.push_back(::construct32(static_cast<::itype>(static_cast<unsigned>(::itype::CSTSR) + dest.type), 0, dest.offset, 0));
             break;
         }
-#define load_args                                                                                                     \
+#define load_args(first)                                                                                              \
     std::uint64_t arg_builder = 0;                                                                                    \
-    for (unsigned i = 0; i < instr.operands.size() - 2; i++)                                                          \
+    for (unsigned i = 0; i < instr.operands.size() - first; i++)                                                      \
     {                                                                                                                 \
-        lookup_variable(arg, i + 2);                                                                                  \
+        lookup_variable(arg, i + first);                                                                              \
+        call.argument_types.push_back(arg.type);                                                                      \
         arg_builder |= static_cast<std::uint64_t>(arg.offset) << (i % 4 * CHAR_BIT * sizeof(std::uint16_t));          \
         if (i % (sizeof(std::uint64_t) / sizeof(std::uint16_t)) == sizeof(std::uint64_t) / sizeof(std::uint16_t) - 1) \
         {                                                                                                             \
@@ -1440,18 +1531,19 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             arg_builder = 0;                                                                                          \
         }                                                                                                             \
     }                                                                                                                 \
-    if (instr.operands.size() % (sizeof(std::uint64_t) / sizeof(std::uint16_t)) != 2)                                 \
+    if ((instr.operands.size() - first) % (sizeof(std::uint64_t) / sizeof(std::uint16_t)) != 0)                        \
     {                                                                                                                 \
         mtd.instructions.push_back(arg_builder);                                                                      \
-    }
+    }                                                                                                                 \
+    mtd.calls.push_back(std::move(call))
         case ktype::SINV:
         {
             lookup_variable(dest, 0);
             auto &name = instr.operands[1];
-            auto cls_split = name.find_last_of('.', name.find_first_of('('));
-            mtd.thunks.push_back({name.substr(cls_split + 1), static_cast<std::uint16_t>(mtd.instructions.size()), name.substr(0, cls_split), location::IMM32, thunk_type::METHOD});
-            mtd.instructions.push_back(::construct32(::itype::SINV, 0, dest.offset, 0));
-            load_args;
+            refer(thunk_type::METHOD, name, location::IMM32);
+            call_descriptor call{static_cast<std::uint32_t>(mtd.instructions.size()), dest.type, {}};
+            mtd.instructions.push_back(::construct32(tail_call ? ::itype::TSINV : ::itype::SINV, 0, dest.offset, 0));
+            load_args(2);
             break;
         }
         case ktype::IINV:
@@ -1459,10 +1551,10 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(dest, 0);
             lookup_variable(src1, 1);
             auto &name = instr.operands[2];
-            auto cls_split = name.find_last_of('.', name.find_first_of('('));
-            mtd.thunks.push_back({name.substr(cls_split + 1), static_cast<std::uint16_t>(mtd.instructions.size()), name.substr(0, cls_split), location::IMM24, thunk_type::METHOD});
-            mtd.instructions.push_back(::construct24(::itype::IINV, dest.offset, src1.offset, 0));
-            load_args;
+            refer(thunk_type::METHOD, name, location::IMM24);
+            call_descriptor call{static_cast<std::uint32_t>(mtd.instructions.size()), dest.type, {}};
+            mtd.instructions.push_back(::construct24(tail_call ? ::itype::TIINV : ::itype::IINV, dest.offset, src1.offset, 0));
+            load_args(3);
             break;
         }
         case ktype::VINV:
@@ -1470,18 +1562,82 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             lookup_variable(dest, 0);
             lookup_variable(src1, 1);
             auto &name = instr.operands[2];
-            auto cls_split = name.find_last_of('.', name.find_first_of('('));
-            mtd.thunks.push_back({name.substr(cls_split + 1), static_cast<std::uint16_t>(mtd.instructions.size()), name.substr(0, cls_split), location::IMM24, thunk_type::METHOD});
-            mtd.instructions.push_back(::construct24(::itype::VINV, dest.offset, src1.offset, 0));
-            load_args;
+            refer(thunk_type::METHOD, name, location::IMM24);
+            call_descriptor call{static_cast<std::uint32_t>(mtd.instructions.size()), dest.type, {}};
+            if (instr.devirtualized)
+            {
+                mtd.instructions.push_back(::construct24(tail_call ? ::itype::TDINV : ::itype::DINV, dest.offset, src1.offset, 0));
+            }
+            else
+            {
+                mtd.instructions.push_back(::construct24(tail_call ? ::itype::TVINV : ::itype::VINV, dest.offset, src1.offset, 0));
+            }
+            load_args(3);
             break;
         }
         case ktype::LBL:
         case ktype::DEF:
             break;
-        case ktype::BCMP:
         case ktype::BADR:
+        {
+            lookup_variable(src1, 0);
+            require_type(2, src1, instr.operands[0]);
+            //Problems with the cases were reported while counting words
+            auto built = ::build_jump_table(instr);
+            if (std::holds_alternative<std::string>(built))
+            {
+                continue;
+            }
+            auto &table = std::get<::jump_table>(built);
+            std::unordered_map<std::string, std::uint32_t> offsets;
+            bool undefined = false;
+            for (auto idx : keywords::label_operands(instr.itype, instr.operands.size()))
+            {
+                auto target = labels.find(instr.operands[idx]);
+                if (target == labels.end())
+                {
+                    compile_error("Undefined label " << instr.operands[idx], instr.line_number, instr.column_number);
+                    undefined = true;
+                    break;
+                }
+                offsets[instr.operands[idx]] = static_cast<std::uint32_t>(static_cast<std::int64_t>(target->second) - static_cast<std::int64_t>(mtd.instructions.size()));
+            }
+            if (undefined)
+            {
+                continue;
+            }
+            auto fallback = offsets[instr.operands[1]];
+            mtd.instructions.push_back(::construct3(::itype::BADR, table.sparse ? bytecode::sparse_table : 0, table.entries, src1.offset, 0));
+            if (table.sparse)
+            {
+                mtd.instructions.push_back(fallback);
+                for (auto &[key, label] : table.cases)
+                {
+                    mtd.instructions.push_back(static_cast<std::uint64_t>(static_cast<std::uint32_t>(key)) << 32 | offsets[label]);
+                }
+                break;
+            }
+            auto low = table.cases.front().first;
+            mtd.instructions.push_back(static_cast<std::uint64_t>(static_cast<std::uint32_t>(low)) << 32 | fallback);
+            std::vector<std::uint32_t> dense(table.entries, fallback);
+            for (auto &[key, label] : table.cases)
+            {
+                dense[static_cast<std::int64_t>(key) - low] = offsets[label];
+            }
+            for (std::size_t i = 0; i < dense.size(); i += 2)
+            {
+                mtd.instructions.push_back(dense[i] | (i + 1 < dense.size() ? static_cast<std::uint64_t>(dense[i + 1]) << 32 : 0));
+            }
+            break;
+        }
         case ktype::EXC:
+        {
+            lookup_variable(src1, 0);
+            require_type(6, src1, instr.operands[0]);
+            mtd.instructions.push_back(::construct3(::itype::EXC, 0, 0, src1.offset, 0));
+            break;
+        }
+        case ktype::BCMP:
         {
             compile_error("Instruction type " << keywords::keyword_to_string[static_cast<unsigned>(instr.itype)] << " is not supported yet!", instr.line_number, instr.column_number);
             continue;
@@ -1499,12 +1655,107 @@ std::variant<method, std::vector<std::string>> oops_bcode_compiler::compiler::co
             continue;
         }
         }
+        if (mtd.handle_map.empty())
+        {
+            continue;
+        }
+        //Calls and allocations can collect before their destination is written, so it is never a root there
+        if (keywords::is_call(instr.itype) or instr.itype == ktype::VNEW or instr.itype == ktype::ANEW)
+        {
+            record_safepoint(word, live.live_out[body_idx], instr.operands[0]);
+        }
+        else if (auto targets = keywords::label_operands(instr.itype, instr.operands.size()); std::any_of(targets.begin(), targets.end(), [&](std::size_t idx) { auto target = labels.find(instr.operands[idx]); return target != labels.end() and target->second <= word; }))
+        {
+            record_safepoint(word, live.live_in[body_idx], "");
+        }
+    }
+    if (!instruction_starts.empty() and instruction_starts.back() == mtd.instructions.size())
+    {
+        instruction_starts.pop_back();
+        execution_counts.pop_back();
+    }
+    std::vector<std::uint32_t> branch_targets;
+    std::transform(labels.begin(), labels.end(), std::back_inserter(branch_targets), [](const auto &label) { return label.second; });
+    if (options.pair_histogram)
+    {
+        compiler::record_instruction_pairs(mtd, instruction_starts, execution_counts, branch_targets);
+    }
+    if (options.fuse_superinstructions and options.optimization_level > 0)
+    {
+        compiler::fuse_superinstructions(mtd, instruction_starts, branch_targets);
+    }
+    //A failure here is a compiler bug rather than a user error, so the method is still written, just without the verified bit
+    if (errors.empty())
+    {
+        if (auto problems = verifier::verify(mtd); problems.empty())
+        {
+            mtd.verified = true;
+        }
+        else
+        {
+            for (auto &problem : problems)
+            {
+                logger.builder(logging::level::warning) << "Verification failed: " << problem << logging::logbuilder::end;
+            }
+        }
     }
     mtd.size = sizeof(char *);
     mtd.size += sizeof(std::uint16_t) * 4;
     mtd.size += ::round_off(mtd.arg_types.size(), CHAR_BIT * sizeof(std::uint64_t) / 4) / (sizeof(std::uint64_t) * CHAR_BIT / 4) * sizeof(std::uint64_t);
-    mtd.size += mtd.instructions.size() * sizeof(std::uint64_t);
+    mtd.compact = false;
+    if (options.compact_encoding)
+    {
+        if (auto units = compiler::compact_size(mtd))
+        {
+            mtd.compact = true;
+            mtd.size += ::round_off(*units * sizeof(std::uint32_t), sizeof(std::uint64_t));
+        }
+        else
+        {
+            logger.builder(logging::level::debug) << "Method " << fn.name << " is too long for the compact encoding" << logging::logbuilder::end;
+        }
+    }
+    if (!mtd.compact)
+    {
+        mtd.size += mtd.instructions.size() * sizeof(std::uint64_t);
+    }
+    //Records and native code mirror words one to one, so a compact body has neither
+    mtd.predecoded = options.predecode and !mtd.compact;
+    if (options.emit_native and !mtd.compact)
+    {
+        mtd.native = compiler::emit_native(mtd);
+    }
     mtd.size += sizeof(char *);
     mtd.size += ::round_off(mtd.handle_map.size() + 1, sizeof(std::uint64_t) / sizeof(std::uint16_t)) / (sizeof(std::uint64_t) / sizeof(std::uint16_t)) * sizeof(std::uint64_t);
+    mtd.counters = fn.counters;
+    if (!mtd.counters.empty())
+    {
+        mtd.size += sizeof(std::uint64_t) * (mtd.counters.size() + 1);
+    }
+    if (!mtd.stack_maps.empty())
+    {
+        //A count word, then per safepoint a u16 delta from the previous safepoint's word index and the live bits
+        mtd.size += sizeof(std::uint64_t);
+        mtd.size += ::round_off(mtd.stack_maps.size() * (1 + mtd.stack_maps[0].live_handles.size()), sizeof(std::uint64_t) / sizeof(std::uint16_t)) / (sizeof(std::uint64_t) / sizeof(std::uint16_t)) * sizeof(std::uint64_t);
+    }
+    if (!mtd.handlers.empty())
+    {
+        //A count word, then two words per handler
+        mtd.size += sizeof(std::uint64_t) * (1 + mtd.handlers.size() * 2);
+    }
+    if (mtd.verified)
+    {
+        //The verification hash after the header, then a count word and the call descriptors
+        mtd.size += sizeof(std::uint64_t) * 2;
+        for (auto &call : mtd.calls)
+        {
+            mtd.size += sizeof(std::uint64_t) + ::round_off(call.argument_types.size(), CHAR_BIT * sizeof(std::uint64_t) / 4) / (CHAR_BIT * sizeof(std::uint64_t) / 4) * sizeof(std::uint64_t);
+        }
+    }
+    if (mtd.predecoded)
+    {
+        //A count word, then two words per record
+        mtd.size += sizeof(std::uint64_t) * (1 + mtd.instructions.size() * 2);
+    }
     return mtd;
 }
\ No newline at end of file
@@ -2,9 +2,14 @@
 #define COMPILER_COMPILER
 
 #include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include "options.h"
+#include "../optimizer/ir.h"
 #include "../parser/parser.h"
 
 namespace oops_bcode_compiler
@@ -16,7 +21,9 @@ namespace oops_bcode_compiler
             CLASS,
             METHOD,
             SVAR,
-            IVAR
+            IVAR,
+            //Resolved to an index in the class constant pool
+            CONSTANT
         };
 
         enum class location
@@ -28,29 +35,103 @@ namespace oops_bcode_compiler
             IMM32
         };
 
-        struct thunk
+        //A class, member or constant the method refers to, resolved once per class however many instructions name it
+        struct symbol
         {
+            thunk_type type;
+            //The class itself for CLASS, the declaring class for members, empty for constants
+            std::string class_name;
+            //The member name, or the 8 raw bytes of a constant; empty for CLASS
             std::string name;
+
+            bool operator<(const symbol &other) const
+            {
+                return std::tie(this->type, this->class_name, this->name) < std::tie(other.type, other.class_name, other.name);
+            }
+        };
+
+        //Patches the index symbols[symbol] resolves to into one instruction word
+        struct thunk
+        {
             std::uint32_t instruction_idx;
-            std::string class_name;
             location rewrite_location;
-            thunk_type type;
+            std::uint32_t symbol;
+        };
+
+        //The references live at one GC safepoint: a call, an allocation or a backward branch
+        struct stack_map
+        {
+            std::uint32_t instruction_idx;
+            //Bitmask over handle_map, 16 entries per element
+            std::vector<std::uint16_t> live_handles;
+        };
+
+        //What a call site assumes about its callee; the VM checks it against the callee when it links the call
+        struct call_descriptor
+        {
+            std::uint32_t instruction_idx;
+            std::uint8_t return_type;
+            std::vector<std::uint8_t> argument_types;
+        };
+
+        //Exceptions of class_name thrown by words in [begin, end) are stored into slot and continue at target
+        struct exception_handler
+        {
+            std::uint16_t begin;
+            std::uint16_t end;
+            std::uint16_t target;
+            std::uint16_t slot;
+            std::string class_name;
+        };
+
+        //One instruction word laid out for dispatch without decoding: the opcode picks the handler, operands sit in their
+        //own fields, immediates are sign-extended and branch targets are absolute word indexes
+        struct predecoded_instruction
+        {
+            std::uint8_t handler;
+            std::uint8_t flags;
+            std::uint16_t dest;
+            std::uint16_t src1;
+            std::uint16_t src2;
+            std::int64_t imm;
         };
 
         struct method
         {
             std::string name;
             std::vector<std::uint64_t> instructions;
+            //Every distinct symbol the thunks refer to, in first-use order
+            std::vector<symbol> symbols;
             std::vector<thunk> thunks;
             std::vector<std::uint16_t> handle_map;
             std::uint16_t stack_size;
             std::uint8_t return_type;
             std::uint8_t method_type;
             std::vector<std::uint8_t> arg_types;
+            //Slot and type of every DEF'd local, which starts out as the zero (or null) of its type because the VM zero-fills frames
+            std::vector<std::pair<std::uint16_t, std::uint8_t>> local_types;
+            std::vector<profile::counter> counters;
+            std::vector<stack_map> stack_maps;
+            std::vector<call_descriptor> calls;
+            //In the order the VM tries them, so inner handlers come first
+            std::vector<exception_handler> handlers;
+            //Passed verifier::verify, so the VM may skip its own verification and type guards
+            bool verified;
+            //Every long, double and ref slot, arguments included, starts at an even 32-bit offset
+            bool aligned_frame;
+            //Written in the compact encoding; units is only filled by compact, once the thunks are resolved
+            bool compact;
+            std::vector<std::uint32_t> units;
+            //Carries a predecoded copy of its body; records is only filled by predecode, once the thunks are resolved
+            bool predecoded;
+            std::vector<predecoded_instruction> records;
+            //x86-64 code from emit_native, empty when the method is left to the interpreter
+            std::vector<std::uint8_t> native;
             std::uint64_t size;
         };
 
-        std::variant<method, std::vector<std::string>> compile(oops_bcode_compiler::parsing::cls::procedure &procedure);
+        //Optimizes fn and encodes it
+        std::variant<method, std::vector<std::string>> compile(oops_bcode_compiler::optimizer::function &fn, const options &options);
     } // namespace compiler
 } // namespace oops_bcode_compiler
 
@@ -0,0 +1,71 @@
+#include "fusion.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+
+#include "../instructions/bytecode.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::bytecode;
+using namespace oops_bcode_compiler::compiler;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    std::map<std::pair<itype, itype>, std::uint64_t> pair_histogram;
+
+    //Invokes callback(first, second, start_idx) for every two instruction words that always execute back to back
+    template <typename callback_t>
+    void for_each_adjacent_pair(const std::vector<std::uint32_t> &instruction_starts, const std::vector<std::uint32_t> &branch_targets, callback_t callback)
+    {
+        std::unordered_set<std::uint32_t> targets(branch_targets.begin(), branch_targets.end());
+        for (std::size_t i = 0; i + 1 < instruction_starts.size(); i++)
+        {
+            auto first = instruction_starts[i], second = instruction_starts[i + 1];
+            if (second != first + 1 or targets.find(second) != targets.end())
+            {
+                continue;
+            }
+            callback(first, second, i);
+        }
+    }
+} // namespace
+
+void oops_bcode_compiler::compiler::fuse_superinstructions(method &mtd, const std::vector<std::uint32_t> &instruction_starts, const std::vector<std::uint32_t> &branch_targets)
+{
+    std::uint32_t consumed = 0;
+    ::for_each_adjacent_pair(instruction_starts, branch_targets, [&](std::uint32_t first, std::uint32_t second, std::size_t) {
+        //A word already absorbed into the previous pair cannot start another one
+        if (first < consumed)
+        {
+            return;
+        }
+        auto first_type = opcode(mtd.instructions[first]), second_type = opcode(mtd.instructions[second]);
+        auto entry = std::find_if(fusion_table.begin(), fusion_table.end(), [&](const fusion &f) { return f.first == first_type and f.second == second_type; });
+        if (entry == fusion_table.end())
+        {
+            return;
+        }
+        logger.builder(logging::level::debug) << "Fusing " << itype_to_string[static_cast<unsigned>(first_type)] << " and " << itype_to_string[static_cast<unsigned>(second_type)] << " at " << first << " in " << mtd.name << logging::logbuilder::end;
+        mtd.instructions[first] = with_opcode(mtd.instructions[first], entry->fused);
+        consumed = second + 1;
+    });
+}
+
+void oops_bcode_compiler::compiler::record_instruction_pairs(const method &mtd, const std::vector<std::uint32_t> &instruction_starts, const std::vector<std::uint64_t> &execution_counts, const std::vector<std::uint32_t> &branch_targets)
+{
+    ::for_each_adjacent_pair(instruction_starts, branch_targets, [&](std::uint32_t first, std::uint32_t second, std::size_t start_idx) {
+        ::pair_histogram[{opcode(mtd.instructions[first]), opcode(mtd.instructions[second])}] += execution_counts[start_idx];
+    });
+}
+
+void oops_bcode_compiler::compiler::report_pair_histogram()
+{
+    std::vector<std::pair<std::pair<itype, itype>, std::uint64_t>> sorted(::pair_histogram.begin(), ::pair_histogram.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    for (auto &entry : sorted)
+    {
+        logger.builder(logging::level::info) << "Pair " << itype_to_string[static_cast<unsigned>(entry.first.first)] << " " << itype_to_string[static_cast<unsigned>(entry.first.second)] << " " << entry.second << logging::logbuilder::end;
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef COMPILER_FUSION
+#define COMPILER_FUSION
+
+#include <cstdint>
+#include <vector>
+
+#include "compiler.h"
+
+namespace oops_bcode_compiler
+{
+    namespace compiler
+    {
+        //Rewrites the opcode of the first word of every fusable adjacent pair in bytecode::fusion_table.
+        //instruction_starts lists the words that begin an instruction (as opposed to call argument words),
+        //and no pair is formed across a branch target.
+        void fuse_superinstructions(method &mtd, const std::vector<std::uint32_t> &instruction_starts, const std::vector<std::uint32_t> &branch_targets);
+
+        //Counts adjacent instruction pairs that could be fused, for regenerating the fusion table.
+        //Each pair is weighted by the execution count of its first instruction, so a profiled build yields a dynamic histogram.
+        void record_instruction_pairs(const method &mtd, const std::vector<std::uint32_t> &instruction_starts, const std::vector<std::uint64_t> &execution_counts, const std::vector<std::uint32_t> &branch_targets);
+
+        void report_pair_histogram();
+    } // namespace compiler
+} // namespace oops_bcode_compiler
+
+#endif /* COMPILER_FUSION */
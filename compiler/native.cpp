@@ -0,0 +1,448 @@
+#include "native.h"
+
+#include <initializer_list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include "../instructions/bytecode.h"
+#include "../utils/puns.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::bytecode;
+using namespace oops_bcode_compiler::compiler;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    constexpr std::size_t lanes = sizeof(std::uint64_t) / sizeof(std::uint16_t);
+    //ModRM register numbers; the templates only ever use eax/xmm0 and ecx
+    constexpr std::uint8_t eax = 0;
+    constexpr std::uint8_t ecx = 1;
+    constexpr std::uint8_t rex_w = 0x48;
+
+    class assembler
+    {
+    public:
+        std::vector<std::uint8_t> code;
+        //Positions of rel32 fields and the word, or stub, whose code they jump to
+        std::vector<std::pair<std::size_t, std::size_t>> fixups;
+
+        void bytes(std::initializer_list<std::uint8_t> encoded)
+        {
+            this->code.insert(this->code.end(), encoded);
+        }
+
+        template <typename int_t>
+        void value(int_t immediate)
+        {
+            for (std::size_t i = 0; i < sizeof(int_t); i++)
+            {
+                this->code.push_back(static_cast<std::uint8_t>(static_cast<std::uint64_t>(immediate) >> (i * CHAR_BIT)));
+            }
+        }
+
+        //ModRM and displacement of [rbx + slot * 4]
+        void slot(std::uint8_t reg, std::uint16_t slot)
+        {
+            this->code.push_back(0x83 | reg << 3);
+            this->value<std::uint32_t>(slot * sizeof(std::int32_t));
+        }
+
+        void wide(bool is_wide)
+        {
+            if (is_wide)
+            {
+                this->code.push_back(::rex_w);
+            }
+        }
+
+        void load(std::uint8_t reg, bool is_wide, std::uint16_t slot)
+        {
+            this->wide(is_wide);
+            this->bytes({0x8b});
+            this->slot(reg, slot);
+        }
+
+        void store(std::uint8_t reg, bool is_wide, std::uint16_t slot)
+        {
+            this->wide(is_wide);
+            this->bytes({0x89});
+            this->slot(reg, slot);
+        }
+
+        void jump(std::initializer_list<std::uint8_t> encoded, std::size_t target)
+        {
+            this->bytes(encoded);
+            this->fixups.emplace_back(this->code.size(), target);
+            this->value<std::int32_t>(0);
+        }
+    };
+
+    itype unfused(itype type)
+    {
+        for (auto &pair : fusion_table)
+        {
+            if (pair.fused == type)
+            {
+                return pair.first;
+            }
+        }
+        return type;
+    }
+
+    std::uint32_t sign_extend(std::uint64_t value, unsigned bits)
+    {
+        auto sign = static_cast<std::uint64_t>(1) << (bits - 1);
+        return static_cast<std::uint32_t>((value ^ sign) - sign);
+    }
+
+    std::size_t branch_target(std::uint64_t word, std::size_t at)
+    {
+        auto distance = static_cast<std::size_t>(word & 0xffff);
+        return (word >> 48) & 0xff ? at + 1 - distance : at + 1 + distance;
+    }
+
+    //Jcc opcode and operand width of the integer and reference branches; float and double ones take the slow path
+    std::optional<std::pair<std::uint8_t, bool>> condition(itype type)
+    {
+        switch (type)
+        {
+        case itype::IBGE:
+        case itype::IBGEI:
+            return {{0x8d, false}};
+        case itype::LBGE:
+        case itype::LBGEI:
+            return {{0x8d, true}};
+        case itype::IBLT:
+        case itype::IBLTI:
+            return {{0x8c, false}};
+        case itype::LBLT:
+        case itype::LBLTI:
+            return {{0x8c, true}};
+        case itype::IBLE:
+        case itype::IBLEI:
+            return {{0x8e, false}};
+        case itype::LBLE:
+        case itype::LBLEI:
+            return {{0x8e, true}};
+        case itype::IBGT:
+        case itype::IBGTI:
+            return {{0x8f, false}};
+        case itype::LBGT:
+        case itype::LBGTI:
+            return {{0x8f, true}};
+        case itype::IBEQ:
+        case itype::IBEQI:
+            return {{0x84, false}};
+        case itype::LBEQ:
+        case itype::LBEQI:
+        case itype::VBEQ:
+        case itype::VBEQI:
+            return {{0x84, true}};
+        case itype::IBNEQ:
+        case itype::IBNEQI:
+            return {{0x85, false}};
+        case itype::LBNEQ:
+        case itype::LBNEQI:
+        case itype::VBNEQ:
+        case itype::VBNEQI:
+            return {{0x85, true}};
+        default:
+            return {};
+        }
+    }
+
+    void arithmetic(::assembler &as, std::initializer_list<std::uint8_t> op, bool is_wide, std::uint64_t word)
+    {
+        as.load(::eax, is_wide, word >> 16);
+        as.wide(is_wide);
+        as.bytes(op);
+        as.slot(::eax, word >> 32);
+        as.store(::eax, is_wide, word);
+    }
+
+    //Group 1 instructions: 0 is add, 1 or, 4 and, 5 sub, 6 xor, 7 cmp
+    void immediate(::assembler &as, std::uint8_t extension, bool is_wide, std::uint64_t word)
+    {
+        as.load(::eax, is_wide, word >> 16);
+        as.wide(is_wide);
+        as.bytes({0x81, static_cast<std::uint8_t>(0xc0 | extension << 3)});
+        as.value(::sign_extend(word >> 32 & 0xffffff, 24));
+        as.store(::eax, is_wide, word);
+    }
+
+    //Group 2 instructions: 4 is shl, 5 shr, 7 sar
+    void shift(::assembler &as, std::uint8_t extension, bool is_wide, std::uint64_t word, bool by_immediate)
+    {
+        as.load(::eax, is_wide, word >> 16);
+        if (by_immediate)
+        {
+            as.wide(is_wide);
+            as.bytes({0xc1, static_cast<std::uint8_t>(0xc0 | extension << 3), static_cast<std::uint8_t>(word >> 32 & (is_wide ? 63 : 31))});
+        }
+        else
+        {
+            as.load(::ecx, false, word >> 32);
+            as.wide(is_wide);
+            as.bytes({0xd3, static_cast<std::uint8_t>(0xc0 | extension << 3)});
+        }
+        as.store(::eax, is_wide, word);
+    }
+
+    //SSE scalar arithmetic; prefix is 0xf3 for floats and 0xf2 for doubles
+    void floating(::assembler &as, std::uint8_t prefix, std::uint8_t op, std::uint64_t word)
+    {
+        as.bytes({prefix, 0x0f, 0x10});
+        as.slot(::eax, word >> 16);
+        as.bytes({prefix, 0x0f, op});
+        as.slot(::eax, word >> 32);
+        as.bytes({prefix, 0x0f, 0x11});
+        as.slot(::eax, word);
+    }
+} // namespace
+
+std::vector<std::uint8_t> oops_bcode_compiler::compiler::emit_native(const method &mtd)
+{
+    auto &words = mtd.instructions;
+    std::vector<bool> data(words.size());
+    for (auto &call : mtd.calls)
+    {
+        for (std::size_t i = 1; i <= (call.argument_types.size() + ::lanes - 1) / ::lanes and call.instruction_idx + i < words.size(); i++)
+        {
+            data[call.instruction_idx + i] = true;
+        }
+    }
+    for (std::size_t i = 0; i < words.size(); i++)
+    {
+        if (!data[i] and opcode(words[i]) == itype::BADR)
+        {
+            std::size_t entries = words[i] & 0xffff;
+            auto table = 1 + ((words[i] >> 48) & sparse_table ? entries : (entries + 1) / 2);
+            for (std::size_t j = 1; j <= table and i + j < words.size(); j++)
+            {
+                data[i + j] = true;
+            }
+        }
+    }
+    std::unordered_map<std::uint32_t, std::uint64_t> constants;
+    for (auto &thunk : mtd.thunks)
+    {
+        if (auto &symbol = mtd.symbols[thunk.symbol]; symbol.type == thunk_type::CONSTANT)
+        {
+            constants[thunk.instruction_idx] = utils::pun_read<std::uint64_t>(symbol.name.c_str());
+        }
+    }
+    //One start per word, then the epilogue and the dispatch stub
+    const std::size_t epilogue = words.size(), dispatch = words.size() + 1;
+    std::vector<std::size_t> starts(words.size() + 2);
+    ::assembler as;
+    //push rbx; push r12; sub rsp, 8; mov rbx, rdi; mov r12, rsi
+    as.bytes({0x53, 0x41, 0x54, 0x48, 0x83, 0xec, 0x08, 0x48, 0x89, 0xfb, 0x49, 0x89, 0xf4});
+    std::size_t slow_paths = 0;
+    for (std::size_t i = 0; i < words.size(); i++)
+    {
+        starts[i] = as.code.size();
+        if (data[i])
+        {
+            continue;
+        }
+        auto word = words[i];
+        auto type = ::unfused(opcode(word));
+        if (auto cond = ::condition(type))
+        {
+            bool by_immediate = type >= itype::IBGEI and type <= itype::VBNEQI;
+            as.load(::eax, cond->second, word >> 16);
+            as.wide(cond->second);
+            if (by_immediate)
+            {
+                as.bytes({0x81, 0xf8});
+                as.value(::sign_extend(word >> 32 & 0xffff, 16));
+            }
+            else
+            {
+                as.bytes({0x3b});
+                as.slot(::eax, word >> 32);
+            }
+            as.jump({0x0f, cond->first}, ::branch_target(word, i));
+            continue;
+        }
+        switch (type)
+        {
+        case itype::NOP:
+            break;
+        case itype::IADD:
+        case itype::LADD:
+            ::arithmetic(as, {0x03}, type == itype::LADD, word);
+            break;
+        case itype::ISUB:
+        case itype::LSUB:
+            ::arithmetic(as, {0x2b}, type == itype::LSUB, word);
+            break;
+        case itype::IMUL:
+        case itype::LMUL:
+            ::arithmetic(as, {0x0f, 0xaf}, type == itype::LMUL, word);
+            break;
+        case itype::IAND:
+        case itype::LAND:
+            ::arithmetic(as, {0x23}, type == itype::LAND, word);
+            break;
+        case itype::IOR:
+        case itype::LOR:
+            ::arithmetic(as, {0x0b}, type == itype::LOR, word);
+            break;
+        case itype::IXOR:
+        case itype::LXOR:
+            ::arithmetic(as, {0x33}, type == itype::LXOR, word);
+            break;
+        case itype::FADD:
+        case itype::DADD:
+            ::floating(as, type == itype::FADD ? 0xf3 : 0xf2, 0x58, word);
+            break;
+        case itype::FSUB:
+        case itype::DSUB:
+            ::floating(as, type == itype::FSUB ? 0xf3 : 0xf2, 0x5c, word);
+            break;
+        case itype::FMUL:
+        case itype::DMUL:
+            ::floating(as, type == itype::FMUL ? 0xf3 : 0xf2, 0x59, word);
+            break;
+        case itype::FDIV:
+        case itype::DDIV:
+            ::floating(as, type == itype::FDIV ? 0xf3 : 0xf2, 0x5e, word);
+            break;
+        case itype::IADDI:
+        case itype::LADDI:
+            ::immediate(as, 0, type == itype::LADDI, word);
+            break;
+        case itype::ISUBI:
+        case itype::LSUBI:
+            ::immediate(as, 5, type == itype::LSUBI, word);
+            break;
+        case itype::IANDI:
+        case itype::LANDI:
+            ::immediate(as, 4, type == itype::LANDI, word);
+            break;
+        case itype::IORI:
+        case itype::LORI:
+            ::immediate(as, 1, type == itype::LORI, word);
+            break;
+        case itype::IXORI:
+        case itype::LXORI:
+            ::immediate(as, 6, type == itype::LXORI, word);
+            break;
+        case itype::IMULI:
+        case itype::LMULI:
+            as.load(::eax, type == itype::LMULI, word >> 16);
+            as.wide(type == itype::LMULI);
+            as.bytes({0x69, 0xc0});
+            as.value(::sign_extend(word >> 32 & 0xffffff, 24));
+            as.store(::eax, type == itype::LMULI, word);
+            break;
+        case itype::ISLL:
+        case itype::LSLL:
+            ::shift(as, 4, type == itype::LSLL, word, false);
+            break;
+        case itype::ISRL:
+        case itype::LSRL:
+            ::shift(as, 5, type == itype::LSRL, word, false);
+            break;
+        case itype::ISRA:
+        case itype::LSRA:
+            ::shift(as, 7, type == itype::LSRA, word, false);
+            break;
+        case itype::ISLLI:
+        case itype::LSLLI:
+            ::shift(as, 4, type == itype::LSLLI, word, true);
+            break;
+        case itype::ISRLI:
+        case itype::LSRLI:
+            ::shift(as, 5, type == itype::LSRLI, word, true);
+            break;
+        case itype::ISRAI:
+        case itype::LSRAI:
+            ::shift(as, 7, type == itype::LSRAI, word, true);
+            break;
+        case itype::INEG:
+        case itype::LNEG:
+            as.load(::eax, type == itype::LNEG, word >> 16);
+            as.wide(type == itype::LNEG);
+            as.bytes({0xf7, 0xd8});
+            as.store(::eax, type == itype::LNEG, word);
+            break;
+        case itype::LDI:
+            //mov dword [rbx + dest * 4], imm32
+            as.bytes({0xc7});
+            as.slot(::eax, word);
+            as.value(static_cast<std::uint32_t>(word >> 16));
+            break;
+        case itype::LNL:
+            as.bytes({::rex_w, 0xc7});
+            as.slot(::eax, word);
+            as.value<std::uint32_t>(0);
+            break;
+        case itype::LUI:
+        case itype::LDC:
+            //mov rax, imm64
+            as.bytes({::rex_w, 0xb8});
+            as.value(type == itype::LUI ? word >> 16 << 24 : constants[i]);
+            as.store(::eax, true, word);
+            break;
+        case itype::BU:
+            as.jump({0xe9}, ::branch_target(word, i));
+            break;
+        case itype::IRET:
+        case itype::LRET:
+        case itype::FRET:
+        case itype::DRET:
+        case itype::VRET:
+            as.load(::eax, type != itype::IRET and type != itype::FRET, word >> 16);
+            as.jump({0xe9}, epilogue);
+            break;
+        default:
+        {
+            auto next = i + 1;
+            while (next < words.size() and data[next])
+            {
+                next++;
+            }
+            //mov rdi, r12; mov rsi, rbx; mov edx, i; call [r12]; mov eax, eax; cmp eax, next; jne dispatch
+            as.bytes({0x4c, 0x89, 0xe7, 0x48, 0x89, 0xde, 0xba});
+            as.value(static_cast<std::uint32_t>(i));
+            as.bytes({0x41, 0xff, 0x14, 0x24, 0x89, 0xc0, 0x3d});
+            as.value(static_cast<std::uint32_t>(next));
+            as.jump({0x0f, 0x85}, dispatch);
+            slow_paths++;
+            break;
+        }
+        }
+    }
+    starts[epilogue] = as.code.size();
+    //add rsp, 8; pop r12; pop rbx; ret
+    as.bytes({0x48, 0x83, 0xc4, 0x08, 0x41, 0x5c, 0x5b, 0xc3});
+    starts[dispatch] = as.code.size();
+    //cmp eax, -1; je epilogue; lea rcx, [rip + table]; movsxd rax, [rcx + rax * 4]; add rax, rcx; jmp rax
+    as.bytes({0x83, 0xf8, 0xff});
+    as.jump({0x0f, 0x84}, epilogue);
+    as.bytes({::rex_w, 0x8d, 0x0d});
+    auto table_fixup = as.code.size();
+    as.value<std::int32_t>(0);
+    as.bytes({::rex_w, 0x63, 0x04, 0x81, ::rex_w, 0x01, 0xc8, 0xff, 0xe0});
+    while (as.code.size() % sizeof(std::int32_t))
+    {
+        as.bytes({0xcc});
+    }
+    auto table = as.code.size();
+    utils::pun_write<std::int32_t>(as.code.data() + table_fixup, table - (table_fixup + sizeof(std::int32_t)));
+    //Data words are never continued at; their entries lead out of the method
+    for (std::size_t i = 0; i < words.size(); i++)
+    {
+        as.value<std::int32_t>(starts[data[i] ? epilogue : i] - table);
+    }
+    for (auto &fixup : as.fixups)
+    {
+        utils::pun_write<std::int32_t>(as.code.data() + fixup.first, starts[fixup.second] - (fixup.first + sizeof(std::int32_t)));
+    }
+    logger.builder(logging::level::debug) << "Emitted " << as.code.size() << " bytes of native code for " << mtd.name << " with " << slow_paths << " slow paths" << logging::logbuilder::end;
+    return as.code;
+}
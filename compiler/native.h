@@ -0,0 +1,24 @@
+#ifndef COMPILER_NATIVE
+#define COMPILER_NATIVE
+
+#include <cstdint>
+#include <vector>
+
+#include "compiler.h"
+
+namespace oops_bcode_compiler
+{
+    namespace compiler
+    {
+        //Lowers the words of mtd to position independent x86-64 code, one template per word over the frame in memory.
+        //The code is called as std::uint64_t(std::int32_t *frame, void *context) under the System V ABI and returns the
+        //raw bits of the method's result. The first word of context must point to the VM's slow path,
+        //std::uint32_t(void *context, std::int32_t *frame, std::uint32_t word), which runs word on the frame and returns the
+        //index of the word to continue at, or ~0 to leave the method. Allocations, invokes, field and array access, divisions,
+        //conversions, counters and everything else without a template go through it. No value outlives a template in a
+        //register, so the frame and the handle map stay the only GC roots, exactly as when interpreting.
+        std::vector<std::uint8_t> emit_native(const method &mtd);
+    } // namespace compiler
+} // namespace oops_bcode_compiler
+
+#endif /* COMPILER_NATIVE */
@@ -0,0 +1,38 @@
+#ifndef COMPILER_OPTIONS
+#define COMPILER_OPTIONS
+
+#include "../hierarchy/hierarchy.h"
+#include "../profile/profile.h"
+
+namespace oops_bcode_compiler
+{
+    namespace compiler
+    {
+        struct options
+        {
+            unsigned optimization_level = 1;
+            bool time_passes = false;
+            //Off for VMs without superinstruction handlers
+            bool fuse_superinstructions = true;
+            bool pair_histogram = false;
+            //Execution counts from --profile-use, null when compiling without a profile
+            const oops_bcode_compiler::profile::profile *profile = nullptr;
+            //Emit CNT counters at method entry, conditional branches and call sites
+            bool instrument = false;
+            //Largest callee, in IR instructions, spliced into a same-class SINV call site
+            unsigned inline_threshold = 12;
+            //Classes from --hierarchy, null when only receivers of known exact class are devirtualized
+            const oops_bcode_compiler::hierarchy::index *hierarchy = nullptr;
+            //Start 8-byte slots at even 32-bit offsets; off for VMs that place arguments back to back
+            bool align_frame = true;
+            //Write bodies as 32-bit units, widening only the instructions that need it, for VMs that decode them
+            bool compact_encoding = false;
+            //Append predecoded records to every method left in word form, for VMs that thread dispatch through them
+            bool predecode = false;
+            //Lower every method left in word form to x86-64 code in the native section
+            bool emit_native = false;
+        };
+    } // namespace compiler
+} // namespace oops_bcode_compiler
+
+#endif /* COMPILER_OPTIONS */
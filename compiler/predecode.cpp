@@ -0,0 +1,192 @@
+#include "predecode.h"
+
+#include "../instructions/bytecode.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::bytecode;
+using namespace oops_bcode_compiler::compiler;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    constexpr std::size_t lanes = sizeof(std::uint64_t) / sizeof(std::uint16_t);
+
+    //Which construct* call built a word, and how its immediate reads
+    enum class layout
+    {
+        REGISTERS,
+        SIGNED24,
+        INDEX24,
+        SIGNED32,
+        INDEX32,
+        IMM40,
+        BRANCH,
+        IMMEDIATE_BRANCH,
+        JUMP
+    };
+
+    itype unfused(itype type)
+    {
+        for (auto &pair : fusion_table)
+        {
+            if (pair.fused == type)
+            {
+                return pair.first;
+            }
+        }
+        return type;
+    }
+
+    ::layout layout_of(itype type)
+    {
+        if ((type >= itype::IADDI and type <= itype::LDIVUI) or (type >= itype::IANDI and type <= itype::LSRAI))
+        {
+            return ::layout::SIGNED24;
+        }
+        if (type >= itype::IBGE and type <= itype::VBNEQ)
+        {
+            return ::layout::BRANCH;
+        }
+        if (type >= itype::IBGEI and type <= itype::VBNEQI)
+        {
+            return ::layout::IMMEDIATE_BRANCH;
+        }
+        if (type >= itype::CVLLD and type <= itype::VVLSR)
+        {
+            return ::layout::INDEX24;
+        }
+        if (type >= itype::CSTLD and type <= itype::VSTSR)
+        {
+            return ::layout::INDEX32;
+        }
+        switch (type)
+        {
+        case itype::IOF:
+        case itype::VNEW:
+        case itype::VNEWF:
+        case itype::VINV:
+        case itype::IINV:
+        case itype::TVINV:
+        case itype::TIINV:
+        case itype::DINV:
+        case itype::TDINV:
+            return ::layout::INDEX24;
+        case itype::SINV:
+        case itype::TSINV:
+        case itype::LDC:
+        case itype::CNT:
+            return ::layout::INDEX32;
+        case itype::LDI:
+            return ::layout::SIGNED32;
+        case itype::NOP:
+        case itype::LUI:
+        case itype::LNL:
+            return ::layout::IMM40;
+        case itype::BU:
+            return ::layout::JUMP;
+        default:
+            return ::layout::REGISTERS;
+        }
+    }
+
+    std::int64_t sign_extend(std::uint64_t value, unsigned bits)
+    {
+        auto sign = static_cast<std::uint64_t>(1) << (bits - 1);
+        return static_cast<std::int64_t>((value ^ sign) - sign);
+    }
+
+    std::uint16_t branch_target(std::uint64_t word, std::size_t at)
+    {
+        auto distance = static_cast<std::size_t>(word & 0xffff);
+        return (word >> 48) & 0xff ? at + 1 - distance : at + 1 + distance;
+    }
+} // namespace
+
+void oops_bcode_compiler::compiler::predecode(method &mtd)
+{
+    auto words = mtd.instructions;
+    std::vector<bool> data(words.size());
+    for (auto &call : mtd.calls)
+    {
+        for (std::size_t i = 1; i <= (call.argument_types.size() + ::lanes - 1) / ::lanes and call.instruction_idx + i < words.size(); i++)
+        {
+            data[call.instruction_idx + i] = true;
+        }
+    }
+    mtd.records.clear();
+    mtd.records.reserve(words.size());
+    for (std::size_t i = 0; i < words.size(); i++)
+    {
+        auto word = words[i];
+        if (data[i])
+        {
+            mtd.records.push_back({0, 0, 0, 0, 0, static_cast<std::int64_t>(word)});
+            continue;
+        }
+        auto type = opcode(word);
+        predecoded_instruction record{static_cast<std::uint8_t>(type), 0, static_cast<std::uint16_t>(word), 0, 0, 0};
+        switch (::layout_of(::unfused(type)))
+        {
+        case ::layout::REGISTERS:
+            record.flags = word >> 48;
+            record.src1 = word >> 16;
+            record.src2 = word >> 32;
+            break;
+        case ::layout::SIGNED24:
+            record.src1 = word >> 16;
+            record.imm = ::sign_extend(word >> 32 & 0xffffff, 24);
+            break;
+        case ::layout::INDEX24:
+            record.src1 = word >> 16;
+            record.imm = word >> 32 & 0xffffff;
+            break;
+        case ::layout::SIGNED32:
+            record.flags = word >> 48;
+            record.imm = ::sign_extend(word >> 16 & 0xffffffff, 32);
+            break;
+        case ::layout::INDEX32:
+            record.flags = word >> 48;
+            record.imm = word >> 16 & 0xffffffff;
+            break;
+        case ::layout::IMM40:
+            record.imm = static_cast<std::int64_t>(type == itype::LUI ? word >> 16 << 24 : word >> 16 & 0xffffffffff);
+            break;
+        case ::layout::BRANCH:
+            record.dest = ::branch_target(word, i);
+            record.src1 = word >> 16;
+            record.src2 = word >> 32;
+            break;
+        case ::layout::IMMEDIATE_BRANCH:
+            record.dest = ::branch_target(word, i);
+            record.src1 = word >> 16;
+            record.imm = ::sign_extend(word >> 32 & 0xffff, 16);
+            break;
+        case ::layout::JUMP:
+            record.dest = ::branch_target(word, i);
+            break;
+        }
+        if (type == itype::BADR)
+        {
+            //Rewrites the offsets in the table words, which are copied as data once the loop reaches them
+            auto absolute = [&](std::uint32_t offset) {
+                return static_cast<std::uint64_t>(static_cast<std::uint32_t>(i + static_cast<std::int32_t>(offset)));
+            };
+            std::size_t entries = word & 0xffff;
+            bool sparse = (word >> 48) & sparse_table;
+            auto table = 1 + (sparse ? entries : (entries + 1) / 2);
+            for (std::size_t j = 1; j <= table and i + j < words.size(); j++)
+            {
+                data[i + j] = true;
+            }
+            words[i + 1] = (words[i + 1] & ~0xffffffffull) | absolute(words[i + 1]);
+            for (std::size_t j = 0; j < entries; j++)
+            {
+                auto &entry = words[i + 2 + (sparse ? j : j / 2)];
+                auto shift = sparse ? 0 : j % 2 * 32;
+                entry = (entry & ~(0xffffffffull << shift)) | absolute(entry >> shift) << shift;
+            }
+        }
+        mtd.records.push_back(record);
+    }
+    logger.builder(logging::level::debug) << "Predecoded " << mtd.records.size() << " records for " << mtd.name << logging::logbuilder::end;
+}
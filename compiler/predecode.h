@@ -0,0 +1,19 @@
+#ifndef COMPILER_PREDECODE
+#define COMPILER_PREDECODE
+
+#include "compiler.h"
+
+namespace oops_bcode_compiler
+{
+    namespace compiler
+    {
+        //Fills mtd.records with one record per word of mtd.instructions, so record indexes match word indexes.
+        //A fused word is laid out like the first instruction of its pair. Branches keep their absolute target in dest and
+        //immediate branches their sign-extended immediate in imm, with src2 cleared. LUI holds the whole 64-bit value it loads.
+        //Call argument and jump table words keep the raw word in imm with everything else zero; jump table offsets become
+        //absolute word indexes.
+        void predecode(method &mtd);
+    } // namespace compiler
+} // namespace oops_bcode_compiler
+
+#endif /* COMPILER_PREDECODE */
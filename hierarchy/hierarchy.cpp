@@ -0,0 +1,187 @@
+#include "hierarchy.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::hierarchy;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    constexpr const char *magic = "oops-hierarchy";
+    constexpr unsigned version = 1;
+
+    //imports[6] is the class itself; its superclass and superinterfaces follow
+    constexpr std::size_t self_import = 6;
+} // namespace
+
+bool oops_bcode_compiler::hierarchy::index::inherits(const std::string &class_name, const std::string &ancestor_name) const
+{
+    std::vector<std::string> worklist = {class_name};
+    std::set<std::string> seen = {class_name};
+    while (!worklist.empty())
+    {
+        auto current = worklist.back();
+        worklist.pop_back();
+        if (current == ancestor_name)
+        {
+            return true;
+        }
+        auto found = this->classes.find(current);
+        if (found == this->classes.end())
+        {
+            continue;
+        }
+        for (auto &super : found->second.supertypes)
+        {
+            if (seen.insert(super).second)
+            {
+                worklist.push_back(super);
+            }
+        }
+    }
+    return false;
+}
+
+bool oops_bcode_compiler::hierarchy::index::overridden_below(const std::string &class_name, const std::string &method_name) const
+{
+    //Walks up from every declaration of the method; classes are few enough that no subclass edges are kept
+    for (auto &[name, info] : this->classes)
+    {
+        if (name != class_name and info.methods.find(method_name) != info.methods.end() and this->inherits(name, class_name))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::variant<index, std::vector<std::string>> oops_bcode_compiler::hierarchy::load(const std::string &filename)
+{
+#define hierarchy_error(error)                                                                  \
+    std::stringstream error_builder;                                                            \
+    error_builder << error << " at line " << line_number << " of class hierarchy " << filename; \
+    logger.builder(logging::level::debug) << error_builder.str() << logging::logbuilder::end;   \
+    errors.push_back(error_builder.str())
+    std::vector<std::string> errors;
+    std::ifstream in(filename);
+    if (!in)
+    {
+        return std::vector<std::string>{"Unable to open class hierarchy " + filename};
+    }
+    index idx;
+    class_info *current = nullptr;
+    std::string line;
+    std::size_t line_number = 0;
+    bool seen_header = false;
+    while (std::getline(in, line))
+    {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string kind;
+        if (!(tokens >> kind))
+        {
+            continue;
+        }
+        if (!seen_header)
+        {
+            unsigned file_version;
+            if (kind != ::magic or !(tokens >> file_version) or file_version != ::version)
+            {
+                hierarchy_error("Expected '" << ::magic << " " << ::version << "' header");
+                return errors;
+            }
+            seen_header = true;
+            continue;
+        }
+        if (kind == "class")
+        {
+            std::string name;
+            if (!(tokens >> name))
+            {
+                hierarchy_error("Malformed class entry");
+                current = nullptr;
+                continue;
+            }
+            current = &idx.classes[name];
+            for (std::string super; tokens >> super;)
+            {
+                current->supertypes.push_back(super);
+            }
+        }
+        else if (kind == "method")
+        {
+            std::string name;
+            if (!current)
+            {
+                hierarchy_error("Method does not belong to a class");
+                continue;
+            }
+            if (!(tokens >> name))
+            {
+                hierarchy_error("Malformed method entry");
+                continue;
+            }
+            current->methods.insert(name);
+        }
+        else
+        {
+            hierarchy_error("Unknown class hierarchy entry " << kind);
+        }
+    }
+#undef hierarchy_error
+    if (!errors.empty())
+    {
+        return errors;
+    }
+    logger.builder(logging::level::info) << "Loaded class hierarchy " << filename << " with " << idx.classes.size() << " classes" << logging::logbuilder::end;
+    return idx;
+}
+
+std::vector<std::string> oops_bcode_compiler::hierarchy::save(const index &idx, const std::string &filename)
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        return {"Unable to write class hierarchy " + filename};
+    }
+    out << ::magic << " " << ::version << "\n";
+    for (auto &[name, info] : idx.classes)
+    {
+        out << "class " << name;
+        for (auto &super : info.supertypes)
+        {
+            out << " " << super;
+        }
+        out << "\n";
+        for (auto &method : info.methods)
+        {
+            out << "method " << method << "\n";
+        }
+    }
+    if (!out)
+    {
+        return {"Failed while writing class hierarchy " + filename};
+    }
+    return {};
+}
+
+void oops_bcode_compiler::hierarchy::add(index &idx, const parsing::cls &cls)
+{
+    auto &info = idx.classes[cls.imports[::self_import].name];
+    info.supertypes.clear();
+    for (std::size_t i = 1; i <= cls.implement_count and ::self_import + i < cls.imports.size(); i++)
+    {
+        info.supertypes.push_back(cls.imports[::self_import + i].name);
+    }
+    for (auto &proc : cls.self_methods)
+    {
+        if (!proc.is_static)
+        {
+            info.methods.insert(proc.name);
+        }
+    }
+}
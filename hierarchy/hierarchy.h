@@ -0,0 +1,52 @@
+#ifndef HIERARCHY_HIERARCHY
+#define HIERARCHY_HIERARCHY
+
+#include <map>
+#include <set>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "../parser/parser.h"
+
+namespace oops_bcode_compiler
+{
+    namespace hierarchy
+    {
+        //A class hierarchy index is trusted to name every class the VM will load alongside the compiled ones,
+        //since a virtual call is only bound directly when no indexed subclass overrides its target.
+        //
+        //On disk an index is plain text:
+        //  oops-hierarchy 1
+        //  class <class> <supertype>...
+        //  method <method>
+        //Method lines name the instance methods a class declares and belong to the closest preceding class line;
+        //'#' starts a comment.
+        struct class_info
+        {
+            //Superclass and superinterfaces, in import order
+            std::vector<std::string> supertypes;
+            std::set<std::string> methods;
+        };
+
+        struct index
+        {
+            std::map<std::string, class_info> classes;
+
+            //Whether class_name is ancestor_name or reaches it through the supertypes of indexed classes
+            bool inherits(const std::string &class_name, const std::string &ancestor_name) const;
+
+            //Whether any indexed class that inherits from class_name, other than class_name itself, declares method_name
+            bool overridden_below(const std::string &class_name, const std::string &method_name) const;
+        };
+
+        std::variant<index, std::vector<std::string>> load(const std::string &filename);
+
+        std::vector<std::string> save(const index &idx, const std::string &filename);
+
+        //Records the supertypes and instance methods of a parsed class
+        void add(index &idx, const parsing::cls &cls);
+    } // namespace hierarchy
+} // namespace oops_bcode_compiler
+
+#endif /* HIERARCHY_HIERARCHY */
@@ -0,0 +1,605 @@
+#ifndef INSTRUCTIONS_BYTECODE
+#define INSTRUCTIONS_BYTECODE
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <string>
+
+namespace oops_bcode_compiler
+{
+    namespace bytecode
+    {
+        enum class itype : unsigned char
+        {
+#pragma region DO NOT UNFOLD ME
+            //Done
+            NOP,
+            IADD,
+            LADD,
+            FADD,
+            DADD,
+            ISUB,
+            LSUB,
+            FSUB,
+            DSUB,
+            IMUL,
+            LMUL,
+            FMUL,
+            DMUL,
+            IDIV,
+            LDIV,
+            FDIV,
+            DDIV,
+            IMOD,
+            LMOD,
+            IDIVU,
+            LDIVU,
+            IADDI,
+            LADDI,
+            FADDI,
+            DADDI,
+            ISUBI,
+            LSUBI,
+            FSUBI,
+            DSUBI,
+            IMULI,
+            LMULI,
+            FMULI,
+            DMULI,
+            IDIVI,
+            LDIVI,
+            FDIVI,
+            DDIVI,
+            IMODI,
+            LMODI,
+            IDIVUI,
+            LDIVUI,
+            //TODO
+            INEG,
+            LNEG,
+            FNEG,
+            DNEG,
+            LUI,
+            LDI,
+            LNL,
+            ICSTL,
+            ICSTF,
+            ICSTD,
+            LCSTI,
+            LCSTF,
+            LCSTD,
+            FCSTI,
+            FCSTL,
+            FCSTD,
+            DCSTI,
+            DCSTL,
+            DCSTF,
+            //Done
+            IAND,
+            LAND,
+            IOR,
+            LOR,
+            IXOR,
+            LXOR,
+            ISLL,
+            LSLL,
+            ISRL,
+            LSRL,
+            ISRA,
+            LSRA,
+            IANDI,
+            LANDI,
+            IORI,
+            LORI,
+            IXORI,
+            LXORI,
+            ISLLI,
+            LSLLI,
+            ISRLI,
+            LSRLI,
+            ISRAI,
+            LSRAI,
+            IBGE,
+            LBGE,
+            FBGE,
+            DBGE,
+            IBLT,
+            LBLT,
+            FBLT,
+            DBLT,
+            IBLE,
+            LBLE,
+            FBLE,
+            DBLE,
+            IBGT,
+            LBGT,
+            FBGT,
+            DBGT,
+            IBEQ,
+            LBEQ,
+            FBEQ,
+            DBEQ,
+            VBEQ,
+            IBNEQ,
+            LBNEQ,
+            FBNEQ,
+            DBNEQ,
+            VBNEQ,
+            IBGEI,
+            LBGEI,
+            FBGEI,
+            DBGEI,
+            IBLTI,
+            LBLTI,
+            FBLTI,
+            DBLTI,
+            IBLEI,
+            LBLEI,
+            FBLEI,
+            DBLEI,
+            IBGTI,
+            LBGTI,
+            FBGTI,
+            DBGTI,
+            IBEQI,
+            LBEQI,
+            FBEQI,
+            DBEQI,
+            VBEQI,
+            IBNEQI,
+            LBNEQI,
+            FBNEQI,
+            DBNEQI,
+            VBNEQI,
+            //TODO
+            IBCMP,
+            LBCMP,
+            FBCMP,
+            DBCMP,
+            BADR,
+            BU,
+            CVLLD,
+            SVLLD,
+            IVLLD,
+            LVLLD,
+            FVLLD,
+            DVLLD,
+            VVLLD,
+            CVLSR,
+            SVLSR,
+            IVLSR,
+            LVLSR,
+            FVLSR,
+            DVLSR,
+            VVLSR,
+            CALD,
+            SALD,
+            IALD,
+            LALD,
+            FALD,
+            DALD,
+            VALD,
+            CASR,
+            SASR,
+            IASR,
+            LASR,
+            FASR,
+            DASR,
+            VASR,
+            CSTLD,
+            SSTLD,
+            ISTLD,
+            LSTLD,
+            FSTLD,
+            DSTLD,
+            VSTLD,
+            CSTSR,
+            SSTSR,
+            ISTSR,
+            LSTSR,
+            FSTSR,
+            DSTSR,
+            VSTSR,
+            VNEW,
+            //Done
+            CANEW,
+            SANEW,
+            IANEW,
+            LANEW,
+            FANEW,
+            DANEW,
+            VANEW,
+            //TODO
+            IOF,
+            VINV,
+            SINV,
+            IINV,
+            IRET,
+            LRET,
+            FRET,
+            DRET,
+            VRET,
+            EXC,
+            //Superinstructions; the first word of a fused pair carries one of these and the second word is left intact
+            IADDI_IBLT,
+            IADDI_IBLE,
+            IADDI_IBNEQ,
+            LADDI_LBLT,
+            IALD_IADD,
+            IALD_ISUB,
+            IALD_IMUL,
+            DALD_DADD,
+            DALD_DMUL,
+            IVLLD_IBEQI,
+            IVLLD_IBNEQI,
+            IVLLD_IBLT,
+            IVLLD_IBGE,
+            VVLLD_VBEQI,
+            VVLLD_VBNEQI,
+            //Instrumented builds only: increments the method's counter imm32
+            CNT,
+            //Tail invokes; encoded exactly like VINV/SINV/IINV. Nothing runs after one but the RET of its destination, which
+            //need not be the next word: unconditional branches may lead to it. No handler protects a tail invoke.
+            //The callee's frame replaces the caller's, but a VM that cannot reuse the frame may run them as plain invokes.
+            TVINV,
+            TSINV,
+            TIINV,
+            //Direct instance invokes; encoded like VINV, but bound once at link time to the method the class named by
+            //their thunk dispatches to, because the compiler proved every receiver reaching them runs that method
+            DINV,
+            TDINV,
+            //Encoded like VNEW, for objects that never escape the method; the VM may place them in the frame or
+            //replace them by their fields. The previous object from the same instruction is always dead by the time it reruns.
+            VNEWF,
+            //Compact encoding only: the next two units are a full instruction word, low half first.
+            //A unit without it stands for the word with its opcode, src2, src1 and dest bytes and everything else zero.
+            WIDE,
+            //Loads the 64-bit entry imm32 of the class constant pool into dest, as raw bits readable as a long or a double
+            LDC,
+            __COUNT__
+#pragma endregion
+        };
+
+        inline std::array<std::string, static_cast<unsigned>(itype::__COUNT__)> generate_itype_to_string()
+        {
+            std::array<std::string, static_cast<unsigned>(itype::__COUNT__)> ret;
+            std::fill(ret.begin(), ret.end(), "UNKNOWN");
+#define stringize(enumeration) ret[static_cast<unsigned>(itype::enumeration)] = #enumeration
+            stringize(NOP);
+            stringize(IADD);
+            stringize(LADD);
+            stringize(FADD);
+            stringize(DADD);
+            stringize(ISUB);
+            stringize(LSUB);
+            stringize(FSUB);
+            stringize(DSUB);
+            stringize(IMUL);
+            stringize(LMUL);
+            stringize(FMUL);
+            stringize(DMUL);
+            stringize(IDIV);
+            stringize(LDIV);
+            stringize(FDIV);
+            stringize(DDIV);
+            stringize(IMOD);
+            stringize(LMOD);
+            stringize(IDIVU);
+            stringize(LDIVU);
+            stringize(IADDI);
+            stringize(LADDI);
+            stringize(FADDI);
+            stringize(DADDI);
+            stringize(ISUBI);
+            stringize(LSUBI);
+            stringize(FSUBI);
+            stringize(DSUBI);
+            stringize(IMULI);
+            stringize(LMULI);
+            stringize(FMULI);
+            stringize(DMULI);
+            stringize(IDIVI);
+            stringize(LDIVI);
+            stringize(FDIVI);
+            stringize(DDIVI);
+            stringize(IMODI);
+            stringize(LMODI);
+            stringize(IDIVUI);
+            stringize(LDIVUI);
+            stringize(INEG);
+            stringize(LNEG);
+            stringize(FNEG);
+            stringize(DNEG);
+            stringize(LUI);
+            stringize(LDI);
+            stringize(LNL);
+            stringize(ICSTL);
+            stringize(ICSTF);
+            stringize(ICSTD);
+            stringize(LCSTI);
+            stringize(LCSTF);
+            stringize(LCSTD);
+            stringize(FCSTI);
+            stringize(FCSTL);
+            stringize(FCSTD);
+            stringize(DCSTI);
+            stringize(DCSTL);
+            stringize(DCSTF);
+            stringize(IAND);
+            stringize(LAND);
+            stringize(IOR);
+            stringize(LOR);
+            stringize(IXOR);
+            stringize(LXOR);
+            stringize(ISLL);
+            stringize(LSLL);
+            stringize(ISRL);
+            stringize(LSRL);
+            stringize(ISRA);
+            stringize(LSRA);
+            stringize(IANDI);
+            stringize(LANDI);
+            stringize(IORI);
+            stringize(LORI);
+            stringize(IXORI);
+            stringize(LXORI);
+            stringize(ISLLI);
+            stringize(LSLLI);
+            stringize(ISRLI);
+            stringize(LSRLI);
+            stringize(ISRAI);
+            stringize(LSRAI);
+            stringize(IBGE);
+            stringize(LBGE);
+            stringize(FBGE);
+            stringize(DBGE);
+            stringize(IBLT);
+            stringize(LBLT);
+            stringize(FBLT);
+            stringize(DBLT);
+            stringize(IBLE);
+            stringize(LBLE);
+            stringize(FBLE);
+            stringize(DBLE);
+            stringize(IBGT);
+            stringize(LBGT);
+            stringize(FBGT);
+            stringize(DBGT);
+            stringize(IBEQ);
+            stringize(LBEQ);
+            stringize(FBEQ);
+            stringize(DBEQ);
+            stringize(VBEQ);
+            stringize(IBNEQ);
+            stringize(LBNEQ);
+            stringize(FBNEQ);
+            stringize(DBNEQ);
+            stringize(VBNEQ);
+            stringize(IBGEI);
+            stringize(LBGEI);
+            stringize(FBGEI);
+            stringize(DBGEI);
+            stringize(IBLTI);
+            stringize(LBLTI);
+            stringize(FBLTI);
+            stringize(DBLTI);
+            stringize(IBLEI);
+            stringize(LBLEI);
+            stringize(FBLEI);
+            stringize(DBLEI);
+            stringize(IBGTI);
+            stringize(LBGTI);
+            stringize(FBGTI);
+            stringize(DBGTI);
+            stringize(IBEQI);
+            stringize(LBEQI);
+            stringize(FBEQI);
+            stringize(DBEQI);
+            stringize(VBEQI);
+            stringize(IBNEQI);
+            stringize(LBNEQI);
+            stringize(FBNEQI);
+            stringize(DBNEQI);
+            stringize(VBNEQI);
+            stringize(IBCMP);
+            stringize(LBCMP);
+            stringize(FBCMP);
+            stringize(DBCMP);
+            stringize(BADR);
+            stringize(BU);
+            stringize(CVLLD);
+            stringize(SVLLD);
+            stringize(IVLLD);
+            stringize(LVLLD);
+            stringize(FVLLD);
+            stringize(DVLLD);
+            stringize(VVLLD);
+            stringize(CVLSR);
+            stringize(SVLSR);
+            stringize(IVLSR);
+            stringize(LVLSR);
+            stringize(FVLSR);
+            stringize(DVLSR);
+            stringize(VVLSR);
+            stringize(CALD);
+            stringize(SALD);
+            stringize(IALD);
+            stringize(LALD);
+            stringize(FALD);
+            stringize(DALD);
+            stringize(VALD);
+            stringize(CASR);
+            stringize(SASR);
+            stringize(IASR);
+            stringize(LASR);
+            stringize(FASR);
+            stringize(DASR);
+            stringize(VASR);
+            stringize(CSTLD);
+            stringize(SSTLD);
+            stringize(ISTLD);
+            stringize(LSTLD);
+            stringize(FSTLD);
+            stringize(DSTLD);
+            stringize(VSTLD);
+            stringize(CSTSR);
+            stringize(SSTSR);
+            stringize(ISTSR);
+            stringize(LSTSR);
+            stringize(FSTSR);
+            stringize(DSTSR);
+            stringize(VSTSR);
+            stringize(VNEW);
+            stringize(CANEW);
+            stringize(SANEW);
+            stringize(IANEW);
+            stringize(LANEW);
+            stringize(FANEW);
+            stringize(DANEW);
+            stringize(VANEW);
+            stringize(IOF);
+            stringize(VINV);
+            stringize(SINV);
+            stringize(IINV);
+            stringize(IRET);
+            stringize(LRET);
+            stringize(FRET);
+            stringize(DRET);
+            stringize(VRET);
+            stringize(EXC);
+            stringize(IADDI_IBLT);
+            stringize(IADDI_IBLE);
+            stringize(IADDI_IBNEQ);
+            stringize(LADDI_LBLT);
+            stringize(IALD_IADD);
+            stringize(IALD_ISUB);
+            stringize(IALD_IMUL);
+            stringize(DALD_DADD);
+            stringize(DALD_DMUL);
+            stringize(IVLLD_IBEQI);
+            stringize(IVLLD_IBNEQI);
+            stringize(IVLLD_IBLT);
+            stringize(IVLLD_IBGE);
+            stringize(VVLLD_VBEQI);
+            stringize(VVLLD_VBNEQI);
+            stringize(CNT);
+            stringize(TVINV);
+            stringize(TSINV);
+            stringize(TIINV);
+            stringize(DINV);
+            stringize(TDINV);
+            stringize(VNEWF);
+            stringize(WIDE);
+            stringize(LDC);
+#undef stringize
+            return ret;
+        }
+
+        inline std::array<std::string, static_cast<unsigned>(itype::__COUNT__)> itype_to_string = generate_itype_to_string();
+
+        //Bits of the flags byte of array loads and stores, set for checks the compiler proved can never fail.
+        //The VM may skip those checks; a fused pair keeps the flags of its first word.
+        constexpr std::uint8_t unchecked_null = 1;
+        constexpr std::uint8_t unchecked_bounds = 2;
+
+        //BADR reads an int index from src1 and has its table in the words after it. dest holds the entry count.
+        //The first table word has the default target in its low 32 bits and, for a dense table, the smallest key in its high 32.
+        //A dense table then packs two targets per word, low half first, one per key from the smallest up.
+        //A sparse table, marked by this flag, has one word per key instead, key high and target low, sorted by key for a binary search.
+        //Targets are signed word offsets from the BADR word.
+        constexpr std::uint8_t sparse_table = 1;
+
+        inline std::uint64_t construct3(itype type, std::uint8_t flags, std::uint16_t dest, std::uint16_t src1, std::uint16_t src2)
+        {
+            std::uint64_t out = 0;
+            out <<= CHAR_BIT * sizeof(type);
+            out |= static_cast<std::uint8_t>(type);
+            out <<= CHAR_BIT * sizeof(flags);
+            out |= flags;
+            out <<= CHAR_BIT * sizeof(src2);
+            out |= src2;
+            out <<= CHAR_BIT * sizeof(src1);
+            out |= src1;
+            out <<= CHAR_BIT * sizeof(dest);
+            out |= dest;
+            return out;
+        }
+
+        inline std::uint64_t construct24(itype type, std::uint16_t dest, std::uint16_t src1, std::uint32_t imm24)
+        {
+            std::uint64_t out = 0;
+            out <<= CHAR_BIT * sizeof(type);
+            out |= static_cast<std::uint8_t>(type);
+            out <<= CHAR_BIT * (sizeof(imm24) - sizeof(type));
+            out |= imm24 & (~static_cast<std::uint32_t>(0) >> CHAR_BIT * sizeof(type));
+            out <<= CHAR_BIT * sizeof(src1);
+            out |= src1;
+            out <<= CHAR_BIT * sizeof(dest);
+            out |= dest;
+            return out;
+        }
+
+        inline std::uint64_t construct32(itype type, std::uint8_t flags, std::uint16_t dest, std::uint32_t imm32)
+        {
+            std::uint64_t out = 0;
+            out <<= CHAR_BIT * sizeof(type);
+            out |= static_cast<std::uint8_t>(type);
+            out <<= CHAR_BIT * sizeof(flags);
+            out |= static_cast<std::uint8_t>(flags);
+            out <<= CHAR_BIT * sizeof(imm32);
+            out |= imm32;
+            out <<= CHAR_BIT * sizeof(dest);
+            out |= dest;
+            return out;
+        }
+
+        inline std::uint64_t construct40(itype type, std::uint16_t dest, std::uint64_t imm40)
+        {
+            imm40 |= static_cast<std::uint64_t>(type) << 40;
+            imm40 <<= CHAR_BIT * sizeof(dest);
+            imm40 |= dest;
+            return imm40;
+        }
+
+        inline itype opcode(std::uint64_t word)
+        {
+            return static_cast<itype>(word >> (sizeof(std::uint64_t) - sizeof(itype)) * CHAR_BIT);
+        }
+
+        inline std::uint64_t with_opcode(std::uint64_t word, itype type)
+        {
+            constexpr auto shift = (sizeof(std::uint64_t) - sizeof(itype)) * CHAR_BIT;
+            return (word & ~(~static_cast<std::uint64_t>(0) << shift)) | static_cast<std::uint64_t>(type) << shift;
+        }
+
+        struct fusion
+        {
+            itype first;
+            itype second;
+            itype fused;
+        };
+
+        //Seeded from the loop back-edge, array kernel and field test sequences that dominate VM profiles;
+        //regenerate from --pair-histogram output over the class corpus. Adding a pair needs a matching VM handler,
+        //which executes both words of the pair from a single dispatch.
+        constexpr std::array<fusion, 15> fusion_table = {{
+            {itype::IADDI, itype::IBLT, itype::IADDI_IBLT},
+            {itype::IADDI, itype::IBLE, itype::IADDI_IBLE},
+            {itype::IADDI, itype::IBNEQ, itype::IADDI_IBNEQ},
+            {itype::LADDI, itype::LBLT, itype::LADDI_LBLT},
+            {itype::IALD, itype::IADD, itype::IALD_IADD},
+            {itype::IALD, itype::ISUB, itype::IALD_ISUB},
+            {itype::IALD, itype::IMUL, itype::IALD_IMUL},
+            {itype::DALD, itype::DADD, itype::DALD_DADD},
+            {itype::DALD, itype::DMUL, itype::DALD_DMUL},
+            {itype::IVLLD, itype::IBEQI, itype::IVLLD_IBEQI},
+            {itype::IVLLD, itype::IBNEQI, itype::IVLLD_IBNEQI},
+            {itype::IVLLD, itype::IBLT, itype::IVLLD_IBLT},
+            {itype::IVLLD, itype::IBGE, itype::IVLLD_IBGE},
+            {itype::VVLLD, itype::VBEQI, itype::VVLLD_VBEQI},
+            {itype::VVLLD, itype::VBNEQI, itype::VVLLD_VBNEQI},
+        }};
+    } // namespace bytecode
+} // namespace oops_bcode_compiler
+#endif /* INSTRUCTIONS_BYTECODE */
@@ -29,6 +29,8 @@ namespace oops_bcode_compiler
             LI,
             CST,
             RCVT,
+            //Copies a local of any type into another of the same type
+            MOV,
             AND,
             OR,
             XOR,
@@ -85,6 +87,8 @@ namespace oops_bcode_compiler
             IINV,
             //TODO
             RET,
+            //Inserted by --instrument; operand 0 is the counter index
+            CNT,
             //Done
             DEF,
             LBL,
@@ -123,6 +127,7 @@ namespace oops_bcode_compiler
             stringize(LI);
             stringize(CST);
             stringize(RCVT);
+            stringize(MOV);
             stringize(AND);
             stringize(OR);
             stringize(XOR);
@@ -176,6 +181,7 @@ namespace oops_bcode_compiler
             stringize(SINV);
             stringize(IINV);
             stringize(RET);
+            stringize(CNT);
             stringize(EXC);
             stringize(DEF);
             stringize(LBL);
@@ -187,7 +193,7 @@ namespace oops_bcode_compiler
             stringize(EXT);
             stringize(IMPL);
             stringize(CLZ);
-#undef put
+#undef stringize
             return ret;
         }
 
@@ -0,0 +1,263 @@
+#ifndef INSTRUCTIONS_SEMANTICS
+#define INSTRUCTIONS_SEMANTICS
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "keywords.h"
+
+namespace oops_bcode_compiler
+{
+    namespace keywords
+    {
+        inline bool is_conditional_branch(keyword kw)
+        {
+            return kw >= keyword::BGE and kw <= keyword::BNEQI;
+        }
+
+        //Every branch names its target label in operand 0
+        inline bool is_branch(keyword kw)
+        {
+            return is_conditional_branch(kw) or kw == keyword::BU;
+        }
+
+        //Control never falls through to the next instruction
+        inline bool ends_flow(keyword kw)
+        {
+            return kw == keyword::BU or kw == keyword::RET or kw == keyword::BADR or kw == keyword::EXC;
+        }
+
+        //Indexes of the operands naming labels the instruction may jump to.
+        //BADR reads its index from operand 0, names its default label in operand 1 and then lists key label pairs.
+        inline std::vector<std::size_t> label_operands(keyword kw, std::size_t operand_count)
+        {
+            if (is_branch(kw))
+            {
+                return {0};
+            }
+            if (kw != keyword::BADR)
+            {
+                return {};
+            }
+            std::vector<std::size_t> labels;
+            for (std::size_t i = 1; i < operand_count; i += 2)
+            {
+                labels.push_back(i);
+            }
+            return labels;
+        }
+
+        inline bool is_call(keyword kw)
+        {
+            return kw == keyword::SINV or kw == keyword::IINV or kw == keyword::VINV;
+        }
+
+        //Operand 0 names the local variable written by the instruction
+        inline bool defines_first_operand(keyword kw)
+        {
+            switch (kw)
+            {
+            case keyword::ADD:
+            case keyword::SUB:
+            case keyword::MUL:
+            case keyword::DIV:
+            case keyword::MOD:
+            case keyword::DIVU:
+            case keyword::ADDI:
+            case keyword::SUBI:
+            case keyword::MULI:
+            case keyword::DIVI:
+            case keyword::MODI:
+            case keyword::DIVUI:
+            case keyword::NEG:
+            case keyword::LI:
+            case keyword::CST:
+            case keyword::RCVT:
+            case keyword::MOV:
+            case keyword::AND:
+            case keyword::OR:
+            case keyword::XOR:
+            case keyword::SLL:
+            case keyword::SRL:
+            case keyword::SRA:
+            case keyword::ANDI:
+            case keyword::ORI:
+            case keyword::XORI:
+            case keyword::SLLI:
+            case keyword::SRLI:
+            case keyword::SRAI:
+            case keyword::CVLLD:
+            case keyword::SVLLD:
+            case keyword::VLLD:
+            case keyword::CALD:
+            case keyword::SALD:
+            case keyword::ALD:
+            case keyword::ALEN:
+            case keyword::CSTLD:
+            case keyword::SSTLD:
+            case keyword::STLD:
+            case keyword::VNEW:
+            case keyword::ANEW:
+            case keyword::IOF:
+            case keyword::VINV:
+            case keyword::SINV:
+            case keyword::IINV:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        //Whether a DIVI, MODI or DIVUI immediate has a nonzero digit, so that it cannot trap as an integer divisor.
+        //Hex, octal and binary digits count after their prefix, decimal and float ones before any exponent.
+        inline bool is_nonzero_immediate(const std::string &immediate)
+        {
+            std::size_t start = !immediate.empty() and immediate[0] == '-';
+            bool prefixed = immediate.length() > start + 2 and immediate[start] == '0' and std::string("xXoObB").find(immediate[start + 1]) != std::string::npos;
+            if (prefixed)
+            {
+                return immediate.find_first_not_of('0', start + 2) != std::string::npos;
+            }
+            auto mantissa = immediate.substr(start, immediate.find_first_of("eE", start) - start);
+            return mantissa.find_first_of("123456789") != std::string::npos;
+        }
+
+        //No side effects and cannot trap, so the instruction may be deleted once its result is dead.
+        //Register division is excluded because a zero divisor traps, as is division by a zero immediate.
+        template <typename instruction>
+        bool is_pure(const instruction &instr)
+        {
+            switch (instr.itype)
+            {
+            case keyword::DIVI:
+            case keyword::MODI:
+            case keyword::DIVUI:
+                return instr.operands.size() > 2 and is_nonzero_immediate(instr.operands[2]);
+            case keyword::ADD:
+            case keyword::SUB:
+            case keyword::MUL:
+            case keyword::ADDI:
+            case keyword::SUBI:
+            case keyword::MULI:
+            case keyword::NEG:
+            case keyword::LI:
+            case keyword::CST:
+            case keyword::RCVT:
+            case keyword::MOV:
+            case keyword::AND:
+            case keyword::OR:
+            case keyword::XOR:
+            case keyword::SLL:
+            case keyword::SRL:
+            case keyword::SRA:
+            case keyword::ANDI:
+            case keyword::ORI:
+            case keyword::XORI:
+            case keyword::SLLI:
+            case keyword::SRLI:
+            case keyword::SRAI:
+            case keyword::IOF:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        //Indexes of the operands naming local variables that the instruction reads
+        inline std::vector<std::size_t> use_operands(keyword kw, std::size_t operand_count)
+        {
+            switch (kw)
+            {
+            case keyword::ADD:
+            case keyword::SUB:
+            case keyword::MUL:
+            case keyword::DIV:
+            case keyword::MOD:
+            case keyword::DIVU:
+            case keyword::AND:
+            case keyword::OR:
+            case keyword::XOR:
+            case keyword::SLL:
+            case keyword::SRL:
+            case keyword::SRA:
+            case keyword::BGE:
+            case keyword::BLT:
+            case keyword::BLE:
+            case keyword::BGT:
+            case keyword::BEQ:
+            case keyword::BNEQ:
+            case keyword::CALD:
+            case keyword::SALD:
+            case keyword::ALD:
+                return {1, 2};
+            case keyword::ADDI:
+            case keyword::SUBI:
+            case keyword::MULI:
+            case keyword::DIVI:
+            case keyword::MODI:
+            case keyword::DIVUI:
+            case keyword::ANDI:
+            case keyword::ORI:
+            case keyword::XORI:
+            case keyword::SLLI:
+            case keyword::SRLI:
+            case keyword::SRAI:
+            case keyword::NEG:
+            case keyword::CST:
+            case keyword::RCVT:
+            case keyword::MOV:
+            case keyword::BGEI:
+            case keyword::BLTI:
+            case keyword::BLEI:
+            case keyword::BGTI:
+            case keyword::BEQI:
+            case keyword::BNEQI:
+            case keyword::CVLLD:
+            case keyword::SVLLD:
+            case keyword::VLLD:
+            case keyword::ALEN:
+            case keyword::IOF:
+                return {1};
+            case keyword::CVLSR:
+            case keyword::SVLSR:
+            case keyword::VLSR:
+                return {0, 1};
+            case keyword::CASR:
+            case keyword::SASR:
+            case keyword::ASR:
+                return {0, 1, 2};
+            case keyword::CSTSR:
+            case keyword::SSTSR:
+            case keyword::STSR:
+            case keyword::RET:
+            case keyword::BADR:
+            case keyword::EXC:
+                return {0};
+            case keyword::ANEW:
+                return {2};
+            case keyword::SINV:
+            {
+                std::vector<std::size_t> uses;
+                for (std::size_t i = 2; i < operand_count; i++)
+                {
+                    uses.push_back(i);
+                }
+                return uses;
+            }
+            case keyword::IINV:
+            case keyword::VINV:
+            {
+                std::vector<std::size_t> uses = {1};
+                for (std::size_t i = 3; i < operand_count; i++)
+                {
+                    uses.push_back(i);
+                }
+                return uses;
+            }
+            default:
+                return {};
+            }
+        }
+    } // namespace keywords
+} // namespace oops_bcode_compiler
+#endif /* INSTRUCTIONS_SEMANTICS */
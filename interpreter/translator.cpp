@@ -1,7 +1,10 @@
 #include "translator.h"
 
 #include <algorithm>
+#include <climits>
+#include <map>
 #include <numeric>
+#include <optional>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -9,7 +12,11 @@
 #include "../platform_specific/files.h"
 #include "../utils/puns.h"
 #include "../utils/hashing.h"
+#include "../compiler/compact.h"
 #include "../compiler/compiler.h"
+#include "../compiler/predecode.h"
+#include "../optimizer/inliner.h"
+#include "../verifier/verifier.h"
 #include "../debug/logs.h"
 
 using namespace oops_bcode_compiler::transformer;
@@ -22,6 +29,9 @@ namespace
     {
         return (in + align - 1) & ~(align - 1);
     }
+
+    constexpr std::size_t native_page = 4096;
+    constexpr std::size_t native_alignment = 16;
     std::uint64_t string_pool_size(oops_bcode_compiler::parsing::cls &cls)
     {
         std::uint64_t size = 0;
@@ -32,6 +42,46 @@ namespace
         return size;
     }
 
+    //Devirtualized calls bind to methods of classes the source only reached through a supertype, so import those too
+    void import_bound_methods(oops_bcode_compiler::parsing::cls &cls, const std::vector<oops_bcode_compiler::compiler::method> &methods)
+    {
+        constexpr auto unknown = ~static_cast<std::size_t>(0);
+        for (auto &mtd : methods)
+        {
+            for (auto &t : mtd.symbols)
+            {
+                if (t.type != oops_bcode_compiler::compiler::thunk_type::METHOD or std::any_of(cls.methods.begin(), cls.methods.end(), [&](const oops_bcode_compiler::parsing::cls::method &imported) { return imported.host_name == t.class_name and imported.name == t.name; }))
+                {
+                    continue;
+                }
+                if (std::none_of(cls.imports.begin() + 6, cls.imports.end(), [&](const oops_bcode_compiler::parsing::cls::cls_import &imp) { return imp.name == t.class_name; }))
+                {
+                    cls.imports.push_back({t.class_name, unknown, unknown});
+                }
+                cls.methods.push_back({t.class_name, t.name, unknown, unknown});
+                logger.builder(logging::level::debug) << "Importing " << t.class_name << "." << t.name << " for a devirtualized call" << logging::logbuilder::end;
+            }
+        }
+    }
+
+    const char *symbol_kind(oops_bcode_compiler::compiler::thunk_type type)
+    {
+        switch (type)
+        {
+        case oops_bcode_compiler::compiler::thunk_type::CLASS:
+            return "class";
+        case oops_bcode_compiler::compiler::thunk_type::METHOD:
+            return "method";
+        case oops_bcode_compiler::compiler::thunk_type::SVAR:
+            return "static variable";
+        case oops_bcode_compiler::compiler::thunk_type::IVAR:
+            return "instance variable";
+        case oops_bcode_compiler::compiler::thunk_type::CONSTANT:
+            return "constant";
+        }
+        return "symbol";
+    }
+
     std::size_t dethunk(oops_bcode_compiler::compiler::thunk &t, std::size_t thunked, std::uint64_t value)
     {
         switch (t.rewrite_location)
@@ -48,20 +98,22 @@ namespace
     }
 } // namespace
 
-std::vector<std::string> oops_bcode_compiler::transformer::write(oops_bcode_compiler::parsing::cls cls, std::string build_path)
+std::vector<std::string> oops_bcode_compiler::transformer::write(oops_bcode_compiler::parsing::cls cls, std::string build_path, const compiler::options &options)
 {
     std::vector<std::string> errors;
     std::stringstream error_builder;
-    std::uint64_t classes_offset, methods_offset, statics_offset, instances_offset, bytecode_offset, string_offset;
-    classes_offset = 6 * sizeof(std::uint64_t);
-    methods_offset = classes_offset + sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t) * (cls.imports.size() - 6);
-    statics_offset = methods_offset + sizeof(std::uint32_t) * 2 + (sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t)) * cls.methods.size();
-    instances_offset = statics_offset + sizeof(std::uint32_t) * 2 + (sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t)) * cls.static_variables.size();
-    bytecode_offset = instances_offset + sizeof(std::uint32_t) * 2 + (sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t)) * cls.instance_variables.size();
-    std::vector<compiler::method> compiled_methods;
+    std::uint64_t classes_offset, methods_offset, statics_offset, instances_offset, bytecode_offset, string_offset, constants_offset, native_offset;
+    std::vector<optimizer::function> functions;
     for (auto &proc : cls.self_methods)
     {
-        auto maybe_method = compiler::compile(proc);
+        functions.push_back(optimizer::build(proc));
+        functions.back().profile = options.profile ? options.profile->find(cls.imports[6].name, proc.name) : nullptr;
+    }
+    optimizer::inline_static_calls(functions, cls.imports[6].name, options);
+    std::vector<compiler::method> compiled_methods;
+    for (auto &fn : functions)
+    {
+        auto maybe_method = compiler::compile(fn, options);
         if (std::holds_alternative<compiler::method>(maybe_method))
         {
             compiled_methods.push_back(std::get<compiler::method>(maybe_method));
@@ -72,14 +124,47 @@ std::vector<std::string> oops_bcode_compiler::transformer::write(oops_bcode_comp
             std::copy(compile_errors.begin(), compile_errors.end(), std::back_inserter(errors));
         }
     }
+    ::import_bound_methods(cls, compiled_methods);
+    //Every distinct constant loaded by LDC gets one pool entry, however many methods load it
+    std::vector<std::uint64_t> constants;
+    std::unordered_map<std::string, std::uint32_t> constant_indexes;
+    for (auto &method : compiled_methods)
+    {
+        for (auto &symbol : method.symbols)
+        {
+            if (symbol.type == oops_bcode_compiler::compiler::thunk_type::CONSTANT and constant_indexes.emplace(symbol.name, constants.size()).second)
+            {
+                constants.push_back(utils::pun_read<std::uint64_t>(symbol.name.c_str()));
+            }
+        }
+    }
+    classes_offset = 8 * sizeof(std::uint64_t);
+    methods_offset = classes_offset + sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t) * (cls.imports.size() - 6);
+    statics_offset = methods_offset + sizeof(std::uint32_t) * 2 + (sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t)) * cls.methods.size();
+    instances_offset = statics_offset + sizeof(std::uint32_t) * 2 + (sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t)) * cls.static_variables.size();
+    constants_offset = instances_offset + sizeof(std::uint32_t) * 2 + (sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t)) * cls.instance_variables.size();
+    bytecode_offset = constants_offset + sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t) * constants.size();
     string_offset = bytecode_offset + sizeof(std::uint64_t) + std::accumulate(compiled_methods.begin(), compiled_methods.end(), static_cast<std::uint64_t>(0), [](auto sum, auto method) { return sum + method.size; });
     logger.builder(logging::level::debug) << "classes_offset " << classes_offset << logging::logbuilder::end;
     logger.builder(logging::level::debug) << "methods_offset " << methods_offset << logging::logbuilder::end;
     logger.builder(logging::level::debug) << "statics_offset " << statics_offset << logging::logbuilder::end;
     logger.builder(logging::level::debug) << "instances_offset " << instances_offset << logging::logbuilder::end;
+    logger.builder(logging::level::debug) << "constants_offset " << constants_offset << logging::logbuilder::end;
     logger.builder(logging::level::debug) << "bytecode_offset " << bytecode_offset << logging::logbuilder::end;
     logger.builder(logging::level::debug) << "string_offset " << string_offset << logging::logbuilder::end;
     std::uint64_t cls_size = string_offset + string_pool_size(cls);
+    //The native section starts on a page of its own so the VM can map it executable, and is left out when no method has code
+    native_offset = 0;
+    if (std::any_of(compiled_methods.begin(), compiled_methods.end(), [](const compiler::method &method) { return !method.native.empty(); }))
+    {
+        native_offset = ::round_off(cls_size, ::native_page);
+        cls_size = native_offset + ::round_off(sizeof(std::uint64_t) * (compiled_methods.size() + 1), ::native_alignment);
+        for (auto &method : compiled_methods)
+        {
+            cls_size += ::round_off(method.native.size(), ::native_alignment);
+        }
+        logger.builder(logging::level::debug) << "native_offset " << native_offset << logging::logbuilder::end;
+    }
     if (auto maybe_cls = platform::create_class_file(cls.imports[6].name, cls_size, build_path))
     {
         utils::pun_write(maybe_cls->mmapped_file, classes_offset);
@@ -88,6 +173,9 @@ std::vector<std::string> oops_bcode_compiler::transformer::write(oops_bcode_comp
         utils::pun_write(maybe_cls->mmapped_file + sizeof(std::uint64_t) * 3, instances_offset);
         utils::pun_write(maybe_cls->mmapped_file + sizeof(std::uint64_t) * 4, bytecode_offset);
         utils::pun_write(maybe_cls->mmapped_file + sizeof(std::uint64_t) * 5, string_offset);
+        //Added after the original six offsets so that they keep their positions
+        utils::pun_write(maybe_cls->mmapped_file + sizeof(std::uint64_t) * 6, constants_offset);
+        utils::pun_write(maybe_cls->mmapped_file + sizeof(std::uint64_t) * 7, native_offset);
         char *base_head = maybe_cls->mmapped_file + classes_offset;
         utils::pun_write<std::uint32_t>(base_head, cls.imports.size() - 6);
         utils::pun_write<std::uint32_t>(base_head + sizeof(std::uint32_t), cls.implement_count);
@@ -204,111 +292,100 @@ std::vector<std::string> oops_bcode_compiler::transformer::write(oops_bcode_comp
             std::memcpy(maybe_cls->mmapped_file + sizeof(std::uint32_t) + current_string_offset, ivar->name.c_str(), ivar->name.size());
             current_string_offset += ::round_off(ivar->name.size() + sizeof(std::uint32_t));
         }
+        //Each distinct symbol is looked up once for the whole class; the thunks of every method are then patched from the cache
+        auto resolve = [&](const oops_bcode_compiler::compiler::symbol &symbol) -> std::optional<std::uint64_t> {
+            if (symbol.type == oops_bcode_compiler::compiler::thunk_type::CONSTANT)
+            {
+                return constant_indexes[symbol.name];
+            }
+            auto cidx = class_indexes.find(symbol.class_name);
+            if (cidx == class_indexes.end())
+            {
+                return {};
+            }
+            if (symbol.type == oops_bcode_compiler::compiler::thunk_type::CLASS)
+            {
+                return cidx->second;
+            }
+            //IMP SVAR lines are filed with the method imports by the parser
+            auto &indexes = symbol.type == oops_bcode_compiler::compiler::thunk_type::IVAR ? instance_indexes : method_indexes;
+            if (auto idx = indexes.find({symbol.name, cidx->second}); idx != indexes.end())
+            {
+                return idx->second;
+            }
+            return {};
+        };
+        std::map<oops_bcode_compiler::compiler::symbol, std::optional<std::uint64_t>> relocations;
+        utils::pun_write<std::uint32_t>(base_head, constants.size());
+        utils::pun_write<std::uint32_t>(base_head + sizeof(std::uint32_t), 0);
+        base_head += sizeof(std::uint32_t) * 2;
+        for (auto constant : constants)
+        {
+            utils::pun_write(base_head, constant);
+            base_head += sizeof(constant);
+        }
+        logger.builder(logging::level::debug) << "Wrote " << constants.size() << " pool constants" << logging::logbuilder::end;
         utils::pun_write(base_head, string_offset - bytecode_offset);
         base_head += sizeof(std::uint64_t);
         for (auto &method : compiled_methods)
         {
             logger.builder(logging::level::debug) << "Writing " << method.name << " size " << method.size << logging::logbuilder::end;
             logger.builder(logging::level::debug) << "Base head offset " << base_head - maybe_cls->mmapped_file << logging::logbuilder::end;
-            for (auto &thunk : method.thunks)
+            std::vector<std::optional<std::uint64_t>> resolved;
+            for (auto &symbol : method.symbols)
             {
-                switch (thunk.type)
-                {
-                case oops_bcode_compiler::compiler::thunk_type::CLASS:
+                auto cached = relocations.find(symbol);
+                if (cached == relocations.end())
                 {
-                    auto idx = class_indexes.find(thunk.name);
-                    if (idx == class_indexes.end())
+                    cached = relocations.emplace(symbol, resolve(symbol)).first;
+                    if (!cached->second)
                     {
-                        error_builder << "Unable to find class name " << thunk.name << " for compiled instruction " << thunk.instruction_idx << " in method " << method.name;
+                        error_builder.str("");
+                        error_builder << "Unable to resolve " << ::symbol_kind(symbol.type) << " " << symbol.class_name << (symbol.name.empty() ? "" : ".") << symbol.name << " referenced by method " << method.name;
                         errors.push_back(error_builder.str());
                         logger.debug(error_builder.str());
-                        error_builder.clear();
-                        continue;
                     }
-                    method.instructions[thunk.instruction_idx] = dethunk(thunk, method.instructions[thunk.instruction_idx], idx->second);
-                    break;
                 }
-                case oops_bcode_compiler::compiler::thunk_type::METHOD:
-                {
-                    auto cidx = class_indexes.find(thunk.class_name);
-                    if (cidx == class_indexes.end())
-                    {
-                        error_builder << "Unable to find class name " << thunk.name << " for compiled instruction " << thunk.instruction_idx << " in method " << method.name;
-                        errors.push_back(error_builder.str());
-                        logger.debug(error_builder.str());
-                        error_builder.clear();
-                        continue;
-                    }
-                    auto idx = method_indexes.find({thunk.name, cidx->second});
-                    if (idx == method_indexes.end())
-                    {
-                        error_builder << "Unable to find method name " << thunk.name << " for compiled instruction " << thunk.instruction_idx << " in method " << method.name;
-                        errors.push_back(error_builder.str());
-                        logger.debug(error_builder.str());
-                        error_builder.clear();
-                        continue;
-                    }
-                    method.instructions[thunk.instruction_idx] = dethunk(thunk, method.instructions[thunk.instruction_idx], idx->second);
-                    break;
-                }
-                case oops_bcode_compiler::compiler::thunk_type::IVAR:
-                {
-                    auto cidx = class_indexes.find(thunk.class_name);
-                    if (cidx == class_indexes.end())
-                    {
-                        error_builder << "Unable to find class name " << thunk.name << " for compiled instruction " << thunk.instruction_idx << " in method " << method.name;
-                        errors.push_back(error_builder.str());
-                        logger.debug(error_builder.str());
-                        error_builder.clear();
-                        continue;
-                    }
-                    auto idx = instance_indexes.find({thunk.name, cidx->second});
-                    if (idx == instance_indexes.end())
-                    {
-                        error_builder << "Unable to find instance variable name " << thunk.name << " for compiled instruction " << thunk.instruction_idx << " in method " << method.name;
-                        errors.push_back(error_builder.str());
-                        logger.debug(error_builder.str());
-                        error_builder.clear();
-                        continue;
-                    }
-                    method.instructions[thunk.instruction_idx] = dethunk(thunk, method.instructions[thunk.instruction_idx], idx->second);
-                    break;
-                }
-                case oops_bcode_compiler::compiler::thunk_type::SVAR:
+                resolved.push_back(cached->second);
+            }
+            for (auto &thunk : method.thunks)
+            {
+                if (auto value = resolved[thunk.symbol])
                 {
-                    auto cidx = class_indexes.find(thunk.class_name);
-                    if (cidx == class_indexes.end())
-                    {
-                        error_builder << "Unable to find class name " << thunk.name << " for compiled instruction " << thunk.instruction_idx << " in method " << method.name;
-                        errors.push_back(error_builder.str());
-                        logger.debug(error_builder.str());
-                        error_builder.clear();
-                        continue;
-                    }
-                    auto idx = method_indexes.find({thunk.name, cidx->second});
-                    if (idx == method_indexes.end())
-                    {
-                        error_builder << "Unable to find static variable name " << thunk.name << " for compiled instruction " << thunk.instruction_idx << " in method " << method.name;
-                        errors.push_back(error_builder.str());
-                        logger.debug(error_builder.str());
-                        error_builder.clear();
-                        continue;
-                    }
-                    method.instructions[thunk.instruction_idx] = dethunk(thunk, method.instructions[thunk.instruction_idx], idx->second);
-                    break;
-                }
+                    method.instructions[thunk.instruction_idx] = dethunk(thunk, method.instructions[thunk.instruction_idx], *value);
                 }
             }
             logger.builder(logging::level::debug) << "Dethunking complete" << logging::logbuilder::end;
+            //The hash covers the word form, which a VM recovers by expanding the units
+            std::uint64_t verification_hash = method.verified ? verifier::verification_hash(method) : 0;
+            if (method.compact)
+            {
+                oops_bcode_compiler::compiler::compact(method);
+            }
+            if (method.predecoded)
+            {
+                oops_bcode_compiler::compiler::predecode(method);
+            }
             utils::pun_write<std::uint64_t>(base_head, method.size);
             base_head += sizeof(std::uint64_t);
             logger.builder(logging::level::debug) << "Method size complete" << logging::logbuilder::end;
             logger.builder(logging::level::debug) << "Base head offset " << base_head - maybe_cls->mmapped_file << logging::logbuilder::end;
-            utils::pun_write<std::uint16_t>(base_head, method.instructions.size());
+            utils::pun_write<std::uint16_t>(base_head, method.compact ? method.units.size() : method.instructions.size());
             utils::pun_write<std::uint16_t>(base_head + sizeof(std::uint16_t), method.stack_size);
-            utils::pun_write<std::uint16_t>(base_head + sizeof(std::uint16_t) * 2, method.return_type | method.method_type << 4);
+            //Bit 8 marks an instrumented method, whose counter descriptors follow the handle map; bit 9 marks GC stack maps after those.
+            //Bit 10 marks a verified method, with its verification hash right after this header and its call descriptors last.
+            //Bit 11 marks an aligned frame, where arguments too are padded so 8-byte slots start at even 32-bit offsets.
+            //Bit 12 marks an exception table, which comes after the stack maps.
+            //Bit 13 marks a compact body of 32-bit units, counted in place of words above; every instruction index in the tables counts units too.
+            //Bit 14 marks predecoded records, one per word, after everything else.
+            utils::pun_write<std::uint16_t>(base_head + sizeof(std::uint16_t) * 2, method.return_type | method.method_type << 4 | !method.counters.empty() << 8 | !method.stack_maps.empty() << 9 | method.verified << 10 | method.aligned_frame << 11 | !method.handlers.empty() << 12 | method.compact << 13 | method.predecoded << 14);
             utils::pun_write<std::uint16_t>(base_head + sizeof(std::uint16_t) * 3, method.arg_types.size());
             base_head += sizeof(std::uint16_t) * 4;
+            if (method.verified)
+            {
+                utils::pun_write<std::uint64_t>(base_head, verification_hash);
+                base_head += sizeof(std::uint64_t);
+            }
             logger.builder(logging::level::debug) << "Method meta complete" << logging::logbuilder::end;
             logger.builder(logging::level::debug) << "Base head offset " << base_head - maybe_cls->mmapped_file << logging::logbuilder::end;
             std::uint64_t arg_builder = 0;
@@ -336,10 +413,27 @@ std::vector<std::string> oops_bcode_compiler::transformer::write(oops_bcode_comp
             }
             logger.builder(logging::level::debug) << "Argument building complete" << logging::logbuilder::end;
             logger.builder(logging::level::debug) << "Base head offset " << base_head - maybe_cls->mmapped_file << logging::logbuilder::end;
-            for (auto instruction : method.instructions)
+            if (method.compact)
             {
-                utils::pun_write(base_head, instruction);
-                base_head += sizeof(instruction);
+                for (auto unit : method.units)
+                {
+                    utils::pun_write(base_head, unit);
+                    base_head += sizeof(unit);
+                }
+                //Pads the body back to a whole word
+                if (method.units.size() % 2)
+                {
+                    utils::pun_write<std::uint32_t>(base_head, 0);
+                    base_head += sizeof(std::uint32_t);
+                }
+            }
+            else
+            {
+                for (auto instruction : method.instructions)
+                {
+                    utils::pun_write(base_head, instruction);
+                    base_head += sizeof(instruction);
+                }
             }
             logger.builder(logging::level::debug) << "Instruction copying complete" << logging::logbuilder::end;
             logger.builder(logging::level::debug) << "Base head offset " << base_head - maybe_cls->mmapped_file << logging::logbuilder::end;
@@ -362,8 +456,116 @@ std::vector<std::string> oops_bcode_compiler::transformer::write(oops_bcode_comp
                 utils::pun_write(base_head, handle_builder);
                 base_head += sizeof(handle_builder);
             }
+            if (!method.counters.empty())
+            {
+                utils::pun_write<std::uint64_t>(base_head, method.counters.size());
+                base_head += sizeof(std::uint64_t);
+                for (auto &counter : method.counters)
+                {
+                    utils::pun_write<std::uint64_t>(base_head, counter.source_index | static_cast<std::uint64_t>(counter.kind) << 32);
+                    base_head += sizeof(std::uint64_t);
+                }
+                logger.builder(logging::level::debug) << "Wrote " << method.counters.size() << " counter descriptors" << logging::logbuilder::end;
+            }
+            if (!method.stack_maps.empty())
+            {
+                utils::pun_write<std::uint64_t>(base_head, method.stack_maps.size());
+                base_head += sizeof(std::uint64_t);
+                std::vector<std::uint16_t> packed;
+                std::uint32_t previous = 0;
+                for (auto &map : method.stack_maps)
+                {
+                    packed.push_back(map.instruction_idx - previous);
+                    previous = map.instruction_idx;
+                    packed.insert(packed.end(), map.live_handles.begin(), map.live_handles.end());
+                }
+                packed.resize((packed.size() + sizeof(std::uint64_t) / sizeof(std::uint16_t) - 1) / (sizeof(std::uint64_t) / sizeof(std::uint16_t)) * (sizeof(std::uint64_t) / sizeof(std::uint16_t)));
+                for (auto lane : packed)
+                {
+                    utils::pun_write(base_head, lane);
+                    base_head += sizeof(lane);
+                }
+                logger.builder(logging::level::debug) << "Wrote " << method.stack_maps.size() << " stack maps" << logging::logbuilder::end;
+            }
+            if (!method.handlers.empty())
+            {
+                //Per handler, its word range, target and catch slot, then the class index of what it catches
+                utils::pun_write<std::uint64_t>(base_head, method.handlers.size());
+                base_head += sizeof(std::uint64_t);
+                for (auto &handler : method.handlers)
+                {
+                    std::uint32_t class_index = 0;
+                    if (auto idx = class_indexes.find(handler.class_name); idx != class_indexes.end())
+                    {
+                        class_index = idx->second;
+                    }
+                    else
+                    {
+                        error_builder << "Unable to find class name " << handler.class_name << " for exception handler at word " << handler.target << " in method " << method.name;
+                        errors.push_back(error_builder.str());
+                        logger.debug(error_builder.str());
+                        error_builder.clear();
+                    }
+                    utils::pun_write<std::uint64_t>(base_head, handler.begin | static_cast<std::uint64_t>(handler.end) << 16 | static_cast<std::uint64_t>(handler.target) << 32 | static_cast<std::uint64_t>(handler.slot) << 48);
+                    utils::pun_write<std::uint64_t>(base_head + sizeof(std::uint64_t), class_index);
+                    base_head += sizeof(std::uint64_t) * 2;
+                }
+                logger.builder(logging::level::debug) << "Wrote " << method.handlers.size() << " exception handlers" << logging::logbuilder::end;
+            }
+            if (method.verified)
+            {
+                utils::pun_write<std::uint64_t>(base_head, method.calls.size());
+                base_head += sizeof(std::uint64_t);
+                for (auto &call : method.calls)
+                {
+                    utils::pun_write<std::uint64_t>(base_head, call.instruction_idx | static_cast<std::uint64_t>(call.return_type) << 32 | static_cast<std::uint64_t>(call.argument_types.size()) << 40);
+                    base_head += sizeof(std::uint64_t);
+                    std::uint64_t type_builder = 0;
+                    for (std::size_t i = 0; i < call.argument_types.size(); i++)
+                    {
+                        auto mod = i % (sizeof(std::uint64_t) / 4 * CHAR_BIT);
+                        type_builder |= static_cast<std::uint64_t>(call.argument_types[i]) << (mod * 4);
+                        if (mod == sizeof(std::uint64_t) / 4 * CHAR_BIT - 1 or i + 1 == call.argument_types.size())
+                        {
+                            utils::pun_write(base_head, type_builder);
+                            base_head += sizeof(type_builder);
+                            type_builder = 0;
+                        }
+                    }
+                }
+                logger.builder(logging::level::debug) << "Wrote " << method.calls.size() << " call descriptors" << logging::logbuilder::end;
+            }
+            if (method.predecoded)
+            {
+                //Per record, the handler byte, flags byte, dest, src1 and src2, then the immediate as a whole word
+                utils::pun_write<std::uint64_t>(base_head, method.records.size());
+                base_head += sizeof(std::uint64_t);
+                for (auto &record : method.records)
+                {
+                    utils::pun_write<std::uint64_t>(base_head, record.handler | static_cast<std::uint64_t>(record.flags) << 8 | static_cast<std::uint64_t>(record.dest) << 16 | static_cast<std::uint64_t>(record.src1) << 32 | static_cast<std::uint64_t>(record.src2) << 48);
+                    utils::pun_write(base_head + sizeof(std::uint64_t), record.imm);
+                    base_head += sizeof(std::uint64_t) * 2;
+                }
+                logger.builder(logging::level::debug) << "Wrote " << method.records.size() << " predecoded records" << logging::logbuilder::end;
+            }
             logger.builder(logging::level::debug) << "Final base_head offset: " << base_head - maybe_cls->mmapped_file << logging::logbuilder::end;
         }
+        if (native_offset)
+        {
+            //A method count, then per method the offset of its code from the section start and its size, zero for none
+            base_head = maybe_cls->mmapped_file + native_offset;
+            utils::pun_write<std::uint64_t>(base_head, compiled_methods.size());
+            std::uint64_t code_offset = ::round_off(sizeof(std::uint64_t) * (compiled_methods.size() + 1), ::native_alignment);
+            for (std::size_t i = 0; i < compiled_methods.size(); i++)
+            {
+                auto &native = compiled_methods[i].native;
+                utils::pun_write<std::uint32_t>(base_head + sizeof(std::uint64_t) * (i + 1), native.empty() ? 0 : code_offset);
+                utils::pun_write<std::uint32_t>(base_head + sizeof(std::uint64_t) * (i + 1) + sizeof(std::uint32_t), native.size());
+                std::copy(native.begin(), native.end(), base_head + code_offset);
+                code_offset += ::round_off(native.size(), ::native_alignment);
+            }
+            logger.builder(logging::level::debug) << "Wrote " << code_offset << " bytes of native section" << logging::logbuilder::end;
+        }
         platform::close_file_mapping(*maybe_cls, true);
         return errors;
     }
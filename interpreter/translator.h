@@ -1,13 +1,14 @@
 #ifndef INTERPRETER_TRANSLATOR
 #define INTERPRETER_TRANSLATOR
 
+#include "../compiler/options.h"
 #include "../parser/parser.h"
 
 namespace oops_bcode_compiler
 {
     namespace transformer
     {
-        std::vector<std::string> write(parsing::cls clz, std::string build_path);
+        std::vector<std::string> write(parsing::cls clz, std::string build_path, const compiler::options &options);
     } // namespace transformer
 } // namespace oops_bcode_compiler
 #endif /* INTERPRETER_TRANSLATOR */
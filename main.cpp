@@ -1,17 +1,36 @@
 #include <algorithm>
+#include <charconv>
+#include <optional>
 #include <queue>
+#include <string_view>
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
 
 #include "debug/logs.h"
 #include "parser/parser.h"
+#include "compiler/fusion.h"
+#include "hierarchy/hierarchy.h"
 #include "interpreter/translator.h"
+#include "optimizer/passes.h"
 #include "platform_specific/files.h"
+#include "profile/profile.h"
 
 using namespace oops_bcode_compiler;
 
-int compile_standalone(std::string class_file, std::string build_path)
+//Reads a whole argument as an unsigned number, or nothing if any of it is not a digit or it does not fit
+std::optional<unsigned> parse_unsigned(std::string_view text)
+{
+    unsigned value;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() or error != std::errc() or end != text.data() + text.size())
+    {
+        return {};
+    }
+    return value;
+}
+
+int compile_standalone(std::string class_file, std::string build_path, const oops_bcode_compiler::compiler::options &options)
 {
     auto cls = oops_bcode_compiler::parsing::parse(class_file);
     if (!cls)
@@ -31,7 +50,7 @@ int compile_standalone(std::string class_file, std::string build_path)
         return errors.size();
     }
     debug::logger.builder(debug::logging::level::info) << "Successfully parsed file " << class_file << debug::logging::logbuilder::end;
-    if (auto errors = oops_bcode_compiler::transformer::write(std::get<oops_bcode_compiler::parsing::cls>(*cls), build_path); !errors.empty())
+    if (auto errors = oops_bcode_compiler::transformer::write(std::get<oops_bcode_compiler::parsing::cls>(*cls), build_path, options); !errors.empty())
     {
         debug::logger.builder(debug::logging::level::error) << "Tried to compile and write '" << class_file << "', but got error" << (errors.size() > 1 ? "s" : "") << ":" << debug::logging::logbuilder::end;
         for (auto &error : errors)
@@ -44,8 +63,66 @@ int compile_standalone(std::string class_file, std::string build_path)
     return 0;
 }
 
+//Sums the profiles named after --profile-merge's output file into it, for combining runs from several machines
+int merge_profiles(const std::vector<std::string> &inputs, const std::string &output)
+{
+    oops_bcode_compiler::profile::profile merged;
+    for (auto &input : inputs)
+    {
+        auto loaded = oops_bcode_compiler::profile::load(input);
+        if (std::holds_alternative<std::vector<std::string>>(loaded))
+        {
+            auto &errors = std::get<std::vector<std::string>>(loaded);
+            for (auto &error : errors)
+            {
+                debug::logger.builder(debug::logging::level::error) << error << debug::logging::logbuilder::end;
+            }
+            return errors.size();
+        }
+        oops_bcode_compiler::profile::merge(merged, std::get<oops_bcode_compiler::profile::profile>(loaded));
+    }
+    auto errors = oops_bcode_compiler::profile::save(merged, output);
+    for (auto &error : errors)
+    {
+        debug::logger.builder(debug::logging::level::error) << error << debug::logging::logbuilder::end;
+    }
+    return errors.size();
+}
+
+//Indexes the supertypes and instance methods of the classes named after --hierarchy-build's output file, for devirtualizing calls
+int build_hierarchy(const std::vector<std::string> &class_files, const std::string &output)
+{
+    oops_bcode_compiler::hierarchy::index idx;
+    for (auto &class_file : class_files)
+    {
+        auto cls = oops_bcode_compiler::parsing::parse(class_file);
+        if (!cls)
+        {
+            debug::logger.builder(debug::logging::level::error) << "File '" << class_file << "' could not be found!" << debug::logging::logbuilder::end;
+            return 1;
+        }
+        if (std::holds_alternative<std::vector<std::string>>(*cls))
+        {
+            auto &errors = std::get<std::vector<std::string>>(*cls);
+            for (auto &error : errors)
+            {
+                debug::logger.builder(debug::logging::level::error) << error << debug::logging::logbuilder::end;
+            }
+            return errors.size();
+        }
+        oops_bcode_compiler::hierarchy::add(idx, std::get<oops_bcode_compiler::parsing::cls>(*cls));
+    }
+    auto errors = oops_bcode_compiler::hierarchy::save(idx, output);
+    for (auto &error : errors)
+    {
+        debug::logger.builder(debug::logging::level::error) << error << debug::logging::logbuilder::end;
+    }
+    return errors.size();
+}
+
 int main(int argc, char **argv)
 {
+    const int arg_count = argc;
     std::unordered_map<std::string, int> args;
     while (argc-- > 0)
     {
@@ -68,6 +145,34 @@ int main(int argc, char **argv)
             debug::logger.set_level(debug::logging::level::warning);
         }
     }
+    if (auto merge = args.find("--profile-merge"); merge != args.end())
+    {
+        if (merge->second + 2 >= arg_count)
+        {
+            debug::logger.builder(debug::logging::level::error) << "--profile-merge needs an output file and at least one input profile!" << debug::logging::logbuilder::end;
+            return 1;
+        }
+        std::vector<std::string> inputs;
+        for (int i = merge->second + 2; i < arg_count and argv[i][0] != '-'; i++)
+        {
+            inputs.push_back(argv[i]);
+        }
+        return merge_profiles(inputs, argv[merge->second + 1]);
+    }
+    if (auto build = args.find("--hierarchy-build"); build != args.end())
+    {
+        if (build->second + 2 >= arg_count)
+        {
+            debug::logger.builder(debug::logging::level::error) << "--hierarchy-build needs an output file and at least one class file!" << debug::logging::logbuilder::end;
+            return 1;
+        }
+        std::vector<std::string> inputs;
+        for (int i = build->second + 2; i < arg_count and argv[i][0] != '-'; i++)
+        {
+            inputs.push_back(argv[i]);
+        }
+        return build_hierarchy(inputs, argv[build->second + 1]);
+    }
     auto to_compile = args.find("--file");
     if (to_compile == args.end())
     {
@@ -92,5 +197,89 @@ int main(int argc, char **argv)
     {
         build_path = argv[out_dir->second + 1];
     }
-    return compile_standalone(argv[to_compile->second + 1], build_path);
+    oops_bcode_compiler::compiler::options options;
+    for (auto level : {"-O0", "-O1", "-O2"})
+    {
+        if (args.find(level) != args.end())
+        {
+            options.optimization_level = level[2] - '0';
+        }
+    }
+    options.fuse_superinstructions = args.find("--no-fusion") == args.end();
+    options.pair_histogram = args.find("--pair-histogram") != args.end();
+    options.instrument = args.find("--instrument") != args.end();
+    options.align_frame = args.find("--no-frame-alignment") == args.end();
+    options.compact_encoding = args.find("--compact") != args.end();
+    options.predecode = args.find("--predecode") != args.end();
+    options.emit_native = args.find("--emit-native") != args.end();
+    if (auto threshold = args.find("--inline-threshold"); threshold != args.end() and threshold->second + 1 < arg_count)
+    {
+        auto parsed = parse_unsigned(argv[threshold->second + 1]);
+        if (!parsed)
+        {
+            debug::logger.builder(debug::logging::level::error) << "Invalid inline threshold '" << argv[threshold->second + 1] << "'!" << debug::logging::logbuilder::end;
+            return 1;
+        }
+        options.inline_threshold = *parsed;
+    }
+    if (args.find("--time-passes") != args.end())
+    {
+        options.time_passes = true;
+        if (level == args.end())
+        {
+            debug::logger.set_level(debug::logging::level::info);
+        }
+    }
+    std::optional<oops_bcode_compiler::profile::profile> profile;
+    if (auto profile_use = args.find("--profile-use"); profile_use != args.end())
+    {
+        if (profile_use->second + 1 >= arg_count)
+        {
+            debug::logger.builder(debug::logging::level::error) << "No profile argument provided!" << debug::logging::logbuilder::end;
+            return 1;
+        }
+        auto loaded = oops_bcode_compiler::profile::load(argv[profile_use->second + 1]);
+        if (std::holds_alternative<std::vector<std::string>>(loaded))
+        {
+            auto &errors = std::get<std::vector<std::string>>(loaded);
+            for (auto &error : errors)
+            {
+                debug::logger.builder(debug::logging::level::error) << error << debug::logging::logbuilder::end;
+            }
+            return errors.size();
+        }
+        profile = std::move(std::get<oops_bcode_compiler::profile::profile>(loaded));
+        options.profile = &*profile;
+    }
+    std::optional<oops_bcode_compiler::hierarchy::index> hierarchy;
+    if (auto hierarchy_use = args.find("--hierarchy"); hierarchy_use != args.end())
+    {
+        if (hierarchy_use->second + 1 >= arg_count)
+        {
+            debug::logger.builder(debug::logging::level::error) << "No class hierarchy argument provided!" << debug::logging::logbuilder::end;
+            return 1;
+        }
+        auto loaded = oops_bcode_compiler::hierarchy::load(argv[hierarchy_use->second + 1]);
+        if (std::holds_alternative<std::vector<std::string>>(loaded))
+        {
+            auto &errors = std::get<std::vector<std::string>>(loaded);
+            for (auto &error : errors)
+            {
+                debug::logger.builder(debug::logging::level::error) << error << debug::logging::logbuilder::end;
+            }
+            return errors.size();
+        }
+        hierarchy = std::move(std::get<oops_bcode_compiler::hierarchy::index>(loaded));
+        options.hierarchy = &*hierarchy;
+    }
+    auto result = compile_standalone(argv[to_compile->second + 1], build_path, options);
+    if (options.time_passes)
+    {
+        oops_bcode_compiler::optimizer::report_pass_timings();
+    }
+    if (options.pair_histogram)
+    {
+        oops_bcode_compiler::compiler::report_pair_histogram();
+    }
+    return result;
 }
@@ -0,0 +1,210 @@
+#include "branches.h"
+
+#include <algorithm>
+
+#include "dataflow.h"
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    //Ball-Larus hit rates, expressed as the chance the branch is taken
+    constexpr double loop_back_edge = 0.88;
+    constexpr double loop_exit = 0.2;
+    constexpr double null_compare = 0.1;
+    constexpr double opcode_compare = 0.16;
+    constexpr double return_path = 0.28;
+    //Caps the trip count assumed for loops whose back edges are almost always taken
+    constexpr double max_cyclic_probability = 0.99;
+
+    //Dempster-Shafer combination of two independent predictions
+    double combine(double p, double q)
+    {
+        return p * q / (p * q + (1 - p) * (1 - q));
+    }
+
+    //Blocks that do nothing but return lead away from the hot path
+    bool only_returns(const oops_bcode_compiler::optimizer::block &blk)
+    {
+        return !blk.instructions.empty() and blk.instructions.back().itype == ktype::RET and blk.instructions.size() <= 2;
+    }
+
+    double opcode_heuristic(const oops_bcode_compiler::optimizer::instruction &branch)
+    {
+        if (branch.operands.size() < 3)
+        {
+            return 0.5;
+        }
+        auto &rhs = branch.operands[2];
+        switch (branch.itype)
+        {
+        case ktype::BEQI:
+            return rhs == "null" ? null_compare : opcode_compare;
+        case ktype::BNEQI:
+            return rhs == "null" ? 1 - null_compare : 1 - opcode_compare;
+        case ktype::BEQ:
+            return opcode_compare;
+        case ktype::BNEQ:
+            return 1 - opcode_compare;
+        case ktype::BLTI:
+        case ktype::BLEI:
+            return rhs == "0" ? opcode_compare : 0.5;
+        case ktype::BGTI:
+        case ktype::BGEI:
+            return rhs == "0" ? 1 - opcode_compare : 0.5;
+        default:
+            return 0.5;
+        }
+    }
+} // namespace
+
+double oops_bcode_compiler::optimizer::edge_probability(const function &fn, std::size_t from, std::size_t to)
+{
+    auto &blk = fn.blocks[from];
+    //Every entry of a jump table, the default included, is taken as often as the others
+    if (!blk.instructions.empty() and blk.instructions.back().itype == ktype::BADR)
+    {
+        auto labels = keywords::label_operands(ktype::BADR, blk.instructions.back().operands.size());
+        auto hits = std::count_if(labels.begin(), labels.end(), [&](std::size_t idx) { return blk.instructions.back().operands[idx] == fn.blocks[to].label; });
+        return static_cast<double>(hits) / labels.size();
+    }
+    if (blk.instructions.empty() or !keywords::is_conditional_branch(blk.instructions.back().itype) or blk.fallthrough.empty())
+    {
+        return 1;
+    }
+    return blk.instructions.back().operands[0] == fn.blocks[to].label ? blk.taken_probability : 1 - blk.taken_probability;
+}
+
+void oops_bcode_compiler::optimizer::estimate_block_frequencies(function &fn)
+{
+    auto idom = optimizer::compute_dominators(fn);
+    auto loops = optimizer::find_loops(fn, idom);
+    auto rpo = optimizer::reverse_postorder(fn);
+    std::vector<const loop *> header_of(fn.blocks.size(), nullptr);
+    for (auto &l : loops)
+    {
+        header_of[l.header] = &l;
+    }
+    //Chance of coming back around each loop header, filled inner loops first
+    std::vector<double> cyclic(fn.blocks.size(), 0);
+    std::vector<double> frequency(fn.blocks.size(), 0);
+    //Wu-Larus propagation over the blocks of a loop (or the whole function), starting from head with frequency 1
+    auto propagate = [&](std::size_t head, const loop *region) {
+        for (auto current : rpo)
+        {
+            if (region and !region->contains(current))
+            {
+                continue;
+            }
+            double incoming = current == head ? 1 : 0;
+            for (auto pred : fn.blocks[current].predecessors)
+            {
+                bool back_edge = header_of[current] and header_of[current]->contains(pred);
+                if (!back_edge and (!region or region->contains(pred)))
+                {
+                    incoming += frequency[pred] * optimizer::edge_probability(fn, pred, current);
+                }
+            }
+            if (header_of[current] and header_of[current] != region)
+            {
+                incoming /= 1 - std::min(cyclic[current], ::max_cyclic_probability);
+            }
+            frequency[current] = incoming;
+        }
+    };
+    std::vector<const loop *> inner_first;
+    for (auto &l : loops)
+    {
+        inner_first.push_back(&l);
+    }
+    std::stable_sort(inner_first.begin(), inner_first.end(), [](const loop *a, const loop *b) { return a->blocks.size() < b->blocks.size(); });
+    for (auto l : inner_first)
+    {
+        propagate(l->header, l);
+        for (auto latch : l->latches)
+        {
+            cyclic[l->header] += frequency[latch] * optimizer::edge_probability(fn, latch, l->header);
+        }
+    }
+    std::fill(frequency.begin(), frequency.end(), 0);
+    propagate(0, nullptr);
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        fn.blocks[i].frequency = frequency[i];
+    }
+}
+
+void oops_bcode_compiler::optimizer::estimate_branch_probabilities(function &fn, const compiler::options &)
+{
+    auto idom = optimizer::compute_dominators(fn);
+    auto loops = optimizer::find_loops(fn, idom);
+    auto indexes = optimizer::block_indexes(fn);
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        auto &blk = fn.blocks[i];
+        if (blk.instructions.empty() or !keywords::is_conditional_branch(blk.instructions.back().itype) or blk.fallthrough.empty())
+        {
+            continue;
+        }
+        auto &branch = blk.instructions.back();
+        auto taken = indexes.find(branch.operands[0]);
+        auto fallthrough = indexes.find(blk.fallthrough);
+        if (taken == indexes.end() or fallthrough == indexes.end())
+        {
+            continue;
+        }
+        if (fn.profile)
+        {
+            if (auto counts = fn.profile->branches.find(branch.origin); counts != fn.profile->branches.end() and counts->second.taken + counts->second.not_taken > 0)
+            {
+                auto taken_count = branch.inverted ? counts->second.not_taken : counts->second.taken;
+                blk.taken_probability = static_cast<double>(taken_count) / (counts->second.taken + counts->second.not_taken);
+                logger.builder(logging::level::debug) << "Profiled branch to " << branch.operands[0] << " at line " << branch.line_number << " taken with probability " << blk.taken_probability << logging::logbuilder::end;
+                continue;
+            }
+        }
+        double probability = 0.5;
+        for (auto &l : loops)
+        {
+            if (!l.contains(i))
+            {
+                continue;
+            }
+            if (taken->second == l.header)
+            {
+                probability = ::combine(probability, ::loop_back_edge);
+            }
+            else if (fallthrough->second == l.header)
+            {
+                probability = ::combine(probability, 1 - ::loop_back_edge);
+            }
+            else if (!l.contains(taken->second) and l.contains(fallthrough->second))
+            {
+                probability = ::combine(probability, ::loop_exit);
+            }
+            else if (l.contains(taken->second) and !l.contains(fallthrough->second))
+            {
+                probability = ::combine(probability, 1 - ::loop_exit);
+            }
+        }
+        probability = ::combine(probability, ::opcode_heuristic(branch));
+        bool taken_returns = ::only_returns(fn.blocks[taken->second]);
+        bool fallthrough_returns = ::only_returns(fn.blocks[fallthrough->second]);
+        if (taken_returns and !fallthrough_returns)
+        {
+            probability = ::combine(probability, ::return_path);
+        }
+        else if (fallthrough_returns and !taken_returns)
+        {
+            probability = ::combine(probability, 1 - ::return_path);
+        }
+        blk.taken_probability = probability;
+        logger.builder(logging::level::debug) << "Predicting branch to " << branch.operands[0] << " at line " << branch.line_number << " taken with probability " << probability << logging::logbuilder::end;
+    }
+    optimizer::estimate_block_frequencies(fn);
+}
@@ -0,0 +1,22 @@
+#ifndef OPTIMIZER_BRANCHES
+#define OPTIMIZER_BRANCHES
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Predicts each conditional branch from the function's profile when it has counts for it, otherwise
+        //with Ball-Larus style heuristics, and derives block frequencies
+        void estimate_branch_probabilities(function &fn, const compiler::options &options);
+
+        double edge_probability(const function &fn, std::size_t from, std::size_t to);
+
+        //Propagates frequencies from the entry block using the current branch probabilities
+        void estimate_block_frequencies(function &fn);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_BRANCHES */
@@ -0,0 +1,318 @@
+#include "checks.h"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <set>
+
+#include "dataflow.h"
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    typedef std::set<std::pair<std::string, std::string>> relation;
+
+    //What is known about the locals at a program point; every fact holds on all paths reaching it
+    struct facts
+    {
+        std::set<std::string> nonnull;
+        std::set<std::string> nonnegative;
+        //(length, array): the int local holds the length of the array local
+        relation lengths;
+        //(index, array): the int local is less than the length of the array local
+        relation below;
+
+        bool operator==(const facts &other) const
+        {
+            return this->nonnull == other.nonnull and this->nonnegative == other.nonnegative and this->lengths == other.lengths and this->below == other.below;
+        }
+
+        void intersect(const facts &other)
+        {
+            auto meet = [](auto &mine, const auto &theirs) {
+                std::remove_reference_t<decltype(mine)> kept;
+                std::set_intersection(mine.begin(), mine.end(), theirs.begin(), theirs.end(), std::inserter(kept, kept.end()));
+                mine = std::move(kept);
+            };
+            meet(this->nonnull, other.nonnull);
+            meet(this->nonnegative, other.nonnegative);
+            meet(this->lengths, other.lengths);
+            meet(this->below, other.below);
+        }
+
+        //Forgets everything about name, which is about to be overwritten
+        void kill(const std::string &name)
+        {
+            this->nonnull.erase(name);
+            this->nonnegative.erase(name);
+            for (auto rel : {&this->lengths, &this->below})
+            {
+                for (auto it = rel->begin(); it != rel->end();)
+                {
+                    it = it->first == name or it->second == name ? rel->erase(it) : std::next(it);
+                }
+            }
+        }
+
+        //Every fact about from also holds for to
+        void copy(const std::string &from, const std::string &to)
+        {
+            if (this->nonnull.count(from))
+            {
+                this->nonnull.insert(to);
+            }
+            if (this->nonnegative.count(from))
+            {
+                this->nonnegative.insert(to);
+            }
+            for (auto rel : {&this->lengths, &this->below})
+            {
+                relation copied;
+                for (auto &fact : *rel)
+                {
+                    if (fact.first == from)
+                    {
+                        copied.insert({to, fact.second});
+                    }
+                    if (fact.second == from)
+                    {
+                        copied.insert({fact.first, to});
+                    }
+                }
+                rel->insert(copied.begin(), copied.end());
+            }
+        }
+
+        bool below_some_length(const std::string &index) const
+        {
+            return std::any_of(this->below.begin(), this->below.end(), [&](const std::pair<std::string, std::string> &fact) { return fact.first == index; });
+        }
+
+        //lo < hi if strict, else lo <= hi
+        void learn_less(const std::string &lo, const std::string &hi, bool strict)
+        {
+            if (strict)
+            {
+                relation learned;
+                for (auto &fact : this->lengths)
+                {
+                    if (fact.first == hi)
+                    {
+                        learned.insert({lo, fact.second});
+                    }
+                }
+                this->below.insert(learned.begin(), learned.end());
+            }
+            if (this->nonnegative.count(lo))
+            {
+                this->nonnegative.insert(hi);
+            }
+        }
+
+        //name >= bound
+        void learn_at_least(const std::string &name, std::int64_t bound)
+        {
+            if (bound >= 0)
+            {
+                this->nonnegative.insert(name);
+            }
+        }
+    };
+
+    //Array and index operands of an array access, in that order
+    std::optional<std::pair<std::size_t, std::size_t>> access_operands(ktype kw)
+    {
+        switch (kw)
+        {
+        case ktype::CALD:
+        case ktype::SALD:
+        case ktype::ALD:
+            return std::pair<std::size_t, std::size_t>{1, 2};
+        case ktype::CASR:
+        case ktype::SASR:
+        case ktype::ASR:
+            return std::pair<std::size_t, std::size_t>{0, 2};
+        default:
+            return {};
+        }
+    }
+
+    //Marks the checks of an array access that known already proves
+    void annotate(oops_bcode_compiler::optimizer::instruction &instr, const ::facts &known)
+    {
+        if (auto access = ::access_operands(instr.itype))
+        {
+            auto &array = instr.operands[access->first], &index = instr.operands[access->second];
+            instr.proven_nonnull = known.nonnull.count(array);
+            instr.proven_in_bounds = known.nonnegative.count(index) and known.below.count({index, array});
+        }
+    }
+
+    //Steps known over instr
+    void transfer(const std::unordered_map<std::string, std::uint8_t> &types, const oops_bcode_compiler::optimizer::instruction &instr, ::facts &known)
+    {
+        auto is_int = [&](const std::string &name) {
+            auto type = types.find(name);
+            return type != types.end() and type->second == 2;
+        };
+        if (auto access = ::access_operands(instr.itype))
+        {
+            auto &array = instr.operands[access->first], &index = instr.operands[access->second];
+            //Had either check failed the access would have thrown, so both hold afterwards
+            known.nonnull.insert(array);
+            known.nonnegative.insert(index);
+            known.below.insert({index, array});
+        }
+        if (!oops_bcode_compiler::keywords::defines_first_operand(instr.itype))
+        {
+            return;
+        }
+        auto &dest = instr.operands[0];
+        switch (instr.itype)
+        {
+        case ktype::VNEW:
+            known.kill(dest);
+            known.nonnull.insert(dest);
+            break;
+        case ktype::ANEW:
+            known.kill(dest);
+            known.nonnull.insert(dest);
+            //A negative length throws, so the new array is exactly that long
+            known.nonnegative.insert(instr.operands[2]);
+            known.lengths.insert({instr.operands[2], dest});
+            break;
+        case ktype::ALEN:
+            known.kill(dest);
+            known.nonnull.insert(instr.operands[1]);
+            known.nonnegative.insert(dest);
+            known.lengths.insert({dest, instr.operands[1]});
+            break;
+        case ktype::MOV:
+            if (dest != instr.operands[1])
+            {
+                known.kill(dest);
+                known.copy(instr.operands[1], dest);
+            }
+            break;
+        case ktype::LI:
+        {
+            known.kill(dest);
+            auto imm = oops_bcode_compiler::optimizer::parse_immediate(instr.operands[1]);
+            if (is_int(dest) and imm)
+            {
+                known.learn_at_least(dest, *imm);
+            }
+            break;
+        }
+        case ktype::ADDI:
+        {
+            //Only the induction step i + 1 after i < length, which cannot overflow, stays non-negative
+            auto imm = oops_bcode_compiler::optimizer::parse_immediate(instr.operands[2]);
+            auto &src = instr.operands[1];
+            bool nonnegative = is_int(dest) and imm and known.nonnegative.count(src) and (*imm == 0 or (*imm == 1 and known.below_some_length(src)));
+            known.kill(dest);
+            if (nonnegative)
+            {
+                known.nonnegative.insert(dest);
+            }
+            break;
+        }
+        default:
+            known.kill(dest);
+            break;
+        }
+    }
+
+    //What the conditional branch ending a block adds on its taken or fallthrough edge
+    void learn_from_branch(const std::unordered_map<std::string, std::uint8_t> &types, const oops_bcode_compiler::optimizer::instruction &branch, bool taken, ::facts &known)
+    {
+        auto type = types.find(branch.operands[1]);
+        if (type == types.end())
+        {
+            return;
+        }
+        auto &lhs = branch.operands[1], &rhs = branch.operands[2];
+        if (type->second == 6)
+        {
+            if (rhs == "null" and ((branch.itype == ktype::BNEQI and taken) or (branch.itype == ktype::BEQI and !taken)))
+            {
+                known.nonnull.insert(lhs);
+            }
+            return;
+        }
+        if (type->second != 2)
+        {
+            return;
+        }
+        switch (branch.itype)
+        {
+        case ktype::BLT:
+            taken ? known.learn_less(lhs, rhs, true) : known.learn_less(rhs, lhs, false);
+            break;
+        case ktype::BGE:
+            taken ? known.learn_less(rhs, lhs, false) : known.learn_less(lhs, rhs, true);
+            break;
+        case ktype::BGT:
+            taken ? known.learn_less(rhs, lhs, true) : known.learn_less(lhs, rhs, false);
+            break;
+        case ktype::BLE:
+            taken ? known.learn_less(lhs, rhs, false) : known.learn_less(rhs, lhs, true);
+            break;
+        case ktype::BGEI:
+        case ktype::BLTI:
+        case ktype::BGTI:
+        case ktype::BLEI:
+        {
+            auto imm = oops_bcode_compiler::optimizer::parse_immediate(rhs);
+            if (!imm)
+            {
+                break;
+            }
+            //Reduce every case to lhs >= bound on the edge where it holds
+            bool greater = branch.itype == ktype::BGEI or branch.itype == ktype::BGTI;
+            bool strict = branch.itype == ktype::BGTI or branch.itype == ktype::BLTI;
+            if (greater == taken)
+            {
+                known.learn_at_least(lhs, *imm + (strict == taken));
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::prove_safe_accesses(function &fn, const compiler::options &)
+{
+    auto types = optimizer::slot_types(fn);
+    auto entry = optimizer::solve_forward<::facts>(
+        fn, [&](const instruction &instr, ::facts &known) { ::transfer(types, instr, known); },
+        [&](const instruction &branch, bool taken, ::facts &known) { ::learn_from_branch(types, branch, taken, known); });
+    std::size_t proven = 0;
+    for (std::size_t idx = 0; idx < fn.blocks.size(); idx++)
+    {
+        if (!entry[idx])
+        {
+            continue;
+        }
+        auto known = *entry[idx];
+        for (auto &instr : fn.blocks[idx].instructions)
+        {
+            ::annotate(instr, known);
+            ::transfer(types, instr, known);
+            if (instr.proven_nonnull or instr.proven_in_bounds)
+            {
+                logger.builder(logging::level::debug) << "Access at line " << instr.line_number << " needs" << (instr.proven_nonnull ? " no" : " a") << " null check and" << (instr.proven_in_bounds ? " no" : " a") << " bounds check" << logging::logbuilder::end;
+                proven++;
+            }
+        }
+    }
+    logger.builder(logging::level::debug) << "Removed checks from " << proven << " array accesses in " << fn.name << logging::logbuilder::end;
+}
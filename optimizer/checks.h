@@ -0,0 +1,18 @@
+#ifndef OPTIMIZER_CHECKS
+#define OPTIMIZER_CHECKS
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Marks array loads and stores whose null check or bounds check can never fail.
+        //References are non-null after VNEW, ANEW, a taken BNEQI null or an earlier access; an index is in bounds
+        //once it is known non-negative and has been compared below an ALEN or ANEW length of the same array.
+        void prove_safe_accesses(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_CHECKS */
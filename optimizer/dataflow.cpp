@@ -0,0 +1,298 @@
+#include "dataflow.h"
+
+#include <algorithm>
+#include <map>
+
+#include "../instructions/semantics.h"
+
+using namespace oops_bcode_compiler::optimizer;
+
+std::vector<std::string> oops_bcode_compiler::optimizer::uses(const instruction &instr)
+{
+    std::vector<std::string> used;
+    for (auto idx : keywords::use_operands(instr.itype, instr.operands.size()))
+    {
+        if (idx < instr.operands.size())
+        {
+            used.push_back(instr.operands[idx]);
+        }
+    }
+    return used;
+}
+
+void oops_bcode_compiler::optimizer::transfer_liveness(const instruction &instr, variable_set &live)
+{
+    if (keywords::defines_first_operand(instr.itype) and !instr.operands.empty())
+    {
+        live.erase(instr.operands[0]);
+    }
+    for (auto &used : optimizer::uses(instr))
+    {
+        live.insert(used);
+    }
+}
+
+liveness oops_bcode_compiler::optimizer::compute_liveness(const function &fn)
+{
+    liveness result;
+    result.live_in.resize(fn.blocks.size());
+    result.live_out.resize(fn.blocks.size());
+    bool changed;
+    do
+    {
+        changed = false;
+        for (std::size_t i = fn.blocks.size(); i-- > 0;)
+        {
+            variable_set out;
+            for (auto succ : fn.blocks[i].successors)
+            {
+                out.insert(result.live_in[succ].begin(), result.live_in[succ].end());
+            }
+            variable_set in = out;
+            for (auto instr = fn.blocks[i].instructions.rbegin(); instr != fn.blocks[i].instructions.rend(); ++instr)
+            {
+                optimizer::transfer_liveness(*instr, in);
+            }
+            if (in != result.live_in[i] or out != result.live_out[i])
+            {
+                result.live_in[i] = std::move(in);
+                result.live_out[i] = std::move(out);
+                changed = true;
+            }
+        }
+    } while (changed);
+    return result;
+}
+
+liveness oops_bcode_compiler::optimizer::compute_liveness(const std::vector<instruction> &body, const std::vector<handler> &handlers)
+{
+    std::unordered_map<std::string, std::size_t> labels;
+    for (std::size_t i = 0; i < body.size(); i++)
+    {
+        if (body[i].itype == keywords::keyword::LBL)
+        {
+            labels[body[i].operands[0]] = i;
+        }
+    }
+    liveness result;
+    result.live_in.resize(body.size());
+    result.live_out.resize(body.size());
+    bool changed;
+    do
+    {
+        changed = false;
+        for (std::size_t i = body.size(); i-- > 0;)
+        {
+            variable_set out;
+            if (i + 1 < body.size() and !keywords::ends_flow(body[i].itype))
+            {
+                out = result.live_in[i + 1];
+            }
+            for (auto idx : keywords::label_operands(body[i].itype, body[i].operands.size()))
+            {
+                if (auto target = labels.find(body[i].operands[idx]); target != labels.end())
+                {
+                    out.insert(result.live_in[target->second].begin(), result.live_in[target->second].end());
+                }
+            }
+            //The instruction may throw before it has any effect, and a call may collect before it throws,
+            //so what its handlers read is live on both sides of it
+            variable_set caught;
+            for (auto &handler : handlers)
+            {
+                auto begin = labels.find(handler.begin), end = labels.find(handler.end), target = labels.find(handler.target);
+                if (begin == labels.end() or end == labels.end() or target == labels.end() or i < begin->second or i >= end->second)
+                {
+                    continue;
+                }
+                for (auto &name : result.live_in[target->second])
+                {
+                    if (name != handler.local)
+                    {
+                        caught.insert(name);
+                    }
+                }
+            }
+            out.insert(caught.begin(), caught.end());
+            variable_set in = out;
+            optimizer::transfer_liveness(body[i], in);
+            in.insert(caught.begin(), caught.end());
+            if (in != result.live_in[i] or out != result.live_out[i])
+            {
+                result.live_in[i] = std::move(in);
+                result.live_out[i] = std::move(out);
+                changed = true;
+            }
+        }
+    } while (changed);
+    return result;
+}
+
+std::vector<std::size_t> oops_bcode_compiler::optimizer::reverse_postorder(const function &fn)
+{
+    std::vector<std::size_t> order;
+    if (fn.blocks.empty())
+    {
+        return order;
+    }
+    std::vector<bool> visited(fn.blocks.size(), false);
+    //Iterative DFS keeping the next successor to visit per stack frame
+    std::vector<std::pair<std::size_t, std::size_t>> stack = {{0, 0}};
+    visited[0] = true;
+    while (!stack.empty())
+    {
+        auto &[current, next] = stack.back();
+        if (next < fn.blocks[current].successors.size())
+        {
+            auto succ = fn.blocks[current].successors[next++];
+            if (!visited[succ])
+            {
+                visited[succ] = true;
+                stack.push_back({succ, 0});
+            }
+            continue;
+        }
+        order.push_back(current);
+        stack.pop_back();
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+std::vector<std::size_t> oops_bcode_compiler::optimizer::compute_dominators(const function &fn)
+{
+    constexpr auto undefined = ~static_cast<std::size_t>(0);
+    std::vector<std::size_t> idom(fn.blocks.size(), undefined);
+    auto order = optimizer::reverse_postorder(fn);
+    std::vector<std::size_t> rpo_index(fn.blocks.size(), undefined);
+    for (std::size_t i = 0; i < order.size(); i++)
+    {
+        rpo_index[order[i]] = i;
+    }
+    if (order.empty())
+    {
+        return idom;
+    }
+    idom[order[0]] = order[0];
+    //Cooper, Harvey and Kennedy's iterative algorithm
+    bool changed;
+    do
+    {
+        changed = false;
+        for (std::size_t i = 1; i < order.size(); i++)
+        {
+            auto blk = order[i];
+            auto new_idom = undefined;
+            for (auto pred : fn.blocks[blk].predecessors)
+            {
+                if (idom[pred] == undefined)
+                {
+                    continue;
+                }
+                if (new_idom == undefined)
+                {
+                    new_idom = pred;
+                    continue;
+                }
+                auto a = pred, b = new_idom;
+                while (a != b)
+                {
+                    while (rpo_index[a] > rpo_index[b])
+                    {
+                        a = idom[a];
+                    }
+                    while (rpo_index[b] > rpo_index[a])
+                    {
+                        b = idom[b];
+                    }
+                }
+                new_idom = a;
+            }
+            if (idom[blk] != new_idom)
+            {
+                idom[blk] = new_idom;
+                changed = true;
+            }
+        }
+    } while (changed);
+    return idom;
+}
+
+bool oops_bcode_compiler::optimizer::dominates(const std::vector<std::size_t> &idom, std::size_t dominator, std::size_t dominated)
+{
+    if (idom[dominated] == ~static_cast<std::size_t>(0))
+    {
+        return false;
+    }
+    while (dominated != dominator)
+    {
+        if (idom[dominated] == dominated)
+        {
+            return false;
+        }
+        dominated = idom[dominated];
+    }
+    return true;
+}
+
+bool oops_bcode_compiler::optimizer::loop::contains(std::size_t blk) const
+{
+    return std::binary_search(this->blocks.begin(), this->blocks.end(), blk);
+}
+
+std::vector<loop> oops_bcode_compiler::optimizer::find_loops(const function &fn, const std::vector<std::size_t> &idom)
+{
+    std::map<std::size_t, loop> loops;
+    for (std::size_t latch = 0; latch < fn.blocks.size(); latch++)
+    {
+        for (auto header : fn.blocks[latch].successors)
+        {
+            if (!optimizer::dominates(idom, header, latch))
+            {
+                continue;
+            }
+            auto &lp = loops[header];
+            lp.header = header;
+            lp.latches.push_back(latch);
+            std::vector<bool> in_loop(fn.blocks.size(), false);
+            for (auto blk : lp.blocks)
+            {
+                in_loop[blk] = true;
+            }
+            in_loop[header] = true;
+            std::vector<std::size_t> worklist;
+            if (!in_loop[latch])
+            {
+                in_loop[latch] = true;
+                worklist.push_back(latch);
+            }
+            while (!worklist.empty())
+            {
+                auto current = worklist.back();
+                worklist.pop_back();
+                for (auto pred : fn.blocks[current].predecessors)
+                {
+                    if (!in_loop[pred])
+                    {
+                        in_loop[pred] = true;
+                        worklist.push_back(pred);
+                    }
+                }
+            }
+            lp.blocks.clear();
+            for (std::size_t i = 0; i < in_loop.size(); i++)
+            {
+                if (in_loop[i])
+                {
+                    lp.blocks.push_back(i);
+                }
+            }
+        }
+    }
+    std::vector<loop> result;
+    for (auto &entry : loops)
+    {
+        result.push_back(std::move(entry.second));
+    }
+    return result;
+}
@@ -0,0 +1,129 @@
+#ifndef OPTIMIZER_DATAFLOW
+#define OPTIMIZER_DATAFLOW
+
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ir.h"
+#include "../instructions/semantics.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        typedef std::unordered_set<std::string> variable_set;
+
+        struct liveness
+        {
+            std::vector<variable_set> live_in;
+            std::vector<variable_set> live_out;
+        };
+
+        //Backward may-liveness of local variables, indexed like fn.blocks
+        liveness compute_liveness(const function &fn);
+
+        //Per-instruction liveness of a linearized body, indexed like body; LBL instructions name the branch targets.
+        //Whatever a handler reads, other than the local it catches into, is live throughout its protected range.
+        liveness compute_liveness(const std::vector<instruction> &body, const std::vector<handler> &handlers = {});
+
+        //Steps a live set backwards over a single instruction
+        void transfer_liveness(const instruction &instr, variable_set &live);
+
+        std::vector<std::string> uses(const instruction &instr);
+
+        std::vector<std::size_t> reverse_postorder(const function &fn);
+
+        //Immediate dominator of each block; the entry block is its own dominator and unreachable blocks map to npos
+        std::vector<std::size_t> compute_dominators(const function &fn);
+
+        bool dominates(const std::vector<std::size_t> &idom, std::size_t dominator, std::size_t dominated);
+
+        struct loop
+        {
+            std::size_t header;
+            //Sorted indexes of every block in the natural loop, header included
+            std::vector<std::size_t> blocks;
+            std::vector<std::size_t> latches;
+
+            bool contains(std::size_t blk) const;
+        };
+
+        //Natural loops keyed by header, from the back edges of the CFG
+        std::vector<loop> find_loops(const function &fn, const std::vector<std::size_t> &idom);
+
+        //Forward must-dataflow: the facts holding on entry to each block on every path reaching it, indexed like fn.blocks.
+        //facts needs operator== and intersect, which keeps only what both sides know. transfer(instr, known) steps known
+        //over one instruction, and learn(branch, taken, known) adds what a conditional branch implies along one edge.
+        //Blocks control never reaches are left empty.
+        template <typename facts, typename transfer_fn, typename learn_fn>
+        std::vector<std::optional<facts>> solve_forward(const function &fn, transfer_fn transfer, learn_fn learn)
+        {
+            auto indexes = optimizer::block_indexes(fn);
+            auto order = optimizer::reverse_postorder(fn);
+            //Unreached blocks have no entry yet, which acts as the set of every fact
+            std::vector<std::optional<facts>> entry(fn.blocks.size());
+            entry[0] = facts{};
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                for (auto idx : order)
+                {
+                    if (!entry[idx])
+                    {
+                        continue;
+                    }
+                    auto &blk = fn.blocks[idx];
+                    auto known = *entry[idx];
+                    for (auto &instr : blk.instructions)
+                    {
+                        transfer(instr, known);
+                    }
+                    std::optional<std::size_t> taken, fallthrough;
+                    if (!blk.instructions.empty() and keywords::is_conditional_branch(blk.instructions.back().itype))
+                    {
+                        taken = indexes[blk.instructions.back().operands[0]];
+                    }
+                    if (!blk.fallthrough.empty())
+                    {
+                        fallthrough = indexes[blk.fallthrough];
+                    }
+                    for (auto succ : blk.successors)
+                    {
+                        //The entry block is also reached from outside the method with nothing known
+                        if (succ == 0)
+                        {
+                            continue;
+                        }
+                        auto along = known;
+                        //A branch to its own fallthrough block learns nothing either way
+                        if (taken and fallthrough and *taken != *fallthrough and (succ == *taken or succ == *fallthrough))
+                        {
+                            learn(blk.instructions.back(), succ == *taken, along);
+                        }
+                        auto &target = entry[succ];
+                        if (!target)
+                        {
+                            target = std::move(along);
+                            changed = true;
+                            continue;
+                        }
+                        auto met = *target;
+                        met.intersect(along);
+                        if (!(met == *target))
+                        {
+                            target = std::move(met);
+                            changed = true;
+                        }
+                    }
+                }
+            }
+            return entry;
+        }
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_DATAFLOW */
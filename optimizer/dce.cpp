@@ -0,0 +1,173 @@
+#include "dce.h"
+
+#include <unordered_set>
+
+#include "dataflow.h"
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    bool remove_unreachable_blocks(function &fn)
+    {
+        std::vector<bool> reached(fn.blocks.size(), false);
+        std::vector<std::size_t> worklist = {0};
+        reached[0] = true;
+        while (!worklist.empty())
+        {
+            auto current = worklist.back();
+            worklist.pop_back();
+            for (auto succ : fn.blocks[current].successors)
+            {
+                if (!reached[succ])
+                {
+                    reached[succ] = true;
+                    worklist.push_back(succ);
+                }
+            }
+        }
+        std::vector<oops_bcode_compiler::optimizer::block> kept;
+        kept.reserve(fn.blocks.size());
+        for (std::size_t i = 0; i < fn.blocks.size(); i++)
+        {
+            if (reached[i])
+            {
+                kept.push_back(std::move(fn.blocks[i]));
+            }
+            else
+            {
+                logger.builder(logging::level::debug) << "Removing unreachable block " << fn.blocks[i].label << " with " << fn.blocks[i].instructions.size() << " instructions" << logging::logbuilder::end;
+            }
+        }
+        bool changed = kept.size() != fn.blocks.size();
+        fn.blocks = std::move(kept);
+        if (changed)
+        {
+            oops_bcode_compiler::optimizer::rebuild_cfg(fn);
+        }
+        return changed;
+    }
+
+    //Turns branches whose target is also the fallthrough block into plain fallthrough
+    bool simplify_branches(function &fn)
+    {
+        bool changed = false;
+        for (std::size_t i = 0; i < fn.blocks.size(); i++)
+        {
+            auto &blk = fn.blocks[i];
+            if (blk.instructions.empty() or !oops_bcode_compiler::keywords::is_branch(blk.instructions.back().itype))
+            {
+                continue;
+            }
+            auto &target = blk.instructions.back().operands[0];
+            if (blk.instructions.back().itype == ktype::BU)
+            {
+                if (i + 1 < fn.blocks.size() and fn.blocks[i + 1].label == target)
+                {
+                    blk.fallthrough = target;
+                    blk.instructions.pop_back();
+                    changed = true;
+                }
+            }
+            else if (target == blk.fallthrough)
+            {
+                blk.instructions.pop_back();
+                changed = true;
+            }
+        }
+        if (changed)
+        {
+            oops_bcode_compiler::optimizer::rebuild_cfg(fn);
+        }
+        return changed;
+    }
+
+    bool remove_dead_values(function &fn)
+    {
+        auto live = oops_bcode_compiler::optimizer::compute_liveness(fn);
+        bool changed = false;
+        for (std::size_t i = 0; i < fn.blocks.size(); i++)
+        {
+            auto &instructions = fn.blocks[i].instructions;
+            auto current = live.live_out[i];
+            std::vector<bool> dead(instructions.size(), false);
+            for (std::size_t j = instructions.size(); j-- > 0;)
+            {
+                auto &instr = instructions[j];
+                if (oops_bcode_compiler::keywords::is_pure(instr) and current.find(instr.operands[0]) == current.end())
+                {
+                    logger.builder(logging::level::debug) << "Removing dead " << oops_bcode_compiler::keywords::keyword_to_string[static_cast<unsigned>(instr.itype)] << " to " << instr.operands[0] << " at line " << instr.line_number << logging::logbuilder::end;
+                    dead[j] = true;
+                    changed = true;
+                    continue;
+                }
+                oops_bcode_compiler::optimizer::transfer_liveness(instr, current);
+            }
+            std::vector<oops_bcode_compiler::optimizer::instruction> kept;
+            kept.reserve(instructions.size());
+            for (std::size_t j = 0; j < instructions.size(); j++)
+            {
+                if (!dead[j])
+                {
+                    kept.push_back(std::move(instructions[j]));
+                }
+            }
+            instructions = std::move(kept);
+        }
+        return changed;
+    }
+
+    //Drops DEFs of locals nothing mentions anymore, freeing their stack slots
+    void remove_unused_locals(function &fn)
+    {
+        std::unordered_map<std::string, std::size_t> definitions;
+        for (auto &local : fn.locals)
+        {
+            definitions[local.name]++;
+        }
+        std::unordered_set<std::string> mentioned;
+        for (auto &blk : fn.blocks)
+        {
+            for (auto &instr : blk.instructions)
+            {
+                if (oops_bcode_compiler::keywords::defines_first_operand(instr.itype))
+                {
+                    mentioned.insert(instr.operands[0]);
+                }
+                for (auto &used : oops_bcode_compiler::optimizer::uses(instr))
+                {
+                    mentioned.insert(used);
+                }
+            }
+        }
+        std::vector<oops_bcode_compiler::optimizer::slot> kept;
+        for (auto &local : fn.locals)
+        {
+            //Leave malformed declarations alone so the compiler still reports them
+            if (definitions[local.name] == 1 and oops_bcode_compiler::optimizer::type_code(local.type_name) and mentioned.find(local.name) == mentioned.end())
+            {
+                logger.builder(logging::level::debug) << "Removing unused local " << local.name << logging::logbuilder::end;
+                continue;
+            }
+            kept.push_back(std::move(local));
+        }
+        fn.locals = std::move(kept);
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::eliminate_dead_code(function &fn, const compiler::options &)
+{
+    bool changed;
+    do
+    {
+        changed = ::remove_unreachable_blocks(fn);
+        changed |= ::simplify_branches(fn);
+        changed |= ::remove_dead_values(fn);
+    } while (changed);
+    ::remove_unused_locals(fn);
+}
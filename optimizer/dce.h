@@ -0,0 +1,16 @@
+#ifndef OPTIMIZER_DCE
+#define OPTIMIZER_DCE
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Removes unreachable blocks, redundant branches, dead pure instructions and unused locals
+        void eliminate_dead_code(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_DCE */
@@ -0,0 +1,189 @@
+#include "devirtualize.h"
+
+#include <iterator>
+#include <map>
+#include <optional>
+
+#include "dataflow.h"
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    struct receiver
+    {
+        std::string class_name;
+        //Set when the object is an instance of class_name itself rather than possibly of a subclass
+        bool exact;
+
+        bool operator==(const receiver &other) const
+        {
+            return this->class_name == other.class_name and this->exact == other.exact;
+        }
+    };
+
+    //What is known about the classes of reference locals; every fact holds on all paths reaching the point
+    struct facts
+    {
+        std::map<std::string, ::receiver> classes;
+        //Int locals holding the result of IOF, as the tested reference and class
+        std::map<std::string, std::pair<std::string, std::string>> tests;
+
+        bool operator==(const facts &other) const
+        {
+            return this->classes == other.classes and this->tests == other.tests;
+        }
+
+        void intersect(const facts &other)
+        {
+            for (auto it = this->classes.begin(); it != this->classes.end();)
+            {
+                auto theirs = other.classes.find(it->first);
+                if (theirs == other.classes.end() or theirs->second.class_name != it->second.class_name)
+                {
+                    it = this->classes.erase(it);
+                    continue;
+                }
+                it->second.exact = it->second.exact and theirs->second.exact;
+                ++it;
+            }
+            for (auto it = this->tests.begin(); it != this->tests.end();)
+            {
+                auto theirs = other.tests.find(it->first);
+                it = theirs == other.tests.end() or theirs->second != it->second ? this->tests.erase(it) : std::next(it);
+            }
+        }
+
+        //Drops the class of name and the IOF results it holds or was tested by, as name is about to be overwritten
+        void kill(const std::string &name)
+        {
+            this->classes.erase(name);
+            this->tests.erase(name);
+            for (auto it = this->tests.begin(); it != this->tests.end();)
+            {
+                it = it->second.first == name ? this->tests.erase(it) : std::next(it);
+            }
+        }
+    };
+
+    void transfer(const oops_bcode_compiler::optimizer::instruction &instr, ::facts &known)
+    {
+        if (!oops_bcode_compiler::keywords::defines_first_operand(instr.itype))
+        {
+            return;
+        }
+        auto &dest = instr.operands[0];
+        switch (instr.itype)
+        {
+        case ktype::VNEW:
+            known.kill(dest);
+            known.classes[dest] = {instr.operands[1], true};
+            break;
+        case ktype::IOF:
+            known.kill(dest);
+            if (instr.operands[1] != dest)
+            {
+                known.tests[dest] = {instr.operands[1], instr.operands[2]};
+            }
+            break;
+        case ktype::MOV:
+        {
+            auto &src = instr.operands[1];
+            if (src == dest)
+            {
+                break;
+            }
+            known.kill(dest);
+            if (auto cls = known.classes.find(src); cls != known.classes.end())
+            {
+                known.classes[dest] = cls->second;
+            }
+            if (auto test = known.tests.find(src); test != known.tests.end())
+            {
+                known.tests[dest] = test->second;
+            }
+            break;
+        }
+        default:
+            known.kill(dest);
+            break;
+        }
+    }
+
+    //A nonzero IOF result on this edge makes its reference an instance of the tested class
+    void learn_from_branch(const oops_bcode_compiler::optimizer::instruction &branch, bool taken, ::facts &known)
+    {
+        if ((branch.itype != ktype::BNEQI or !taken) and (branch.itype != ktype::BEQI or taken))
+        {
+            return;
+        }
+        auto test = known.tests.find(branch.operands[1]);
+        if (test == known.tests.end() or oops_bcode_compiler::optimizer::parse_immediate(branch.operands[2]) != 0)
+        {
+            return;
+        }
+        auto [tested, class_name] = test->second;
+        auto cls = known.classes.find(tested);
+        if (cls == known.classes.end() or !cls->second.exact)
+        {
+            known.classes[tested] = {class_name, false};
+        }
+    }
+
+    //The class the call at instr resolves in, if the receiver's possible classes all run the same method
+    std::optional<std::string> bound_class(const oops_bcode_compiler::optimizer::instruction &instr, const ::facts &known, const oops_bcode_compiler::hierarchy::index *hierarchy)
+    {
+        auto &name = instr.operands[2];
+        auto cls_split = name.find_last_of('.', name.find_first_of('('));
+        auto named = name.substr(0, cls_split), method = name.substr(cls_split + 1);
+        auto cls = known.classes.find(instr.operands[1]);
+        if (cls != known.classes.end() and cls->second.exact)
+        {
+            return cls->second.class_name;
+        }
+        if (!hierarchy)
+        {
+            return {};
+        }
+        //An IOF may have tested an interface or an unrelated class, so it only narrows the receiver below the named class
+        auto narrowest = cls != known.classes.end() and hierarchy->inherits(cls->second.class_name, named) ? cls->second.class_name : named;
+        if (hierarchy->classes.find(narrowest) == hierarchy->classes.end() or hierarchy->overridden_below(narrowest, method))
+        {
+            return {};
+        }
+        return narrowest;
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::devirtualize_calls(function &fn, const compiler::options &options)
+{
+    auto entry = optimizer::solve_forward<::facts>(fn, ::transfer, ::learn_from_branch);
+    for (std::size_t idx = 0; idx < fn.blocks.size(); idx++)
+    {
+        if (!entry[idx])
+        {
+            continue;
+        }
+        auto known = *entry[idx];
+        for (auto &instr : fn.blocks[idx].instructions)
+        {
+            if (instr.itype == ktype::VINV)
+            {
+                if (auto bound = ::bound_class(instr, known, options.hierarchy))
+                {
+                    auto &name = instr.operands[2];
+                    auto rebound = *bound + name.substr(name.find_last_of('.', name.find_first_of('(')));
+                    logger.builder(logging::level::debug) << "Devirtualizing call to " << name << " at line " << instr.line_number << " as " << rebound << logging::logbuilder::end;
+                    name = rebound;
+                    instr.devirtualized = true;
+                }
+            }
+            ::transfer(instr, known);
+        }
+    }
+}
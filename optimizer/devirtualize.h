@@ -0,0 +1,18 @@
+#ifndef OPTIMIZER_DEVIRTUALIZE
+#define OPTIMIZER_DEVIRTUALIZE
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Binds VINVs directly when the receiver's exact class is known from a VNEW reaching the call on every path,
+        //or, given a class hierarchy, when no indexed subclass of the receiver's class overrides the callee.
+        //A dominating IOF test narrows the receiver's class for the hierarchy lookup.
+        void devirtualize_calls(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_DEVIRTUALIZE */
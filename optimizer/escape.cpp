@@ -0,0 +1,138 @@
+#include "escape.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "dataflow.h"
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    //Locals that may hold the same object, merged across every MOV in the method regardless of order
+    class aliases
+    {
+        std::unordered_map<std::string, std::string> parents;
+
+    public:
+        std::string find(const std::string &name)
+        {
+            auto parent = this->parents.find(name);
+            if (parent == this->parents.end() or parent->second == name)
+            {
+                return name;
+            }
+            auto root = this->find(parent->second);
+            this->parents[name] = root;
+            return root;
+        }
+
+        void merge(const std::string &a, const std::string &b)
+        {
+            auto root_a = this->find(a), root_b = this->find(b);
+            if (root_a != root_b)
+            {
+                this->parents[root_a] = root_b;
+            }
+        }
+    };
+
+    //Whether reading operand idx of instr leaks the object it names. Field accesses through the object,
+    //IOF, comparisons and copies keep it in the method; a value stored anywhere, returned or passed along does not.
+    bool leaks(const oops_bcode_compiler::optimizer::instruction &instr, std::size_t idx)
+    {
+        switch (instr.itype)
+        {
+        case ktype::CVLLD:
+        case ktype::SVLLD:
+        case ktype::VLLD:
+        case ktype::IOF:
+        case ktype::MOV:
+            return idx != 1;
+        case ktype::CVLSR:
+        case ktype::SVLSR:
+        case ktype::VLSR:
+            return idx != 0;
+        case ktype::BEQ:
+        case ktype::BNEQ:
+        case ktype::BEQI:
+        case ktype::BNEQI:
+            return false;
+        default:
+            return true;
+        }
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::find_local_allocations(function &fn, const compiler::options &)
+{
+    auto types = optimizer::slot_types(fn);
+    auto is_ref = [&](const std::string &name) {
+        auto type = types.find(name);
+        return type != types.end() and type->second == 6;
+    };
+    ::aliases classes;
+    for (auto &blk : fn.blocks)
+    {
+        for (auto &instr : blk.instructions)
+        {
+            if (instr.itype == ktype::MOV)
+            {
+                classes.merge(instr.operands[0], instr.operands[1]);
+            }
+        }
+    }
+    std::unordered_set<std::string> escaped;
+    for (auto &blk : fn.blocks)
+    {
+        for (auto &instr : blk.instructions)
+        {
+            for (auto idx : keywords::use_operands(instr.itype, instr.operands.size()))
+            {
+                if (idx < instr.operands.size() and is_ref(instr.operands[idx]) and ::leaks(instr, idx))
+                {
+                    escaped.insert(classes.find(instr.operands[idx]));
+                }
+            }
+        }
+    }
+    //Parameters came from the caller, which still holds them
+    for (auto &param : fn.parameters)
+    {
+        escaped.insert(classes.find(param.name));
+    }
+    auto live = optimizer::compute_liveness(fn);
+    std::size_t marked = 0;
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        auto &instrs = fn.blocks[i].instructions;
+        auto after = live.live_out[i];
+        for (std::size_t j = instrs.size(); j-- > 0;)
+        {
+            auto &instr = instrs[j];
+            if (instr.itype == ktype::VNEW)
+            {
+                auto cls = classes.find(instr.operands[0]);
+                //Another local of the class still live here could hold the object this site made last time
+                bool reused = false;
+                for (auto &name : after)
+                {
+                    reused = reused or (name != instr.operands[0] and classes.find(name) == cls);
+                }
+                instr.no_escape = escaped.find(cls) == escaped.end() and !reused;
+                if (instr.no_escape)
+                {
+                    logger.builder(logging::level::debug) << "Allocation at line " << instr.line_number << " in " << fn.name << " does not escape" << logging::logbuilder::end;
+                    marked++;
+                }
+            }
+            optimizer::transfer_liveness(instr, after);
+        }
+    }
+    logger.builder(logging::level::debug) << "Found " << marked << " non-escaping allocations in " << fn.name << logging::logbuilder::end;
+}
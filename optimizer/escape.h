@@ -0,0 +1,18 @@
+#ifndef OPTIMIZER_ESCAPE
+#define OPTIMIZER_ESCAPE
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Marks VNEWs whose object never leaves the method: it is only read or written through its own fields,
+        //tested or compared, and never stored, returned or passed to a call. The object an earlier execution of
+        //the same VNEW made must also be dead by the time it runs again, so one frame slot per site suffices.
+        void find_local_allocations(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_ESCAPE */
@@ -0,0 +1,229 @@
+#include "inliner.h"
+
+#include <numeric>
+#include <unordered_map>
+
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    //Callers stop growing past this many instructions
+    constexpr std::size_t max_caller_size = 2000;
+
+    std::size_t instruction_count(const function &fn)
+    {
+        return std::accumulate(fn.blocks.begin(), fn.blocks.end(), static_cast<std::size_t>(0), [](std::size_t sum, const oops_bcode_compiler::optimizer::block &blk) { return sum + blk.instructions.size(); });
+    }
+
+    //Type name a parameter gets as a DEF'd local; parameters named by class are references
+    std::string slot_type_name(const oops_bcode_compiler::parsing::cls::variable &param)
+    {
+        return oops_bcode_compiler::optimizer::type_code(param.host_name) ? param.host_name : "ref";
+    }
+
+    struct inliner
+    {
+        std::vector<function> &functions;
+        const std::string &class_name;
+        const oops_bcode_compiler::compiler::options &options;
+        std::unordered_map<std::string, std::size_t> static_methods;
+        //0 unvisited, 1 on the DFS stack, 2 done
+        std::vector<int> state;
+
+        //Index of the same-class static method a call names, or npos
+        std::size_t callee_of(const oops_bcode_compiler::optimizer::instruction &call)
+        {
+            if (call.itype != ktype::SINV or call.operands.size() < 2)
+            {
+                return ~static_cast<std::size_t>(0);
+            }
+            auto &name = call.operands[1];
+            auto cls_split = name.find_last_of('.', name.find_first_of('('));
+            if (cls_split == std::string::npos or name.substr(0, cls_split) != this->class_name)
+            {
+                return ~static_cast<std::size_t>(0);
+            }
+            auto callee = this->static_methods.find(name.substr(cls_split + 1));
+            return callee == this->static_methods.end() ? ~static_cast<std::size_t>(0) : callee->second;
+        }
+
+        bool should_inline(const function &caller, const oops_bcode_compiler::optimizer::instruction &call, const function &callee)
+        {
+            if (call.operands.size() - 2 != callee.parameters.size())
+            {
+                return false;
+            }
+            //Handler ranges are label spans, which spliced blocks would fall outside of
+            if (!caller.handlers.empty() or !callee.handlers.empty())
+            {
+                return false;
+            }
+            auto caller_types = oops_bcode_compiler::optimizer::slot_types(caller);
+            auto callee_types = oops_bcode_compiler::optimizer::slot_types(callee);
+            //Leave mismatched calls for the compiler to report
+            if (caller_types[call.operands[0]] != oops_bcode_compiler::optimizer::type_code(callee.return_type_name))
+            {
+                return false;
+            }
+            for (std::size_t i = 0; i < callee.parameters.size(); i++)
+            {
+                if (caller_types[call.operands[i + 2]] != callee_types[callee.parameters[i].name])
+                {
+                    return false;
+                }
+            }
+            auto threshold = static_cast<std::size_t>(this->options.inline_threshold);
+            if (caller.profile and caller.profile->invocations and call.origin != ~static_cast<std::size_t>(0))
+            {
+                //Sites the instrumented build already inlined have no count, so only a counted site is judged by the profile
+                if (auto count = caller.profile->calls.find(call.origin); count != caller.profile->calls.end())
+                {
+                    //Never reached in the profile, so inlining only costs code size
+                    if (!count->second)
+                    {
+                        return false;
+                    }
+                    //Sites that run more than once per caller invocation sit in loops and earn a bigger budget
+                    if (count->second > caller.profile->invocations)
+                    {
+                        threshold *= 2;
+                    }
+                }
+            }
+            return ::instruction_count(callee) <= threshold and ::instruction_count(caller) + ::instruction_count(callee) <= ::max_caller_size;
+        }
+
+        //Replaces the call ending at instruction idx of block blk with the callee's body
+        void splice(function &caller, std::size_t blk, std::size_t idx, const function &callee)
+        {
+            auto call = caller.blocks[blk].instructions[idx];
+            auto prefix = oops_bcode_compiler::optimizer::fresh_label(caller) + ".";
+            std::unordered_map<std::string, std::string> renamed;
+            for (auto &param : callee.parameters)
+            {
+                renamed[param.name] = prefix + param.name;
+                caller.locals.push_back({::slot_type_name(param), prefix + param.name, call.line_number, call.column_number});
+            }
+            for (auto &local : callee.locals)
+            {
+                renamed[local.name] = prefix + local.name;
+                caller.locals.push_back({local.type_name, prefix + local.name, local.line_number, local.column_number});
+            }
+            auto rename = [&](const std::string &name) {
+                auto found = renamed.find(name);
+                return found == renamed.end() ? name : found->second;
+            };
+            //Split the caller block after the call; the call's block falls into the callee entry
+            auto &site = caller.blocks[blk];
+            oops_bcode_compiler::optimizer::block after{oops_bcode_compiler::optimizer::fresh_label(caller), {site.instructions.begin() + idx + 1, site.instructions.end()}, site.fallthrough, {}, {}};
+            site.instructions.resize(idx);
+            for (std::size_t i = 0; i < callee.parameters.size(); i++)
+            {
+                site.instructions.push_back({{renamed[callee.parameters[i].name], call.operands[i + 2]}, call.line_number, call.column_number, ktype::MOV});
+            }
+            //Called, the callee would start on a zero-filled frame; dce drops the resets its body overwrites before reading
+            for (auto &local : callee.locals)
+            {
+                site.instructions.push_back({{renamed[local.name], local.type_name == "ref" ? "null" : "0"}, call.line_number, call.column_number, ktype::LI});
+            }
+            site.fallthrough = prefix + callee.blocks[0].label;
+            std::vector<oops_bcode_compiler::optimizer::block> body;
+            for (auto &callee_blk : callee.blocks)
+            {
+                oops_bcode_compiler::optimizer::block copy{prefix + callee_blk.label, {}, callee_blk.fallthrough.empty() ? "" : prefix + callee_blk.fallthrough, {}, {}};
+                for (auto instr : callee_blk.instructions)
+                {
+                    //Source indexes and profile counts belong to the callee, not this caller
+                    instr.origin = ~static_cast<std::size_t>(0);
+                    instr.inverted = false;
+                    if (instr.itype == ktype::RET)
+                    {
+                        copy.instructions.push_back({{call.operands[0], rename(instr.operands[0])}, instr.line_number, instr.column_number, ktype::MOV});
+                        copy.instructions.push_back({{after.label}, instr.line_number, instr.column_number, ktype::BU});
+                        continue;
+                    }
+                    for (auto op : oops_bcode_compiler::keywords::label_operands(instr.itype, instr.operands.size()))
+                    {
+                        instr.operands[op] = prefix + instr.operands[op];
+                    }
+                    for (auto op : oops_bcode_compiler::keywords::use_operands(instr.itype, instr.operands.size()))
+                    {
+                        if (op < instr.operands.size())
+                        {
+                            instr.operands[op] = rename(instr.operands[op]);
+                        }
+                    }
+                    if (oops_bcode_compiler::keywords::defines_first_operand(instr.itype))
+                    {
+                        instr.operands[0] = rename(instr.operands[0]);
+                    }
+                    copy.instructions.push_back(std::move(instr));
+                }
+                body.push_back(std::move(copy));
+            }
+            body.push_back(std::move(after));
+            caller.blocks.insert(caller.blocks.begin() + blk + 1, std::make_move_iterator(body.begin()), std::make_move_iterator(body.end()));
+            logger.builder(logging::level::debug) << "Inlined " << callee.name << " into " << caller.name << " at line " << call.line_number << logging::logbuilder::end;
+        }
+
+        void visit(std::size_t fidx)
+        {
+            this->state[fidx] = 1;
+            auto &caller = this->functions[fidx];
+            for (std::size_t blk = 0; blk < caller.blocks.size(); blk++)
+            {
+                for (std::size_t idx = 0; idx < caller.blocks[blk].instructions.size(); idx++)
+                {
+                    auto &call = caller.blocks[blk].instructions[idx];
+                    auto callee = this->callee_of(call);
+                    if (callee == ~static_cast<std::size_t>(0) or this->state[callee] == 1)
+                    {
+                        continue;
+                    }
+                    if (this->state[callee] == 0)
+                    {
+                        this->visit(callee);
+                    }
+                    if (this->should_inline(caller, call, this->functions[callee]))
+                    {
+                        this->splice(caller, blk, idx, this->functions[callee]);
+                        //Skip over the spliced body, whose calls were already considered inside the callee
+                        blk += this->functions[callee].blocks.size();
+                        break;
+                    }
+                }
+            }
+            oops_bcode_compiler::optimizer::rebuild_cfg(caller);
+            this->state[fidx] = 2;
+        }
+    };
+} // namespace
+
+void oops_bcode_compiler::optimizer::inline_static_calls(std::vector<function> &functions, const std::string &class_name, const compiler::options &options)
+{
+    if (options.optimization_level < 1 or !options.inline_threshold)
+    {
+        return;
+    }
+    ::inliner state{functions, class_name, options, {}, std::vector<int>(functions.size(), 0)};
+    for (std::size_t i = 0; i < functions.size(); i++)
+    {
+        if (functions[i].is_static)
+        {
+            state.static_methods[functions[i].name] = i;
+        }
+    }
+    for (std::size_t i = 0; i < functions.size(); i++)
+    {
+        if (!state.state[i])
+        {
+            state.visit(i);
+        }
+    }
+}
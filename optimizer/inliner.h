@@ -0,0 +1,21 @@
+#ifndef OPTIMIZER_INLINER
+#define OPTIMIZER_INLINER
+
+#include <string>
+#include <vector>
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Splices static methods of class_name no larger than options.inline_threshold into their SINV call sites.
+        //Runs on the freshly built functions of a whole class, callees before callers, so helpers calling
+        //helpers flatten too; recursive calls are left alone.
+        void inline_static_calls(std::vector<function> &functions, const std::string &class_name, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_INLINER */
@@ -0,0 +1,67 @@
+#include "instrument.h"
+
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+    typedef oops_bcode_compiler::profile::counter_kind ckind;
+
+    oops_bcode_compiler::optimizer::instruction counter(function &fn, ckind kind, std::size_t source_index, std::size_t line_number, std::size_t column_number)
+    {
+        fn.counters.push_back({kind, source_index});
+        return {{std::to_string(fn.counters.size() - 1)}, line_number, column_number, ktype::CNT};
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::insert_counters(function &fn, const compiler::options &options)
+{
+    if (!options.instrument or fn.blocks.empty())
+    {
+        return;
+    }
+    std::vector<block> instrumented;
+    instrumented.reserve(fn.blocks.size() * 2);
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        auto &blk = fn.blocks[i];
+        std::vector<oops_bcode_compiler::optimizer::instruction> instructions;
+        if (i == 0)
+        {
+            instructions.push_back(::counter(fn, ckind::ENTRY, 0, fn.line_number, fn.column_number));
+        }
+        for (auto &instr : blk.instructions)
+        {
+            if (instr.origin != ~static_cast<std::size_t>(0) and (keywords::is_call(instr.itype) or keywords::is_conditional_branch(instr.itype)))
+            {
+                instructions.push_back(::counter(fn, keywords::is_call(instr.itype) ? ckind::CALL : ckind::BRANCH, instr.origin, instr.line_number, instr.column_number));
+            }
+            instructions.push_back(instr);
+        }
+        blk.instructions = std::move(instructions);
+        instrumented.push_back(std::move(blk));
+        auto &placed = instrumented.back();
+        if (placed.instructions.empty())
+        {
+            continue;
+        }
+        auto &last = placed.instructions.back();
+        if (!keywords::is_conditional_branch(last.itype) or last.origin == ~static_cast<std::size_t>(0) or placed.fallthrough.empty())
+        {
+            continue;
+        }
+        //Count the fallthrough side on its own edge so the taken side needs no extra jump
+        block edge{optimizer::fresh_label(fn), {}, placed.fallthrough, {}, {}};
+        edge.frequency = placed.frequency * (1 - placed.taken_probability);
+        edge.instructions.push_back(::counter(fn, last.inverted ? ckind::BRANCH_TAKEN : ckind::BRANCH_NOT_TAKEN, last.origin, last.line_number, last.column_number));
+        placed.fallthrough = edge.label;
+        instrumented.push_back(std::move(edge));
+    }
+    fn.blocks = std::move(instrumented);
+    optimizer::rebuild_cfg(fn);
+    logger.builder(logging::level::debug) << "Inserted " << fn.counters.size() << " counters into " << fn.name << logging::logbuilder::end;
+}
@@ -0,0 +1,17 @@
+#ifndef OPTIMIZER_INSTRUMENT
+#define OPTIMIZER_INSTRUMENT
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //With options.instrument, inserts CNT instructions counting method entries, conditional branch
+        //executions, one side of every conditional branch and call sites, recording what each counts in fn.counters
+        void insert_counters(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_INSTRUMENT */
@@ -0,0 +1,245 @@
+#include "ir.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+typedef oops_bcode_compiler::keywords::keyword ktype;
+
+std::string oops_bcode_compiler::optimizer::fresh_label(function &fn)
+{
+    //Source labels are plain tokens, so the '@' prefix keeps generated ones from colliding in practice
+    return "@" + fn.name + "." + std::to_string(fn.next_label++);
+}
+
+function oops_bcode_compiler::optimizer::build(const parsing::cls::procedure &procedure)
+{
+    function fn;
+    fn.name = procedure.name;
+    fn.return_type_name = procedure.return_type_name;
+    fn.parameters = procedure.parameters;
+    fn.line_number = procedure.line_number;
+    fn.column_number = procedure.column_number;
+    fn.is_static = procedure.is_static;
+    fn.blocks.push_back({optimizer::fresh_label(fn), {}, "", {}, {}});
+    bool terminated = false;
+    for (std::size_t i = 0; i < procedure.instructions.size(); i++)
+    {
+        auto &instr = procedure.instructions[i];
+        if (instr.itype == ktype::DEF)
+        {
+            fn.locals.push_back({instr.operands[0], instr.operands[1], instr.line_number, instr.column_number});
+            continue;
+        }
+        //A one-operand EXC throws; the long form only declares a handler
+        if (instr.itype == ktype::EXC and instr.operands.size() == 5)
+        {
+            fn.handlers.push_back({instr.operands[0], instr.operands[1], instr.operands[2], instr.operands[3], instr.operands[4], instr.line_number, instr.column_number});
+            continue;
+        }
+        if (instr.itype == ktype::LBL)
+        {
+            if (!terminated)
+            {
+                fn.blocks.back().fallthrough = instr.operands[0];
+            }
+            fn.blocks.push_back({instr.operands[0], {}, "", {}, {}});
+            terminated = false;
+            continue;
+        }
+        if (terminated)
+        {
+            fn.blocks.push_back({optimizer::fresh_label(fn), {}, "", {}, {}});
+            terminated = false;
+        }
+        fn.blocks.back().instructions.push_back({instr.operands, instr.line_number, instr.column_number, instr.itype, i});
+        if (keywords::is_branch(instr.itype) or keywords::ends_flow(instr.itype))
+        {
+            terminated = true;
+        }
+    }
+    for (std::size_t i = 0; i + 1 < fn.blocks.size(); i++)
+    {
+        auto &blk = fn.blocks[i];
+        if (blk.fallthrough.empty() and (blk.instructions.empty() or !keywords::ends_flow(blk.instructions.back().itype)))
+        {
+            blk.fallthrough = fn.blocks[i + 1].label;
+        }
+    }
+    optimizer::rebuild_cfg(fn);
+    logger.builder(logging::level::debug) << "Built " << fn.blocks.size() << " basic blocks for " << fn.name << logging::logbuilder::end;
+    return fn;
+}
+
+std::unordered_map<std::string, std::size_t> oops_bcode_compiler::optimizer::block_indexes(const function &fn)
+{
+    std::unordered_map<std::string, std::size_t> indexes;
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        indexes[fn.blocks[i].label] = i;
+    }
+    return indexes;
+}
+
+void oops_bcode_compiler::optimizer::rebuild_cfg(function &fn)
+{
+    auto indexes = optimizer::block_indexes(fn);
+    for (auto &blk : fn.blocks)
+    {
+        blk.predecessors.clear();
+        blk.successors.clear();
+    }
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        auto &blk = fn.blocks[i];
+        auto add_edge = [&](const std::string &label) {
+            if (auto target = indexes.find(label); target != indexes.end() and std::find(blk.successors.begin(), blk.successors.end(), target->second) == blk.successors.end())
+            {
+                blk.successors.push_back(target->second);
+                fn.blocks[target->second].predecessors.push_back(i);
+            }
+        };
+        if (!blk.instructions.empty())
+        {
+            auto &last = blk.instructions.back();
+            for (auto idx : keywords::label_operands(last.itype, last.operands.size()))
+            {
+                add_edge(last.operands[idx]);
+            }
+        }
+        if (!blk.fallthrough.empty())
+        {
+            add_edge(blk.fallthrough);
+        }
+    }
+}
+
+std::vector<instruction> oops_bcode_compiler::optimizer::linearize(const function &fn, std::vector<double> *frequencies)
+{
+    std::unordered_set<std::string> targets;
+    for (auto &blk : fn.blocks)
+    {
+        if (!blk.instructions.empty())
+        {
+            auto &last = blk.instructions.back();
+            for (auto idx : keywords::label_operands(last.itype, last.operands.size()))
+            {
+                targets.insert(last.operands[idx]);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        if (!fn.blocks[i].fallthrough.empty() and (i + 1 == fn.blocks.size() or fn.blocks[i + 1].label != fn.blocks[i].fallthrough))
+        {
+            targets.insert(fn.blocks[i].fallthrough);
+        }
+    }
+    for (auto &handler : fn.handlers)
+    {
+        targets.insert({handler.begin, handler.end, handler.target});
+    }
+    std::vector<instruction> out;
+    for (auto &local : fn.locals)
+    {
+        out.push_back({{local.type_name, local.name}, local.line_number, local.column_number, ktype::DEF});
+    }
+    if (frequencies)
+    {
+        //DEFs emit no words but may share a start with the first real instruction
+        frequencies->assign(out.size(), fn.blocks.empty() ? 0 : fn.blocks[0].frequency);
+    }
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        auto &blk = fn.blocks[i];
+        if (targets.find(blk.label) != targets.end())
+        {
+            out.push_back({{blk.label}, fn.line_number, fn.column_number, ktype::LBL});
+        }
+        std::copy(blk.instructions.begin(), blk.instructions.end(), std::back_inserter(out));
+        if (!blk.fallthrough.empty() and (i + 1 == fn.blocks.size() or fn.blocks[i + 1].label != blk.fallthrough))
+        {
+            auto line = blk.instructions.empty() ? fn.line_number : blk.instructions.back().line_number;
+            auto column = blk.instructions.empty() ? fn.column_number : blk.instructions.back().column_number;
+            out.push_back({{blk.fallthrough}, line, column, ktype::BU});
+        }
+        if (frequencies)
+        {
+            frequencies->resize(out.size(), blk.frequency);
+        }
+    }
+    return out;
+}
+
+std::uint8_t oops_bcode_compiler::optimizer::type_code(const std::string &type_name)
+{
+    static const std::unordered_map<std::string, std::uint8_t> type_map = {{"int", 2}, {"long", 3}, {"float", 4}, {"double", 5}, {"ref", 6}};
+    auto type = type_map.find(type_name);
+    return type == type_map.end() ? 0 : type->second;
+}
+
+std::unordered_map<std::string, std::uint8_t> oops_bcode_compiler::optimizer::slot_types(const function &fn)
+{
+    std::unordered_map<std::string, std::uint8_t> types;
+    for (auto &param : fn.parameters)
+    {
+        //Parameters named by class are references
+        auto code = optimizer::type_code(param.host_name);
+        types[param.name] = code ? code : 6;
+    }
+    for (auto &local : fn.locals)
+    {
+        types[local.name] = optimizer::type_code(local.type_name);
+    }
+    return types;
+}
+
+std::optional<std::int64_t> oops_bcode_compiler::optimizer::parse_immediate(const std::string &immediate)
+{
+    std::size_t start = immediate.length() and immediate[0] == '-';
+    int base = 10;
+    if (immediate.length() > start + 2 and immediate[start] == '0')
+    {
+        switch (immediate[start + 1])
+        {
+        case 'x':
+        case 'X':
+            base = 16;
+            break;
+        case 'o':
+        case 'O':
+            base = 8;
+            break;
+        case 'b':
+        case 'B':
+            base = 2;
+            break;
+        }
+    }
+    auto digits = immediate.substr(start + (base == 10 ? 0 : 2));
+    if (digits.empty() or !std::isalnum(static_cast<unsigned char>(digits[0])))
+    {
+        return {};
+    }
+    try
+    {
+        std::size_t counted;
+        auto value = std::stoll(digits, &counted, base);
+        if (counted != digits.length())
+        {
+            return {};
+        }
+        return start ? -value : value;
+    }
+    catch (std::logic_error &)
+    {
+        return {};
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef OPTIMIZER_IR
+#define OPTIMIZER_IR
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../parser/parser.h"
+#include "../profile/profile.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        struct instruction
+        {
+            std::vector<std::string> operands;
+            std::size_t line_number;
+            std::size_t column_number;
+            keywords::keyword itype;
+            //Index of the source instruction this came from, npos for instructions the optimizer made up
+            std::size_t origin = ~static_cast<std::size_t>(0);
+            //Set on conditional branches whose condition was flipped relative to the source instruction
+            bool inverted = false;
+            //Set on array accesses whose null or bounds check was proven never to fail
+            bool proven_nonnull = false;
+            bool proven_in_bounds = false;
+            //Set on VINVs whose callee is fixed by what is known of the receiver; operand 2 then names the class it resolves in
+            bool devirtualized = false;
+            //Set on VNEWs whose object never outlives the method's frame
+            bool no_escape = false;
+        };
+
+        //A DEF'd local; its stack offset is only chosen at emission
+        struct slot
+        {
+            std::string type_name;
+            std::string name;
+            std::size_t line_number;
+            std::size_t column_number;
+        };
+
+        //An EXC declaration: exceptions of class_name thrown between the begin and end labels, in source order,
+        //are stored into local and continue at the target label
+        struct handler
+        {
+            std::string begin;
+            std::string end;
+            std::string target;
+            std::string class_name;
+            std::string local;
+            std::size_t line_number;
+            std::size_t column_number;
+        };
+
+        struct block
+        {
+            std::string label;
+            std::vector<instruction> instructions;
+            //Label of the block control reaches by running off the end, empty if the block ends in BU or RET
+            std::string fallthrough;
+            std::vector<std::size_t> predecessors;
+            std::vector<std::size_t> successors;
+            //Chance that the conditional branch ending the block is taken
+            double taken_probability = 0.5;
+            //Expected executions per method invocation
+            double frequency = 1;
+        };
+
+        struct function
+        {
+            std::string name;
+            std::string return_type_name;
+            std::vector<parsing::cls::variable> parameters;
+            std::vector<slot> locals;
+            //In declaration order, which is the order the VM tries them in
+            std::vector<handler> handlers;
+            //blocks[0] is the entry block; vector order is the emitted layout
+            std::vector<block> blocks;
+            std::size_t line_number;
+            std::size_t column_number;
+            bool is_static;
+            std::size_t next_label = 0;
+            const oops_bcode_compiler::profile::method_profile *profile = nullptr;
+            //Descriptors for the CNT instructions of an instrumented build, indexed by their operand
+            std::vector<oops_bcode_compiler::profile::counter> counters;
+        };
+
+        function build(const parsing::cls::procedure &procedure);
+
+        //frequencies, if given, receives the frequency of the block each emitted instruction belongs to
+        std::vector<instruction> linearize(const function &fn, std::vector<double> *frequencies = nullptr);
+
+        //Recomputes predecessor and successor edges; required after any pass that adds, removes or reorders blocks
+        void rebuild_cfg(function &fn);
+
+        std::string fresh_label(function &fn);
+
+        std::unordered_map<std::string, std::size_t> block_indexes(const function &fn);
+
+        //Type codes match the encoded method header: 2 int, 3 long, 4 float, 5 double, 6 ref, 0 unknown
+        std::uint8_t type_code(const std::string &type_name);
+
+        std::unordered_map<std::string, std::uint8_t> slot_types(const function &fn);
+
+        //Integer immediates in the forms the compiler accepts (decimal, 0x, 0o, 0b); nothing for anything else
+        std::optional<std::int64_t> parse_immediate(const std::string &immediate);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_IR */
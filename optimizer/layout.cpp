@@ -0,0 +1,178 @@
+#include "layout.h"
+
+#include <algorithm>
+
+#include "branches.h"
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    struct edge
+    {
+        std::size_t from;
+        std::size_t to;
+        double weight;
+    };
+
+    ktype inverse(ktype kw)
+    {
+        switch (kw)
+        {
+        case ktype::BGE:
+            return ktype::BLT;
+        case ktype::BLT:
+            return ktype::BGE;
+        case ktype::BLE:
+            return ktype::BGT;
+        case ktype::BGT:
+            return ktype::BLE;
+        case ktype::BEQ:
+            return ktype::BNEQ;
+        case ktype::BNEQ:
+            return ktype::BEQ;
+        case ktype::BGEI:
+            return ktype::BLTI;
+        case ktype::BLTI:
+            return ktype::BGEI;
+        case ktype::BLEI:
+            return ktype::BGTI;
+        case ktype::BGTI:
+            return ktype::BLEI;
+        case ktype::BEQI:
+            return ktype::BNEQI;
+        case ktype::BNEQI:
+            return ktype::BEQI;
+        default:
+            return kw;
+        }
+    }
+
+    //Pettis-Hansen bottom-up chaining: the heaviest edges become fallthroughs first
+    std::vector<std::size_t> chain_blocks(const function &fn)
+    {
+        std::vector<edge> edges;
+        for (std::size_t i = 0; i < fn.blocks.size(); i++)
+        {
+            for (auto succ : fn.blocks[i].successors)
+            {
+                if (succ != i)
+                {
+                    edges.push_back({i, succ, fn.blocks[i].frequency * oops_bcode_compiler::optimizer::edge_probability(fn, i, succ)});
+                }
+            }
+        }
+        std::stable_sort(edges.begin(), edges.end(), [](const edge &a, const edge &b) { return a.weight > b.weight; });
+        std::vector<std::vector<std::size_t>> chains(fn.blocks.size());
+        std::vector<std::size_t> chain_of(fn.blocks.size());
+        for (std::size_t i = 0; i < fn.blocks.size(); i++)
+        {
+            chains[i] = {i};
+            chain_of[i] = i;
+        }
+        for (auto &e : edges)
+        {
+            auto head = chain_of[e.from], tail = chain_of[e.to];
+            //The entry block has to stay first, so nothing may fall into it.
+            //Edges a profile never saw taken are not chained, which splits cold blocks away from hot ones.
+            if (e.to == 0 or e.weight <= 0 or head == tail or chains[head].back() != e.from or chains[tail].front() != e.to)
+            {
+                continue;
+            }
+            for (auto blk : chains[tail])
+            {
+                chain_of[blk] = head;
+            }
+            chains[head].insert(chains[head].end(), chains[tail].begin(), chains[tail].end());
+            chains[tail].clear();
+        }
+        std::vector<std::size_t> rest;
+        for (std::size_t i = 1; i < chains.size(); i++)
+        {
+            if (!chains[i].empty() and i != chain_of[0])
+            {
+                rest.push_back(i);
+            }
+        }
+        auto hottest = [&](std::size_t chain) {
+            double frequency = 0;
+            for (auto blk : chains[chain])
+            {
+                frequency = std::max(frequency, fn.blocks[blk].frequency);
+            }
+            return frequency;
+        };
+        //Cold chains sink to the end of the method
+        std::stable_sort(rest.begin(), rest.end(), [&](std::size_t a, std::size_t b) { return hottest(a) > hottest(b); });
+        std::vector<std::size_t> order = chains[chain_of[0]];
+        for (auto chain : rest)
+        {
+            order.insert(order.end(), chains[chain].begin(), chains[chain].end());
+        }
+        return order;
+    }
+
+    //Makes each block's likelier successor its fallthrough when it has been placed next
+    void fix_branches(function &fn)
+    {
+        auto types = oops_bcode_compiler::optimizer::slot_types(fn);
+        for (std::size_t i = 0; i < fn.blocks.size(); i++)
+        {
+            auto &blk = fn.blocks[i];
+            if (blk.instructions.empty() or i + 1 == fn.blocks.size())
+            {
+                continue;
+            }
+            auto &branch = blk.instructions.back();
+            auto &next = fn.blocks[i + 1].label;
+            if (branch.itype == ktype::BU)
+            {
+                if (branch.operands[0] == next)
+                {
+                    blk.instructions.pop_back();
+                    blk.fallthrough = next;
+                }
+                continue;
+            }
+            if (!oops_bcode_compiler::keywords::is_conditional_branch(branch.itype) or branch.operands[0] != next or blk.fallthrough.empty())
+            {
+                continue;
+            }
+            //Inverting a float comparison would change which way an unordered (NaN) compare goes
+            auto type = types.find(branch.operands[1]);
+            if (type == types.end() or (type->second != 2 and type->second != 3 and type->second != 6))
+            {
+                continue;
+            }
+            logger.builder(logging::level::debug) << "Inverting " << oops_bcode_compiler::keywords::keyword_to_string[static_cast<unsigned>(branch.itype)] << " at line " << branch.line_number << " to fall through to " << next << logging::logbuilder::end;
+            branch.itype = ::inverse(branch.itype);
+            branch.inverted = !branch.inverted;
+            branch.operands[0] = blk.fallthrough;
+            blk.fallthrough = next;
+            blk.taken_probability = 1 - blk.taken_probability;
+        }
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::layout_blocks(function &fn, const compiler::options &)
+{
+    if (fn.blocks.size() < 2)
+    {
+        return;
+    }
+    auto order = ::chain_blocks(fn);
+    std::vector<block> placed;
+    placed.reserve(fn.blocks.size());
+    for (auto idx : order)
+    {
+        placed.push_back(std::move(fn.blocks[idx]));
+    }
+    fn.blocks = std::move(placed);
+    ::fix_branches(fn);
+    optimizer::rebuild_cfg(fn);
+}
@@ -0,0 +1,16 @@
+#ifndef OPTIMIZER_LAYOUT
+#define OPTIMIZER_LAYOUT
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Orders blocks so the likeliest successor falls through, inverting conditional branches where needed
+        void layout_blocks(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_LAYOUT */
@@ -0,0 +1,332 @@
+#include "licm.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "dataflow.h"
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    enum class memory
+    {
+        NONE,
+        FIELD,
+        STATIC,
+        ARRAY,
+        LENGTH
+    };
+
+    //Which kind of heap location a load reads; NONE for anything else
+    memory load_kind(ktype kw)
+    {
+        switch (kw)
+        {
+        case ktype::CVLLD:
+        case ktype::SVLLD:
+        case ktype::VLLD:
+            return memory::FIELD;
+        case ktype::CSTLD:
+        case ktype::SSTLD:
+        case ktype::STLD:
+            return memory::STATIC;
+        case ktype::CALD:
+        case ktype::SALD:
+        case ktype::ALD:
+            return memory::ARRAY;
+        case ktype::ALEN:
+            return memory::LENGTH;
+        default:
+            return memory::NONE;
+        }
+    }
+
+    //Member name without its class, so a field reached through a subclass still aliases its declaration
+    std::string member_name(const std::string &qualified)
+    {
+        return qualified.substr(qualified.find_last_of('.') + 1);
+    }
+
+    //Heap writes made anywhere in a loop
+    struct clobbers
+    {
+        std::unordered_set<std::string> fields;
+        std::unordered_set<std::string> statics;
+        bool arrays = false;
+        //Callees may write anything, so a call clobbers every field, static and array element
+        bool calls = false;
+
+        void add(const oops_bcode_compiler::optimizer::instruction &instr)
+        {
+            switch (instr.itype)
+            {
+            case ktype::CVLSR:
+            case ktype::SVLSR:
+            case ktype::VLSR:
+                this->fields.insert(::member_name(instr.operands[2]));
+                break;
+            case ktype::CSTSR:
+            case ktype::SSTSR:
+            case ktype::STSR:
+                this->statics.insert(::member_name(instr.operands[1]));
+                break;
+            case ktype::CASR:
+            case ktype::SASR:
+            case ktype::ASR:
+                this->arrays = true;
+                break;
+            default:
+                if (oops_bcode_compiler::keywords::is_call(instr.itype))
+                {
+                    this->calls = true;
+                }
+                break;
+            }
+        }
+
+        //Array lengths never change, so ALEN is never clobbered
+        bool clobbered(const oops_bcode_compiler::optimizer::instruction &instr) const
+        {
+            switch (::load_kind(instr.itype))
+            {
+            case memory::FIELD:
+                return this->calls or this->fields.find(::member_name(instr.operands[2])) != this->fields.end();
+            case memory::STATIC:
+                return this->calls or this->statics.find(::member_name(instr.operands[1])) != this->statics.end();
+            case memory::ARRAY:
+                return this->calls or this->arrays;
+            default:
+                return false;
+            }
+        }
+    };
+
+    //Loop blocks that can run before blk in an iteration, i.e. reach it without passing through the header
+    std::vector<std::size_t> blocks_before(const function &fn, const oops_bcode_compiler::optimizer::loop &lp, std::size_t blk)
+    {
+        std::vector<std::size_t> before;
+        if (blk == lp.header)
+        {
+            return before;
+        }
+        std::unordered_set<std::size_t> seen = {blk};
+        std::vector<std::size_t> worklist = {blk};
+        while (!worklist.empty())
+        {
+            auto current = worklist.back();
+            worklist.pop_back();
+            for (auto pred : fn.blocks[current].predecessors)
+            {
+                if (lp.contains(pred) and seen.insert(pred).second)
+                {
+                    before.push_back(pred);
+                    if (pred != lp.header)
+                    {
+                        worklist.push_back(pred);
+                    }
+                }
+            }
+        }
+        return before;
+    }
+
+    //Hoists what it can out of lp into a new preheader; false if nothing was invariant
+    bool hoist(function &fn, const oops_bcode_compiler::optimizer::loop &lp, const std::vector<std::size_t> &idom, const oops_bcode_compiler::optimizer::liveness &live)
+    {
+        std::unordered_map<std::string, std::size_t> definitions;
+        ::clobbers written;
+        std::vector<std::size_t> exits;
+        for (auto idx : lp.blocks)
+        {
+            for (auto &instr : fn.blocks[idx].instructions)
+            {
+                if (oops_bcode_compiler::keywords::defines_first_operand(instr.itype))
+                {
+                    definitions[instr.operands[0]]++;
+                }
+                written.add(instr);
+            }
+            for (auto succ : fn.blocks[idx].successors)
+            {
+                if (!lp.contains(succ))
+                {
+                    exits.push_back(idx);
+                    break;
+                }
+            }
+        }
+        auto &header_live = live.live_in[lp.header];
+        //Visit in reverse postorder so hoisted instructions keep their dependency order
+        std::vector<std::size_t> order;
+        for (auto idx : oops_bcode_compiler::optimizer::reverse_postorder(fn))
+        {
+            if (lp.contains(idx))
+            {
+                order.push_back(idx);
+            }
+        }
+        std::unordered_set<const oops_bcode_compiler::optimizer::instruction *> hoisted;
+        std::vector<const oops_bcode_compiler::optimizer::instruction *> preheader;
+        auto &head = fn.blocks[lp.header];
+        //A top-tested loop whose header only computes its exit test can hoist loads from the body behind a copy of that test
+        bool guardable = std::find(exits.begin(), exits.end(), lp.header) != exits.end() and head.successors.size() == 2 and !head.instructions.empty() and oops_bcode_compiler::keywords::is_conditional_branch(head.instructions.back().itype) and std::all_of(head.instructions.begin(), head.instructions.end(), [](const oops_bcode_compiler::optimizer::instruction &instr) { return oops_bcode_compiler::keywords::is_pure(instr) or oops_bcode_compiler::keywords::is_branch(instr.itype); });
+        bool guarded = false;
+        //Loads can trap, so they only move if they run on every iteration before anything observable could
+        auto runs_first = [&](std::size_t idx, const oops_bcode_compiler::optimizer::instruction &instr, bool &needs_guard) {
+            for (auto other : exits)
+            {
+                if (other == lp.header and guardable)
+                {
+                    needs_guard = idx != lp.header;
+                }
+                else if (!oops_bcode_compiler::optimizer::dominates(idom, idx, other))
+                {
+                    return false;
+                }
+            }
+            for (auto latch : lp.latches)
+            {
+                if (!oops_bcode_compiler::optimizer::dominates(idom, idx, latch))
+                {
+                    return false;
+                }
+            }
+            auto harmless = [&](const oops_bcode_compiler::optimizer::instruction &earlier) {
+                return oops_bcode_compiler::keywords::is_pure(earlier) or oops_bcode_compiler::keywords::is_branch(earlier.itype) or hoisted.find(&earlier) != hoisted.end();
+            };
+            for (auto earlier : ::blocks_before(fn, lp, idx))
+            {
+                if (!std::all_of(fn.blocks[earlier].instructions.begin(), fn.blocks[earlier].instructions.end(), harmless))
+                {
+                    return false;
+                }
+            }
+            const oops_bcode_compiler::optimizer::instruction *first = fn.blocks[idx].instructions.data();
+            return std::all_of(first, &instr, harmless);
+        };
+        bool changed;
+        do
+        {
+            changed = false;
+            for (auto idx : order)
+            {
+                for (auto &instr : fn.blocks[idx].instructions)
+                {
+                    if (hoisted.find(&instr) != hoisted.end() or !oops_bcode_compiler::keywords::defines_first_operand(instr.itype))
+                    {
+                        continue;
+                    }
+                    bool pure = oops_bcode_compiler::keywords::is_pure(instr);
+                    if (!pure and ::load_kind(instr.itype) == memory::NONE)
+                    {
+                        continue;
+                    }
+                    //The loop must not read the old value of the destination nor write it anywhere else
+                    auto &dest = instr.operands[0];
+                    if (definitions[dest] != 1 or header_live.find(dest) != header_live.end())
+                    {
+                        continue;
+                    }
+                    auto used = oops_bcode_compiler::optimizer::uses(instr);
+                    if (std::any_of(used.begin(), used.end(), [&](const std::string &name) { return definitions[name] != 0; }))
+                    {
+                        continue;
+                    }
+                    bool needs_guard = false;
+                    if (!pure and (written.clobbered(instr) or !runs_first(idx, instr, needs_guard)))
+                    {
+                        continue;
+                    }
+                    guarded = guarded or needs_guard;
+                    hoisted.insert(&instr);
+                    preheader.push_back(&instr);
+                    definitions[dest] = 0;
+                    changed = true;
+                }
+            }
+        } while (changed);
+        if (preheader.empty())
+        {
+            return false;
+        }
+        auto header_label = head.label;
+        oops_bcode_compiler::optimizer::block pre{oops_bcode_compiler::optimizer::fresh_label(fn), {}, header_label, {}, {}};
+        std::vector<oops_bcode_compiler::optimizer::block> inserted;
+        if (guarded)
+        {
+            //The guard runs the header once up front and only enters the loop, past the header, through the preheader
+            oops_bcode_compiler::optimizer::block guard{oops_bcode_compiler::optimizer::fresh_label(fn), head.instructions, head.fallthrough, {}, {}};
+            auto &test = guard.instructions.back();
+            auto stays = lp.contains(oops_bcode_compiler::optimizer::block_indexes(fn)[test.operands[0]]);
+            pre.fallthrough = stays ? test.operands[0] : head.fallthrough;
+            (stays ? test.operands[0] : guard.fallthrough) = pre.label;
+            logger.builder(logging::level::debug) << "Guarding the preheader of " << header_label << " with a copy of its exit test" << logging::logbuilder::end;
+            inserted.push_back(std::move(guard));
+        }
+        for (auto instr : preheader)
+        {
+            logger.builder(logging::level::debug) << "Hoisting " << oops_bcode_compiler::keywords::keyword_to_string[static_cast<unsigned>(instr->itype)] << " at line " << instr->line_number << " out of the loop at " << header_label << logging::logbuilder::end;
+            pre.instructions.push_back(*instr);
+        }
+        for (auto idx : lp.blocks)
+        {
+            auto &instrs = fn.blocks[idx].instructions;
+            instrs.erase(std::remove_if(instrs.begin(), instrs.end(), [&](const oops_bcode_compiler::optimizer::instruction &instr) { return hoisted.find(&instr) != hoisted.end(); }), instrs.end());
+        }
+        //Entries from outside the loop go through the guard or preheader; back edges keep targeting the header
+        auto entry = inserted.empty() ? pre.label : inserted.front().label;
+        for (auto pred : std::vector<std::size_t>(fn.blocks[lp.header].predecessors))
+        {
+            if (lp.contains(pred))
+            {
+                continue;
+            }
+            auto &blk = fn.blocks[pred];
+            if (!blk.instructions.empty())
+            {
+                auto &last = blk.instructions.back();
+                for (auto idx : oops_bcode_compiler::keywords::label_operands(last.itype, last.operands.size()))
+                {
+                    if (last.operands[idx] == header_label)
+                    {
+                        last.operands[idx] = entry;
+                    }
+                }
+            }
+            if (blk.fallthrough == header_label)
+            {
+                blk.fallthrough = entry;
+            }
+        }
+        //A latch left falling through into the new blocks gets an explicit branch from linearize
+        inserted.push_back(std::move(pre));
+        fn.blocks.insert(fn.blocks.begin() + lp.header, std::make_move_iterator(inserted.begin()), std::make_move_iterator(inserted.end()));
+        oops_bcode_compiler::optimizer::rebuild_cfg(fn);
+        return true;
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::hoist_loop_invariants(function &fn, const compiler::options &)
+{
+    std::unordered_set<std::string> done;
+    while (true)
+    {
+        auto idom = optimizer::compute_dominators(fn);
+        auto loops = optimizer::find_loops(fn, idom);
+        //Inner loops first, so their preheaders sit inside the outer loop and can be hoisted again
+        std::stable_sort(loops.begin(), loops.end(), [](const optimizer::loop &a, const optimizer::loop &b) { return a.blocks.size() < b.blocks.size(); });
+        auto next = std::find_if(loops.begin(), loops.end(), [&](const optimizer::loop &lp) { return done.find(fn.blocks[lp.header].label) == done.end(); });
+        if (next == loops.end())
+        {
+            break;
+        }
+        done.insert(fn.blocks[next->header].label);
+        ::hoist(fn, *next, idom, optimizer::compute_liveness(fn));
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef OPTIMIZER_LICM
+#define OPTIMIZER_LICM
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Moves loop-invariant pure instructions and unaliased loads into a preheader in front of each loop, innermost loops first
+        void hoist_loop_invariants(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_LICM */
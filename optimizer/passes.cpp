@@ -0,0 +1,76 @@
+#include "passes.h"
+
+#include <chrono>
+
+#include "branches.h"
+#include "checks.h"
+#include "dce.h"
+#include "devirtualize.h"
+#include "escape.h"
+#include "instrument.h"
+#include "layout.h"
+#include "licm.h"
+#include "strength.h"
+#include "switches.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    std::vector<std::chrono::nanoseconds> pass_times;
+}
+
+const std::vector<pass> &oops_bcode_compiler::optimizer::pipeline()
+{
+    static const std::vector<pass> passes = {
+        {"strength-reduction", 1, optimizer::reduce_strength},
+        {"dce", 1, optimizer::eliminate_dead_code},
+        //After dce, which drops tests whose blocks could not be reached and would split a chain
+        {"jump-tables", 1, optimizer::build_jump_tables},
+        {"devirtualization", 1, optimizer::devirtualize_calls},
+        {"licm", 1, optimizer::hoist_loop_invariants},
+        //After licm, so lengths hoisted into preheaders are known throughout the loop
+        {"check-elimination", 1, optimizer::prove_safe_accesses},
+        {"escape-analysis", 1, optimizer::find_local_allocations},
+        {"branch-probability", 1, optimizer::estimate_branch_probabilities},
+        {"block-layout", 1, optimizer::layout_blocks},
+        //Last, so counters describe the code that is actually emitted
+        {"instrument", 0, optimizer::insert_counters},
+    };
+    return passes;
+}
+
+void oops_bcode_compiler::optimizer::optimize(function &fn, const compiler::options &options)
+{
+    auto &passes = optimizer::pipeline();
+    ::pass_times.resize(passes.size());
+    //The CFG has no edges from throwing instructions to handlers, so methods with any only get the -O0 passes
+    auto level = fn.handlers.empty() ? options.optimization_level : 0;
+    if (level != options.optimization_level)
+    {
+        logger.builder(logging::level::debug) << "Not optimizing " << fn.name << ", which has exception handlers" << logging::logbuilder::end;
+    }
+    for (std::size_t i = 0; i < passes.size(); i++)
+    {
+        if (passes[i].level > level)
+        {
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        passes[i].run(fn, options);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        ::pass_times[i] += elapsed;
+        logger.builder(options.time_passes ? logging::level::info : logging::level::debug) << "Pass " << passes[i].name << " on " << fn.name << " took " << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us" << logging::logbuilder::end;
+    }
+}
+
+void oops_bcode_compiler::optimizer::report_pass_timings()
+{
+    auto &passes = optimizer::pipeline();
+    for (std::size_t i = 0; i < ::pass_times.size(); i++)
+    {
+        logger.builder(logging::level::info) << "Pass " << passes[i].name << " total " << std::chrono::duration_cast<std::chrono::microseconds>(::pass_times[i]).count() << "us" << logging::logbuilder::end;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef OPTIMIZER_PASSES
+#define OPTIMIZER_PASSES
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        struct pass
+        {
+            const char *name;
+            //Lowest -O level the pass runs at
+            unsigned level;
+            void (*run)(function &fn, const compiler::options &options);
+        };
+
+        const std::vector<pass> &pipeline();
+
+        void optimize(function &fn, const compiler::options &options);
+
+        //Logs the time each pass spent across every method optimized so far
+        void report_pass_timings();
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_PASSES */
@@ -0,0 +1,319 @@
+#include "strength.h"
+
+#include <unordered_set>
+
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+    typedef std::vector<oops_bcode_compiler::optimizer::instruction> sequence;
+
+    //Immediates are signed 24-bit values
+    bool fits_imm24(std::int64_t value)
+    {
+        return value > -(1 << 23) and value < (1 << 23);
+    }
+
+    //k when value is 2^k, otherwise -1
+    int exact_log2(std::int64_t value)
+    {
+        if (value <= 0 or (value & (value - 1)))
+        {
+            return -1;
+        }
+        int k = 0;
+        while (value >>= 1)
+        {
+            k++;
+        }
+        return k;
+    }
+
+    int ceil_log2(std::int64_t value)
+    {
+        int k = 0;
+        while ((static_cast<std::int64_t>(1) << k) < value)
+        {
+            k++;
+        }
+        return k;
+    }
+
+    struct reducer
+    {
+        function &fn;
+        std::unordered_map<std::string, std::uint8_t> types;
+        const oops_bcode_compiler::optimizer::instruction *at;
+
+        oops_bcode_compiler::optimizer::instruction make(ktype kw, std::vector<std::string> operands)
+        {
+            return {std::move(operands), this->at->line_number, this->at->column_number, kw};
+        }
+
+        std::string temporary(std::uint8_t type)
+        {
+            auto name = oops_bcode_compiler::optimizer::fresh_label(this->fn);
+            this->fn.locals.push_back({type == 2 ? "int" : "long", name, this->at->line_number, this->at->column_number});
+            this->types[name] = type;
+            return name;
+        }
+
+        //bias = dividend < 0 ? 2^k - 1 : 0, the correction that makes an arithmetic shift round towards zero
+        std::string rounding_bias(sequence &out, const std::string &dividend, std::uint8_t type, int k)
+        {
+            auto bits = type == 2 ? 32 : 64;
+            auto bias = this->temporary(type);
+            if (k == 1)
+            {
+                out.push_back(this->make(ktype::SRLI, {bias, dividend, std::to_string(bits - 1)}));
+            }
+            else
+            {
+                out.push_back(this->make(ktype::SRAI, {bias, dividend, std::to_string(bits - 1)}));
+                out.push_back(this->make(ktype::SRLI, {bias, bias, std::to_string(bits - k)}));
+            }
+            out.push_back(this->make(ktype::ADD, {bias, bias, dividend}));
+            return bias;
+        }
+
+        //Truncating int division by a constant that is not a power of two, via a 64-bit multiply.
+        //With p = 31 + ceil(log2(d)) and m = 2^p / d + 1, (n * m) >> p is floor(n / d) for every int n,
+        //and adding 1 for negative n turns the floor into truncation.
+        std::string divide_by_magic(sequence &out, const std::string &dividend, std::int64_t divisor)
+        {
+            auto p = 31 + ::ceil_log2(divisor);
+            auto magic = (static_cast<std::uint64_t>(1) << p) / divisor + 1;
+            auto wide = this->temporary(3), factor = this->temporary(3), quotient = this->temporary(2), sign = this->temporary(2);
+            out.push_back(this->make(ktype::CST, {wide, dividend}));
+            out.push_back(this->make(ktype::LI, {factor, std::to_string(magic)}));
+            out.push_back(this->make(ktype::MUL, {wide, wide, factor}));
+            out.push_back(this->make(ktype::SRAI, {wide, wide, std::to_string(p)}));
+            out.push_back(this->make(ktype::CST, {quotient, wide}));
+            out.push_back(this->make(ktype::SRLI, {sign, dividend, "31"}));
+            out.push_back(this->make(ktype::ADD, {quotient, quotient, sign}));
+            return quotient;
+        }
+
+        //Replacement for instr, or nothing to keep it
+        std::optional<sequence> reduce(const oops_bcode_compiler::optimizer::instruction &instr, unsigned level)
+        {
+            if (instr.itype != ktype::MULI and instr.itype != ktype::DIVI and instr.itype != ktype::MODI and instr.itype != ktype::DIVUI)
+            {
+                return {};
+            }
+            auto type = this->types[instr.operands[0]];
+            auto constant = oops_bcode_compiler::optimizer::parse_immediate(instr.operands[2]);
+            if ((type != 2 and type != 3) or this->types[instr.operands[1]] != type or !constant)
+            {
+                return {};
+            }
+            this->at = &instr;
+            auto &dest = instr.operands[0], &src = instr.operands[1];
+            auto c = *constant;
+            auto k = ::exact_log2(c);
+            sequence out;
+            switch (instr.itype)
+            {
+            case ktype::MULI:
+                if (c == 0)
+                {
+                    return sequence{this->make(ktype::ANDI, {dest, src, "0"})};
+                }
+                if (c == 1)
+                {
+                    return sequence{this->make(ktype::MOV, {dest, src})};
+                }
+                if (k > 0)
+                {
+                    return sequence{this->make(ktype::SLLI, {dest, src, std::to_string(k)})};
+                }
+                return {};
+            case ktype::DIVUI:
+                if (c == 1)
+                {
+                    return sequence{this->make(ktype::MOV, {dest, src})};
+                }
+                if (k > 0)
+                {
+                    return sequence{this->make(ktype::SRLI, {dest, src, std::to_string(k)})};
+                }
+                return {};
+            case ktype::DIVI:
+            {
+                //Truncating division is odd in the divisor, so x / -c == -(x / c), which wraps on the same minimum value
+                auto magnitude = c < 0 ? -c : c;
+                if (magnitude == 1)
+                {
+                    return sequence{this->make(c < 0 ? ktype::NEG : ktype::MOV, {dest, src})};
+                }
+                if (level < 2)
+                {
+                    return {};
+                }
+                auto mk = ::exact_log2(magnitude);
+                if (mk > 0)
+                {
+                    auto biased = this->rounding_bias(out, src, type, mk);
+                    if (c < 0)
+                    {
+                        out.push_back(this->make(ktype::SRAI, {biased, biased, std::to_string(mk)}));
+                        out.push_back(this->make(ktype::NEG, {dest, biased}));
+                    }
+                    else
+                    {
+                        out.push_back(this->make(ktype::SRAI, {dest, biased, std::to_string(mk)}));
+                    }
+                    return out;
+                }
+                if (type == 2 and magnitude >= 3)
+                {
+                    auto quotient = this->divide_by_magic(out, src, magnitude);
+                    out.push_back(this->make(c < 0 ? ktype::NEG : ktype::MOV, {dest, quotient}));
+                    return out;
+                }
+                return {};
+            }
+            case ktype::MODI:
+            {
+                //The sign of a remainder follows the dividend, so x % -c == x % c
+                auto magnitude = c < 0 ? -c : c;
+                if (magnitude == 1)
+                {
+                    return sequence{this->make(ktype::ANDI, {dest, src, "0"})};
+                }
+                if (level < 2)
+                {
+                    return {};
+                }
+                auto mk = ::exact_log2(magnitude);
+                if (mk > 0)
+                {
+                    auto biased = this->rounding_bias(out, src, type, mk);
+                    out.push_back(this->make(ktype::ANDI, {biased, biased, std::to_string(-magnitude)}));
+                    out.push_back(this->make(ktype::SUB, {dest, src, biased}));
+                    return out;
+                }
+                if (type == 2 and magnitude >= 3)
+                {
+                    auto quotient = this->divide_by_magic(out, src, magnitude);
+                    out.push_back(this->make(ktype::MULI, {quotient, quotient, std::to_string(magnitude)}));
+                    out.push_back(this->make(ktype::SUB, {dest, src, quotient}));
+                    return out;
+                }
+                return {};
+            }
+            default:
+                return {};
+            }
+        }
+    };
+
+    //Turns register MUL/DIV/MOD/DIVU whose operand is a local set once by LI into the immediate forms
+    void fold_constant_operands(function &fn, const std::unordered_map<std::string, std::uint8_t> &types)
+    {
+        std::unordered_map<std::string, std::size_t> definitions;
+        std::unordered_map<std::string, std::int64_t> values;
+        for (auto &blk : fn.blocks)
+        {
+            for (auto &instr : blk.instructions)
+            {
+                if (!oops_bcode_compiler::keywords::defines_first_operand(instr.itype))
+                {
+                    continue;
+                }
+                definitions[instr.operands[0]]++;
+                if (instr.itype == ktype::LI)
+                {
+                    if (auto value = oops_bcode_compiler::optimizer::parse_immediate(instr.operands[1]))
+                    {
+                        values[instr.operands[0]] = *value;
+                    }
+                }
+            }
+        }
+        for (auto &param : fn.parameters)
+        {
+            definitions[param.name]++;
+        }
+        auto constant = [&](const std::string &name) -> std::optional<std::int64_t> {
+            auto value = values.find(name);
+            if (value == values.end() or definitions[name] != 1 or !::fits_imm24(value->second))
+            {
+                return {};
+            }
+            return value->second;
+        };
+        for (auto &blk : fn.blocks)
+        {
+            for (auto &instr : blk.instructions)
+            {
+                auto type = types.find(instr.operands.empty() ? "" : instr.operands[0]);
+                if (type == types.end() or (type->second != 2 and type->second != 3))
+                {
+                    continue;
+                }
+                ktype immediate_form;
+                switch (instr.itype)
+                {
+                case ktype::MUL:
+                    immediate_form = ktype::MULI;
+                    break;
+                case ktype::DIV:
+                    immediate_form = ktype::DIVI;
+                    break;
+                case ktype::MOD:
+                    immediate_form = ktype::MODI;
+                    break;
+                case ktype::DIVU:
+                    immediate_form = ktype::DIVUI;
+                    break;
+                default:
+                    continue;
+                }
+                auto value = constant(instr.operands[2]);
+                //Multiplication commutes, so a constant on the left works too
+                if (!value and instr.itype == ktype::MUL and (value = constant(instr.operands[1])))
+                {
+                    std::swap(instr.operands[1], instr.operands[2]);
+                }
+                //A zero divisor folds too, as DIVI by 0 traps just the same and is_pure keeps it alive
+                if (!value)
+                {
+                    continue;
+                }
+                logger.builder(logging::level::debug) << "Folding constant " << instr.operands[2] << " = " << *value << " into " << oops_bcode_compiler::keywords::keyword_to_string[static_cast<unsigned>(instr.itype)] << " at line " << instr.line_number << logging::logbuilder::end;
+                instr.itype = immediate_form;
+                instr.operands[2] = std::to_string(*value);
+            }
+        }
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::reduce_strength(function &fn, const compiler::options &options)
+{
+    auto types = optimizer::slot_types(fn);
+    ::fold_constant_operands(fn, types);
+    ::reducer state{fn, types, nullptr};
+    for (auto &blk : fn.blocks)
+    {
+        sequence rewritten;
+        rewritten.reserve(blk.instructions.size());
+        for (auto &instr : blk.instructions)
+        {
+            auto replacement = state.reduce(instr, options.optimization_level);
+            if (!replacement)
+            {
+                rewritten.push_back(std::move(instr));
+                continue;
+            }
+            logger.builder(logging::level::debug) << "Reducing " << keywords::keyword_to_string[static_cast<unsigned>(instr.itype)] << " by " << instr.operands[2] << " at line " << instr.line_number << " to " << replacement->size() << " instructions" << logging::logbuilder::end;
+            std::move(replacement->begin(), replacement->end(), std::back_inserter(rewritten));
+        }
+        blk.instructions = std::move(rewritten);
+    }
+}
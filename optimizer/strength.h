@@ -0,0 +1,17 @@
+#ifndef OPTIMIZER_STRENGTH
+#define OPTIMIZER_STRENGTH
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Rewrites integer multiply, divide and modulo by constants into cheaper shifts and masks.
+        //Single-instruction replacements run at -O1; sign-corrected and multiply-high sequences only at -O2.
+        void reduce_strength(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_STRENGTH */
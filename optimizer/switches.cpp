@@ -0,0 +1,110 @@
+#include "switches.h"
+
+#include <set>
+
+#include "../instructions/semantics.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::optimizer;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    typedef oops_bcode_compiler::keywords::keyword ktype;
+
+    //Below this many tests a chain of compares dispatches about as fast as the table lookup
+    constexpr std::size_t min_cases = 4;
+
+    //The key a BEQI compares its int operand against, if it is a constant test of name
+    std::optional<std::int64_t> case_key(const oops_bcode_compiler::optimizer::instruction &instr, const std::string &name)
+    {
+        if (instr.itype != ktype::BEQI or instr.operands[1] != name)
+        {
+            return {};
+        }
+        return oops_bcode_compiler::optimizer::parse_immediate(instr.operands[2]);
+    }
+} // namespace
+
+void oops_bcode_compiler::optimizer::build_jump_tables(function &fn, const compiler::options &)
+{
+    auto types = optimizer::slot_types(fn);
+    auto indexes = optimizer::block_indexes(fn);
+    std::vector<bool> removed(fn.blocks.size(), false);
+    std::size_t built = 0;
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        auto &head = fn.blocks[i];
+        if (removed[i] or head.instructions.empty() or head.instructions.back().itype != ktype::BEQI or head.fallthrough.empty())
+        {
+            continue;
+        }
+        auto name = head.instructions.back().operands[1];
+        if (auto type = types.find(name); type == types.end() or type->second != 2)
+        {
+            continue;
+        }
+        std::vector<std::string> operands = {name, ""};
+        std::set<std::int64_t> keys;
+        std::vector<std::size_t> chain;
+        auto current = i;
+        while (true)
+        {
+            auto &test = fn.blocks[current].instructions.back();
+            auto key = ::case_key(test, name);
+            if (!key)
+            {
+                break;
+            }
+            //A later test of a key already seen can never succeed
+            if (keys.insert(*key).second)
+            {
+                operands.push_back(test.operands[2]);
+                operands.push_back(test.operands[0]);
+            }
+            operands[1] = fn.blocks[current].fallthrough;
+            auto next = indexes.find(fn.blocks[current].fallthrough);
+            if (next == indexes.end() or next->second == i or removed[next->second])
+            {
+                break;
+            }
+            //Only blocks holding nothing but the next test, and reached from nowhere else, join the chain
+            auto &candidate = fn.blocks[next->second];
+            if (candidate.predecessors.size() != 1 or test.operands[0] == candidate.label or candidate.instructions.size() != 1 or candidate.fallthrough.empty() or !::case_key(candidate.instructions.back(), name))
+            {
+                break;
+            }
+            chain.push_back(next->second);
+            current = next->second;
+        }
+        if (keys.size() < ::min_cases)
+        {
+            continue;
+        }
+        auto &test = head.instructions.back();
+        logger.builder(logging::level::debug) << "Turning " << keys.size() << " tests of " << name << " from line " << test.line_number << " in " << fn.name << " into a jump table" << logging::logbuilder::end;
+        head.instructions.back() = {operands, test.line_number, test.column_number, ktype::BADR};
+        head.fallthrough.clear();
+        for (auto idx : chain)
+        {
+            removed[idx] = true;
+        }
+        built++;
+    }
+    if (!built)
+    {
+        return;
+    }
+    std::vector<block> kept;
+    kept.reserve(fn.blocks.size());
+    for (std::size_t i = 0; i < fn.blocks.size(); i++)
+    {
+        if (!removed[i])
+        {
+            kept.push_back(std::move(fn.blocks[i]));
+        }
+    }
+    fn.blocks = std::move(kept);
+    optimizer::rebuild_cfg(fn);
+    logger.builder(logging::level::debug) << "Built " << built << " jump tables in " << fn.name << logging::logbuilder::end;
+}
@@ -0,0 +1,17 @@
+#ifndef OPTIMIZER_SWITCHES
+#define OPTIMIZER_SWITCHES
+
+#include "ir.h"
+#include "../compiler/options.h"
+
+namespace oops_bcode_compiler
+{
+    namespace optimizer
+    {
+        //Replaces chains of BEQIs testing one int local against different constants, each falling through to the next,
+        //with a single BADR whose default is where the last test falls through
+        void build_jump_tables(function &fn, const compiler::options &options);
+    } // namespace optimizer
+} // namespace oops_bcode_compiler
+
+#endif /* OPTIMIZER_SWITCHES */
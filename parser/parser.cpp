@@ -313,6 +313,7 @@ namespace
             case kw::LI:
             case kw::CST:
             case kw::RCVT:
+            case kw::MOV:
             case kw::ALEN:
             case kw::VNEW:
                 check_in_proc(DEF)
@@ -338,6 +339,30 @@ namespace
                     cls.self_methods.back().instructions.push_back({args, line[0].line_number, line[0].column_number, keyword->second});
                     break;
                 }
+                check_in_proc(EXC)
+                {
+                    require_min_args(2);
+                    if (line.size() != 2 and line.size() != 6)
+                    {
+                        parse_error("EXC takes either the exception to throw or a begin label, end label, handler label, class and local", line[0].line_number, line[0].column_number);
+                    }
+                    std::vector<std::string> args;
+                    std::transform(line.begin() + 1, line.end(), std::back_inserter(args), [](::token &tkn) { return tkn.token; });
+                    cls.self_methods.back().instructions.push_back({args, line[0].line_number, line[0].column_number, keyword->second});
+                    break;
+                }
+                check_in_proc(BADR)
+                {
+                    require_min_args(3);
+                    if (line.size() % 2 == 0)
+                    {
+                        parse_error("Case key without a label for keyword " << line[0].token, line[0].line_number, line.back().column_number + line.back().token.size());
+                    }
+                    std::vector<std::string> args;
+                    std::transform(line.begin() + 1, line.end(), std::back_inserter(args), [](::token &tkn) { return tkn.token; });
+                    cls.self_methods.back().instructions.push_back({args, line[0].line_number, line[0].column_number, keyword->second});
+                    break;
+                }
             case kw::RET:
             case kw::LBL:
                 check_in_proc(BU)
@@ -358,9 +383,11 @@ namespace
                     in_proc = false;
                     break;
                 }
+            case kw::CNT:
+            {
+                parse_error(line[0].token << " is only inserted by instrumented builds", line[0].line_number, line[0].column_number);
+            }
             case kw::BCMP:
-            case kw::BADR:
-            case kw::EXC:
                 parse_error(line[0].token << " is a keyword not implemented in the parser", line[0].line_number, line[0].column_number);
             }
         }
@@ -7,6 +7,27 @@
 using namespace oops_bcode_compiler::platform;
 using namespace oops_bcode_compiler::debug;
 
+namespace
+{
+    std::string normalize_file_name(std::string name, std::string build_path)
+    {
+        std::string lpcstr;
+        lpcstr.reserve(name.length() + build_path.length() + 1);
+        lpcstr += build_path;
+        if (lpcstr.empty() || (lpcstr.back() != '/' && lpcstr.back() != '\\'))
+        {
+            lpcstr += '/';
+        }
+        logger.builder(logging::level::debug) << "Class name = " << name << logging::logbuilder::end;
+        for (auto c : name)
+        {
+            lpcstr += c == '.' ? '/' : c;
+        }
+        logger.builder(logging::level::debug) << "Normalized class file root = " << lpcstr << logging::logbuilder::end;
+        return lpcstr;
+    }
+} // namespace
+
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
 #include "windows.h"
 
@@ -33,24 +54,6 @@ std::string GetLastErrorAsString()
 
 namespace
 {
-    std::string normalize_file_name(std::string name, std::string build_path)
-    {
-        std::string lpcstr;
-        lpcstr.reserve(name.length() + build_path.length() + 1);
-        lpcstr += build_path;
-        if (lpcstr.back() != '/' && lpcstr.back() != '\\')
-        {
-            lpcstr.back() += '/';
-        }
-        logger.builder(logging::level::debug) << "Class name = " << name << logging::logbuilder::end;
-        for (auto c : name)
-        {
-            lpcstr += c == '.' ? '/' : c;
-        }
-        logger.builder(logging::level::debug) << "Normalized class file root = " << lpcstr << logging::logbuilder::end;
-        return lpcstr;
-    }
-
     bool prep_directories(const std::string &build_path, const std::string &path)
     {
         std::string lpcstr;
@@ -108,6 +111,41 @@ std::optional<file_mapping> oops_bcode_compiler::platform::open_class_file_mappi
     return {{static_cast<char *>(mmap_handle), file_map_handle, file_handle, static_cast<std::size_t>(file_size.QuadPart)}};
 }
 
+std::optional<file_mapping> oops_bcode_compiler::platform::open_compiled_class(std::string name, std::string class_path)
+{
+    std::string lpcstr = ::normalize_file_name(name, class_path) + ".coops";
+    logger.builder(logging::level::debug) << "Looking for compiled class " << lpcstr << logging::logbuilder::end;
+    void *file_handle = CreateFile(lpcstr.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        logger.builder(logging::level::error) << "Failed to create file handle because " << GetLastErrorAsString() << logging::logbuilder::end;
+        return {};
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size))
+    {
+        logger.builder(logging::level::error) << "Failed to get file size because " << GetLastErrorAsString() << logging::logbuilder::end;
+        CloseHandle(file_handle);
+        return {};
+    }
+    void *file_map_handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (file_map_handle == NULL)
+    {
+        logger.builder(logging::level::error) << "Failed to create file mapping handle because " << GetLastErrorAsString() << logging::logbuilder::end;
+        CloseHandle(file_handle);
+        return {};
+    }
+    void *mmap_handle = MapViewOfFile(file_map_handle, FILE_MAP_READ, 0, 0, 0);
+    if (mmap_handle == NULL)
+    {
+        logger.builder(logging::level::error) << "Failed to map view of file because " << GetLastErrorAsString() << logging::logbuilder::end;
+        CloseHandle(file_map_handle);
+        CloseHandle(file_handle);
+        return {};
+    }
+    return {{static_cast<char *>(mmap_handle), file_map_handle, file_handle, static_cast<std::size_t>(file_size.QuadPart)}};
+}
+
 std::optional<file_mapping> oops_bcode_compiler::platform::create_class_file(std::string name, std::size_t file_size, std::string build_path)
 {
     std::string lpcstr = ::normalize_file_name(name, build_path) + ".coops";
@@ -203,4 +241,172 @@ const char *oops_bcode_compiler::platform::get_executable_path()
     return executable_path;
 }
 
-#endif
\ No newline at end of file
+#else
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    void *fd_to_handle(int fd)
+    {
+        return reinterpret_cast<void *>(static_cast<std::intptr_t>(fd));
+    }
+
+    int handle_to_fd(void *handle)
+    {
+        return static_cast<int>(reinterpret_cast<std::intptr_t>(handle));
+    }
+
+    bool prep_directories(const std::string &build_path, const std::string &path)
+    {
+        std::string directory;
+        directory.reserve(path.size());
+        directory += build_path;
+        for (std::size_t i = build_path.size(); i < path.size(); i++)
+        {
+            directory += path[i];
+            if (path[i] == '/')
+            {
+                logger.builder(logging::level::debug) << "Ensuring directory " << directory << " exists" << logging::logbuilder::end;
+                if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+                {
+                    logger.builder(logging::level::error) << "Failed to create directory " << directory << " because " << std::strerror(errno) << logging::logbuilder::end;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::optional<file_mapping> map_read_only(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            logger.builder(logging::level::error) << "Failed to open " << path << " because " << std::strerror(errno) << logging::logbuilder::end;
+            return {};
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0)
+        {
+            logger.builder(logging::level::error) << "Failed to get file size because " << std::strerror(errno) << logging::logbuilder::end;
+            close(fd);
+            return {};
+        }
+        //An empty file cannot be mapped, and has nothing to read anyway
+        if (file_stat.st_size == 0)
+        {
+            logger.builder(logging::level::error) << "File " << path << " is empty" << logging::logbuilder::end;
+            close(fd);
+            return {};
+        }
+        void *mmap_handle = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mmap_handle == MAP_FAILED)
+        {
+            logger.builder(logging::level::error) << "Failed to map file because " << std::strerror(errno) << logging::logbuilder::end;
+            close(fd);
+            return {};
+        }
+        return {{static_cast<char *>(mmap_handle), nullptr, ::fd_to_handle(fd), static_cast<std::size_t>(file_stat.st_size)}};
+    }
+} // namespace
+
+std::optional<file_mapping> oops_bcode_compiler::platform::open_class_file_mapping(std::string name)
+{
+    std::string path = ::normalize_file_name(name, platform::get_working_path()) + ".boops";
+    logger.builder(logging::level::debug) << "Looking for class file " << path << logging::logbuilder::end;
+    return ::map_read_only(path);
+}
+
+std::optional<file_mapping> oops_bcode_compiler::platform::open_compiled_class(std::string name, std::string class_path)
+{
+    std::string path = ::normalize_file_name(name, class_path) + ".coops";
+    logger.builder(logging::level::debug) << "Looking for compiled class " << path << logging::logbuilder::end;
+    return ::map_read_only(path);
+}
+
+std::optional<file_mapping> oops_bcode_compiler::platform::create_class_file(std::string name, std::size_t file_size, std::string build_path)
+{
+    std::string path = ::normalize_file_name(name, build_path) + ".coops";
+    logger.builder(logging::level::debug) << "Opening output class file " << path << " with size " << file_size << logging::logbuilder::end;
+    if (!::prep_directories(build_path, path))
+    {
+        return {};
+    }
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        logger.builder(logging::level::error) << "Failed to open file mapping because " << std::strerror(errno) << logging::logbuilder::end;
+        return {};
+    }
+    if (ftruncate(fd, file_size) != 0)
+    {
+        logger.builder(logging::level::error) << "Failed to size output file because " << std::strerror(errno) << logging::logbuilder::end;
+        close(fd);
+        return {};
+    }
+    void *mmap_handle = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mmap_handle == MAP_FAILED)
+    {
+        logger.builder(logging::level::error) << "Failed to map view of file because " << std::strerror(errno) << logging::logbuilder::end;
+        close(fd);
+        return {};
+    }
+    return file_mapping{static_cast<char *>(mmap_handle), nullptr, ::fd_to_handle(fd), file_size};
+}
+
+void oops_bcode_compiler::platform::close_file_mapping(file_mapping fm, bool flush)
+{
+    if (flush && msync(fm.mmapped_file, fm.file_size, MS_SYNC) != 0)
+    {
+        logger.builder(logging::level::error) << "Failed to flush file view to disk because " << std::strerror(errno) << logging::logbuilder::end;
+    }
+    if (munmap(fm.mmapped_file, fm.file_size) != 0)
+    {
+        logger.builder(logging::level::error) << "Failed to unmap file view because " << std::strerror(errno) << logging::logbuilder::end;
+    }
+    if (close(::handle_to_fd(fm._file_handle)) != 0)
+    {
+        logger.builder(logging::level::error) << "Failed to close file handle because " << std::strerror(errno) << logging::logbuilder::end;
+    }
+}
+
+const char *oops_bcode_compiler::platform::get_working_path()
+{
+    return "./";
+}
+
+const char *oops_bcode_compiler::platform::get_executable_path()
+{
+    static char *executable_path = nullptr;
+    if (executable_path)
+        return executable_path;
+    std::size_t executable_size = 8;
+    ssize_t string_size = 0;
+    do
+    {
+        char *new_path = static_cast<char *>(std::realloc(executable_path, executable_size <<= 1));
+        if (new_path == nullptr)
+        {
+            std::free(executable_path);
+            return executable_path = nullptr;
+        }
+        executable_path = new_path;
+        string_size = readlink("/proc/self/exe", executable_path, executable_size);
+    } while (string_size >= 0 && static_cast<std::size_t>(string_size) == executable_size);
+    if (string_size < 0)
+    {
+        std::free(executable_path);
+        return executable_path = nullptr;
+    }
+    executable_path[string_size] = '\0';
+    logger.builder(logging::level::debug) << "Executable path is " << executable_path << logging::logbuilder::end;
+    return executable_path;
+}
+
+#endif
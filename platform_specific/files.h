@@ -18,6 +18,9 @@ namespace oops_bcode_compiler
 
         std::optional<file_mapping> create_class_file(std::string name, std::uint64_t size, std::string build_path);
 
+        //Maps the compiled class name under class_path read only, for running it
+        std::optional<file_mapping> open_compiled_class(std::string name, std::string class_path);
+
         void close_file_mapping(file_mapping fm, bool flush=false);
 
         const char* get_executable_path();
@@ -0,0 +1,206 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::profile;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    constexpr const char *magic = "oops-profile";
+    constexpr unsigned version = 1;
+} // namespace
+
+const method_profile *oops_bcode_compiler::profile::profile::find(const std::string &class_name, const std::string &method_name) const
+{
+    auto found = this->methods.find(class_name + "." + method_name);
+    return found == this->methods.end() ? nullptr : &found->second;
+}
+
+std::variant<profile, std::vector<std::string>> oops_bcode_compiler::profile::load(const std::string &filename)
+{
+#define profile_error(error)                                                                  \
+    std::stringstream error_builder;                                                          \
+    error_builder << error << " at line " << line_number << " of profile " << filename;       \
+    logger.builder(logging::level::debug) << error_builder.str() << logging::logbuilder::end; \
+    errors.push_back(error_builder.str())
+    std::vector<std::string> errors;
+    std::ifstream in(filename);
+    if (!in)
+    {
+        return std::vector<std::string>{"Unable to open profile " + filename};
+    }
+    profile prof;
+    method_profile *current = nullptr;
+    std::string line;
+    std::size_t line_number = 0;
+    bool seen_header = false;
+    while (std::getline(in, line))
+    {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string kind;
+        if (!(tokens >> kind))
+        {
+            continue;
+        }
+        if (!seen_header)
+        {
+            unsigned file_version;
+            if (kind != ::magic or !(tokens >> file_version) or file_version != ::version)
+            {
+                profile_error("Expected '" << ::magic << " " << ::version << "' header");
+                return errors;
+            }
+            seen_header = true;
+            continue;
+        }
+        if (kind == "method")
+        {
+            std::string name;
+            std::uint64_t invocations;
+            if (!(tokens >> name >> invocations))
+            {
+                profile_error("Malformed method entry");
+                current = nullptr;
+                continue;
+            }
+            current = &prof.methods[name];
+            current->invocations += invocations;
+        }
+        else if (kind == "branch" or kind == "call")
+        {
+            if (!current)
+            {
+                profile_error("Counts for " << kind << " do not belong to a method");
+                continue;
+            }
+            std::size_t index;
+            std::uint64_t first, second = 0;
+            if (!(tokens >> index >> first) or (kind == "branch" and !(tokens >> second)))
+            {
+                profile_error("Malformed " << kind << " entry");
+                continue;
+            }
+            if (kind == "branch")
+            {
+                current->branches[index].taken += first;
+                current->branches[index].not_taken += second;
+            }
+            else
+            {
+                current->calls[index] += first;
+            }
+        }
+        else
+        {
+            profile_error("Unknown profile entry " << kind);
+        }
+    }
+#undef profile_error
+    if (!errors.empty())
+    {
+        return errors;
+    }
+    logger.builder(logging::level::info) << "Loaded profile " << filename << " with " << prof.methods.size() << " methods" << logging::logbuilder::end;
+    return prof;
+}
+
+std::vector<std::string> oops_bcode_compiler::profile::save(const profile &prof, const std::string &filename)
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        return {"Unable to write profile " + filename};
+    }
+    out << ::magic << " " << ::version << "\n";
+    for (auto &[name, mprof] : prof.methods)
+    {
+        out << "method " << name << " " << mprof.invocations << "\n";
+        for (auto &[index, counts] : mprof.branches)
+        {
+            out << "branch " << index << " " << counts.taken << " " << counts.not_taken << "\n";
+        }
+        for (auto &[index, count] : mprof.calls)
+        {
+            out << "call " << index << " " << count << "\n";
+        }
+    }
+    if (!out)
+    {
+        return {"Failed while writing profile " + filename};
+    }
+    return {};
+}
+
+void oops_bcode_compiler::profile::merge(profile &into, const profile &from)
+{
+    for (auto &[name, mprof] : from.methods)
+    {
+        auto &merged = into.methods[name];
+        merged.invocations += mprof.invocations;
+        for (auto &[index, counts] : mprof.branches)
+        {
+            merged.branches[index].taken += counts.taken;
+            merged.branches[index].not_taken += counts.not_taken;
+        }
+        for (auto &[index, count] : mprof.calls)
+        {
+            merged.calls[index] += count;
+        }
+    }
+}
+
+void oops_bcode_compiler::profile::record_counters(profile &prof, const std::string &method_name, const std::vector<counter> &counters, const std::vector<std::uint64_t> &values)
+{
+    auto &mprof = prof.methods[method_name];
+    std::map<std::size_t, std::uint64_t> executions;
+    //The one side of each branch that got a counter
+    std::map<std::size_t, std::pair<counter_kind, std::uint64_t>> sides;
+    for (std::size_t i = 0; i < counters.size() and i < values.size(); i++)
+    {
+        auto index = counters[i].source_index;
+        switch (counters[i].kind)
+        {
+        case counter_kind::ENTRY:
+            mprof.invocations += values[i];
+            break;
+        case counter_kind::BRANCH:
+            executions[index] += values[i];
+            break;
+        case counter_kind::BRANCH_NOT_TAKEN:
+        case counter_kind::BRANCH_TAKEN:
+            sides[index].first = counters[i].kind;
+            sides[index].second += values[i];
+            break;
+        case counter_kind::CALL:
+            mprof.calls[index] += values[i];
+            break;
+        }
+    }
+    for (auto &[index, executed] : executions)
+    {
+        auto side = sides.find(index);
+        if (side == sides.end())
+        {
+            continue;
+        }
+        auto counted = std::min(executed, side->second.second);
+        auto &counts = mprof.branches[index];
+        if (side->second.first == counter_kind::BRANCH_TAKEN)
+        {
+            counts.taken += counted;
+            counts.not_taken += executed - counted;
+        }
+        else
+        {
+            counts.not_taken += counted;
+            counts.taken += executed - counted;
+        }
+    }
+}
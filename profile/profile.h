@@ -0,0 +1,73 @@
+#ifndef PROFILE_PROFILE
+#define PROFILE_PROFILE
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace oops_bcode_compiler
+{
+    namespace profile
+    {
+        //Instruction indexes count every instruction of the source procedure body, DEF and LBL included,
+        //so a profile stays valid across compiler versions that emit different bytecode for the same method.
+        //
+        //On disk a profile is plain text:
+        //  oops-profile 1
+        //  method <class>.<method> <invocations>
+        //  branch <instruction index> <taken> <not taken>
+        //  call <instruction index> <count>
+        //Branch and call lines belong to the closest preceding method line; '#' starts a comment.
+        struct branch_counts
+        {
+            std::uint64_t taken;
+            std::uint64_t not_taken;
+        };
+
+        struct method_profile
+        {
+            std::uint64_t invocations;
+            std::map<std::size_t, branch_counts> branches;
+            std::map<std::size_t, std::uint64_t> calls;
+        };
+
+        enum class counter_kind : std::uint8_t
+        {
+            ENTRY,
+            //Executions of a conditional branch
+            BRANCH,
+            //Executions that skipped the source branch; layout may have inverted the emitted one
+            BRANCH_NOT_TAKEN,
+            BRANCH_TAKEN,
+            CALL
+        };
+
+        //Describes what the counter of an instrumented method counts
+        struct counter
+        {
+            counter_kind kind;
+            std::size_t source_index;
+        };
+
+        struct profile
+        {
+            std::map<std::string, method_profile> methods;
+
+            const method_profile *find(const std::string &class_name, const std::string &method_name) const;
+        };
+
+        std::variant<profile, std::vector<std::string>> load(const std::string &filename);
+
+        std::vector<std::string> save(const profile &prof, const std::string &filename);
+
+        //Sums the counts of from into into
+        void merge(profile &into, const profile &from);
+
+        //Adds the counter values an instrumented method dumped to the profile of method_name
+        void record_counters(profile &prof, const std::string &method_name, const std::vector<counter> &counters, const std::vector<std::uint64_t> &values);
+    } // namespace profile
+} // namespace oops_bcode_compiler
+
+#endif /* PROFILE_PROFILE */
@@ -0,0 +1,951 @@
+#ifndef READER_READER
+#define READER_READER
+
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+#include "../utils/puns.h"
+
+namespace oops_bcode_compiler
+{
+    namespace reader
+    {
+        //A .coops image starts with these offsets, in this order
+        enum class section : std::uint8_t
+        {
+            CLASSES,
+            METHODS,
+            STATICS,
+            INSTANCES,
+            BYTECODE,
+            STRINGS,
+            //Added after the original six so that they keep their positions
+            CONSTANTS,
+            NATIVE,
+            __COUNT__
+        };
+
+        //Index 6 of a class table is the class itself; 0 to 5 stand for the primitive types
+        constexpr std::uint32_t self_class = 6;
+        constexpr std::uint8_t static_method_type = 5;
+
+        //A window of the mapped image. Every read checks that it stays inside, so a truncated file reads as missing values.
+        class bytes
+        {
+            const char *start;
+            std::size_t length;
+
+        public:
+            bytes() : start(nullptr), length(0) {}
+
+            bytes(const char *start, std::size_t length) : start(start), length(length) {}
+
+            const char *data() const
+            {
+                return this->start;
+            }
+
+            std::size_t size() const
+            {
+                return this->length;
+            }
+
+            bool contains(std::uint64_t offset, std::uint64_t count) const
+            {
+                return offset <= this->length and this->length - offset >= count;
+            }
+
+            template <typename primitive>
+            std::optional<primitive> read(std::uint64_t offset) const
+            {
+                if (!this->contains(offset, sizeof(primitive)))
+                {
+                    return {};
+                }
+                return utils::pun_read<primitive>(this->start + offset);
+            }
+
+            std::optional<bytes> slice(std::uint64_t offset, std::uint64_t count) const
+            {
+                if (!this->contains(offset, count))
+                {
+                    return {};
+                }
+                return bytes(this->start + offset, count);
+            }
+        };
+
+        namespace detail
+        {
+            //Argument and call types pack 4 bits each into words
+            constexpr std::size_t types_per_word = sizeof(std::uint64_t) * CHAR_BIT / 4;
+            constexpr std::size_t lanes_per_word = sizeof(std::uint64_t) / sizeof(std::uint16_t);
+            //Count and reserved word ahead of every table
+            constexpr std::uint64_t table_header = sizeof(std::uint32_t) * 2;
+            constexpr std::uint64_t symbol_row = sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t);
+
+            inline std::uint64_t words(std::uint64_t count, std::uint64_t per_word)
+            {
+                return (count + per_word - 1) / per_word * sizeof(std::uint64_t);
+            }
+
+            inline std::uint8_t nibble(const bytes &from, std::uint64_t offset, std::size_t i)
+            {
+                auto packed = from.read<std::uint64_t>(offset + i / types_per_word * sizeof(std::uint64_t));
+                return packed ? static_cast<std::uint8_t>(*packed >> (i % types_per_word * 4) & 0xf) : 0;
+            }
+        } // namespace detail
+
+        struct symbol
+        {
+            std::uint32_t class_index;
+            std::string_view name;
+        };
+
+        struct counter_descriptor
+        {
+            std::uint8_t kind;
+            std::uint32_t source_index;
+        };
+
+        struct stack_map
+        {
+            std::uint32_t instruction_index;
+            //Bitmask over the handle map, 16 handles per lane
+            bytes live_handles;
+
+            bool live(std::uint16_t handle) const
+            {
+                auto lane = this->live_handles.read<std::uint16_t>(handle / 16 * sizeof(std::uint16_t));
+                return lane and *lane >> (handle % 16) & 1;
+            }
+        };
+
+        struct handler
+        {
+            std::uint16_t begin;
+            std::uint16_t end;
+            std::uint16_t target;
+            std::uint16_t slot;
+            std::uint32_t class_index;
+        };
+
+        struct call_descriptor
+        {
+            std::uint32_t instruction_index;
+            std::uint8_t return_type;
+            std::uint32_t argument_count;
+            bytes argument_types;
+
+            std::optional<std::uint8_t> argument_type(std::uint32_t i) const
+            {
+                if (i >= this->argument_count)
+                {
+                    return {};
+                }
+                return detail::nibble(this->argument_types, 0, i);
+            }
+        };
+
+        struct record
+        {
+            std::uint8_t handler;
+            std::uint8_t flags;
+            std::uint16_t dest;
+            std::uint16_t src1;
+            std::uint16_t src2;
+            std::int64_t imm;
+        };
+
+        //One method of the bytecode section. parse works out where each of its tables sits, and the accessors read
+        //the tables from the mapping on every call.
+        class method_view
+        {
+            bytes body;
+            std::uint16_t meta;
+            std::uint64_t args_at;
+            std::uint64_t code_at;
+            std::uint64_t handles_at;
+            std::uint64_t counters_at;
+            std::uint64_t maps_at;
+            std::uint64_t handlers_at;
+            std::uint64_t calls_at;
+            std::uint64_t records_at;
+
+            bool flag(unsigned bit) const
+            {
+                return this->meta >> bit & 1;
+            }
+
+            std::uint64_t count_at(std::uint64_t offset) const
+            {
+                return offset ? this->body.read<std::uint64_t>(offset).value_or(0) : 0;
+            }
+
+            template <typename primitive>
+            std::optional<primitive> lane(std::uint64_t offset, std::uint64_t count, std::uint64_t i) const
+            {
+                if (i >= count)
+                {
+                    return {};
+                }
+                return this->body.read<primitive>(offset + i * sizeof(primitive));
+            }
+
+        public:
+            //Takes the bytes from the method's size word to the end of the section, and fails if any table of
+            //the method would run past its size
+            static std::optional<method_view> parse(bytes rest)
+            {
+                auto size = rest.read<std::uint64_t>(0);
+                if (!size or *size < sizeof(std::uint64_t) * 2 or !rest.contains(0, *size))
+                {
+                    return {};
+                }
+                method_view mtd;
+                mtd.body = *rest.slice(0, *size);
+                mtd.meta = *mtd.body.read<std::uint16_t>(sizeof(std::uint64_t) + sizeof(std::uint16_t) * 2);
+                std::uint64_t head = sizeof(std::uint64_t) * 2;
+                //Skips the verification hash
+                head += mtd.verified() ? sizeof(std::uint64_t) : 0;
+                mtd.args_at = head;
+                head += detail::words(mtd.argument_count(), detail::types_per_word);
+                mtd.code_at = head;
+                head += mtd.compact() ? detail::words(mtd.length(), 2) : mtd.length() * sizeof(std::uint64_t);
+                head += sizeof(std::uint64_t);
+                mtd.handles_at = head;
+                auto handles = mtd.body.read<std::uint16_t>(head);
+                if (!handles)
+                {
+                    return {};
+                }
+                head += detail::words(*handles + 1, detail::lanes_per_word);
+                //Each optional table starts with its count word, and an offset of 0 means the method has none
+                mtd.counters_at = mtd.maps_at = mtd.handlers_at = mtd.calls_at = mtd.records_at = 0;
+                auto table = [&mtd, &head](bool present, std::uint64_t &at, auto width) {
+                    if (!present)
+                    {
+                        return true;
+                    }
+                    at = head;
+                    auto count = mtd.body.read<std::uint64_t>(head);
+                    if (!count or *count > mtd.body.size())
+                    {
+                        return false;
+                    }
+                    head += sizeof(std::uint64_t) + width(*count);
+                    return true;
+                };
+                auto lanes_per_map = 1 + (*handles + 15) / 16;
+                bool fits = table(mtd.instrumented(), mtd.counters_at, [](std::uint64_t count) { return count * sizeof(std::uint64_t); });
+                fits = fits and table(mtd.has_stack_maps(), mtd.maps_at, [lanes_per_map](std::uint64_t count) { return detail::words(count * lanes_per_map, detail::lanes_per_word); });
+                fits = fits and table(mtd.has_handlers(), mtd.handlers_at, [](std::uint64_t count) { return count * sizeof(std::uint64_t) * 2; });
+                //Call descriptors vary in size, so the walk checks each one against the method as it goes
+                fits = fits and table(mtd.verified(), mtd.calls_at, [&mtd, &head](std::uint64_t count) {
+                    std::uint64_t width = 0;
+                    for (std::uint64_t i = 0; i < count; i++)
+                    {
+                        auto call = mtd.body.read<std::uint64_t>(head + sizeof(std::uint64_t) + width);
+                        if (!call)
+                        {
+                            //Too wide for the method, so the size check below fails
+                            return static_cast<std::uint64_t>(mtd.body.size());
+                        }
+                        width += sizeof(std::uint64_t) + detail::words(*call >> 40, detail::types_per_word);
+                    }
+                    return width;
+                });
+                fits = fits and table(mtd.predecoded(), mtd.records_at, [](std::uint64_t count) { return count * sizeof(std::uint64_t) * 2; });
+                if (!fits or head > mtd.body.size())
+                {
+                    return {};
+                }
+                return mtd;
+            }
+
+            //Of the whole method, size word included
+            std::uint64_t size() const
+            {
+                return this->body.size();
+            }
+
+            bytes raw() const
+            {
+                return this->body;
+            }
+
+            //In words, or in 32-bit units for a compact body
+            std::uint16_t length() const
+            {
+                return *this->body.read<std::uint16_t>(sizeof(std::uint64_t));
+            }
+
+            std::uint16_t stack_size() const
+            {
+                return *this->body.read<std::uint16_t>(sizeof(std::uint64_t) + sizeof(std::uint16_t));
+            }
+
+            std::uint8_t return_type() const
+            {
+                return this->meta & 0xf;
+            }
+
+            std::uint8_t method_type() const
+            {
+                return this->meta >> 4 & 0xf;
+            }
+
+            bool is_static() const
+            {
+                return this->method_type() == static_method_type;
+            }
+
+            bool instrumented() const
+            {
+                return this->flag(8);
+            }
+
+            bool has_stack_maps() const
+            {
+                return this->flag(9);
+            }
+
+            bool verified() const
+            {
+                return this->flag(10);
+            }
+
+            bool aligned_frame() const
+            {
+                return this->flag(11);
+            }
+
+            bool has_handlers() const
+            {
+                return this->flag(12);
+            }
+
+            bool compact() const
+            {
+                return this->flag(13);
+            }
+
+            bool predecoded() const
+            {
+                return this->flag(14);
+            }
+
+            std::optional<std::uint64_t> verification_hash() const
+            {
+                if (!this->verified())
+                {
+                    return {};
+                }
+                return this->body.read<std::uint64_t>(sizeof(std::uint64_t) * 2);
+            }
+
+            std::uint16_t argument_count() const
+            {
+                return *this->body.read<std::uint16_t>(sizeof(std::uint64_t) + sizeof(std::uint16_t) * 3);
+            }
+
+            std::optional<std::uint8_t> argument_type(std::uint16_t i) const
+            {
+                if (i >= this->argument_count())
+                {
+                    return {};
+                }
+                return detail::nibble(this->body, this->args_at, i);
+            }
+
+            //The words of a word body, or the units of a compact one, padded to a whole word
+            bytes code() const
+            {
+                return *this->body.slice(this->code_at, this->compact() ? detail::words(this->length(), 2) : this->length() * sizeof(std::uint64_t));
+            }
+
+            std::optional<std::uint64_t> word(std::uint16_t i) const
+            {
+                return this->compact() ? std::nullopt : this->lane<std::uint64_t>(this->code_at, this->length(), i);
+            }
+
+            std::optional<std::uint32_t> unit(std::uint16_t i) const
+            {
+                return this->compact() ? this->lane<std::uint32_t>(this->code_at, this->length(), i) : std::nullopt;
+            }
+
+            std::uint16_t handle_count() const
+            {
+                return *this->body.read<std::uint16_t>(this->handles_at);
+            }
+
+            //The frame slot of handle i, after the count lane
+            std::optional<std::uint16_t> handle(std::uint16_t i) const
+            {
+                return this->lane<std::uint16_t>(this->handles_at + sizeof(std::uint16_t), this->handle_count(), i);
+            }
+
+            std::uint64_t counter_count() const
+            {
+                return this->count_at(this->counters_at);
+            }
+
+            std::optional<counter_descriptor> counter(std::uint64_t i) const
+            {
+                auto counter = this->lane<std::uint64_t>(this->counters_at + sizeof(std::uint64_t), this->counter_count(), i);
+                if (!counter)
+                {
+                    return {};
+                }
+                return counter_descriptor{static_cast<std::uint8_t>(*counter >> 32 & 0xff), static_cast<std::uint32_t>(*counter)};
+            }
+
+            std::uint64_t stack_map_count() const
+            {
+                return this->count_at(this->maps_at);
+            }
+
+            //Maps store the distance from the previous one, so this adds up the i before it
+            std::optional<stack_map> map(std::uint64_t i) const
+            {
+                if (i >= this->stack_map_count())
+                {
+                    return {};
+                }
+                std::uint64_t live_lanes = (this->handle_count() + 15) / 16;
+                auto lanes = this->maps_at + sizeof(std::uint64_t);
+                std::uint32_t instruction_index = 0;
+                for (std::uint64_t j = 0; j <= i; j++)
+                {
+                    instruction_index += *this->body.read<std::uint16_t>(lanes + j * (1 + live_lanes) * sizeof(std::uint16_t));
+                }
+                return stack_map{instruction_index, *this->body.slice(lanes + (i * (1 + live_lanes) + 1) * sizeof(std::uint16_t), live_lanes * sizeof(std::uint16_t))};
+            }
+
+            std::uint64_t handler_count() const
+            {
+                return this->count_at(this->handlers_at);
+            }
+
+            std::optional<handler> exception_handler(std::uint64_t i) const
+            {
+                if (i >= this->handler_count())
+                {
+                    return {};
+                }
+                auto at = this->handlers_at + sizeof(std::uint64_t) + i * sizeof(std::uint64_t) * 2;
+                auto range = *this->body.read<std::uint64_t>(at);
+                return handler{static_cast<std::uint16_t>(range), static_cast<std::uint16_t>(range >> 16), static_cast<std::uint16_t>(range >> 32), static_cast<std::uint16_t>(range >> 48), static_cast<std::uint32_t>(*this->body.read<std::uint64_t>(at + sizeof(std::uint64_t)))};
+            }
+
+            std::uint64_t call_count() const
+            {
+                return this->count_at(this->calls_at);
+            }
+
+            //Descriptors vary in size, so this walks past the i before it
+            std::optional<call_descriptor> call(std::uint64_t i) const
+            {
+                if (i >= this->call_count())
+                {
+                    return {};
+                }
+                auto at = this->calls_at + sizeof(std::uint64_t);
+                for (std::uint64_t j = 0;; j++)
+                {
+                    auto call = *this->body.read<std::uint64_t>(at);
+                    auto types = detail::words(call >> 40, detail::types_per_word);
+                    if (j == i)
+                    {
+                        return call_descriptor{static_cast<std::uint32_t>(call), static_cast<std::uint8_t>(call >> 32), static_cast<std::uint32_t>(call >> 40), *this->body.slice(at + sizeof(std::uint64_t), types)};
+                    }
+                    at += sizeof(std::uint64_t) + types;
+                }
+            }
+
+            std::uint64_t record_count() const
+            {
+                return this->count_at(this->records_at);
+            }
+
+            std::optional<reader::record> record(std::uint64_t i) const
+            {
+                if (i >= this->record_count())
+                {
+                    return {};
+                }
+                auto at = this->records_at + sizeof(std::uint64_t) + i * sizeof(std::uint64_t) * 2;
+                auto fields = *this->body.read<std::uint64_t>(at);
+                return reader::record{static_cast<std::uint8_t>(fields), static_cast<std::uint8_t>(fields >> 8), static_cast<std::uint16_t>(fields >> 16), static_cast<std::uint16_t>(fields >> 32), static_cast<std::uint16_t>(fields >> 48), *this->body.read<std::int64_t>(at + sizeof(std::uint64_t))};
+            }
+        };
+
+        //Walks the methods of a bytecode section that image::open has already checked
+        class method_iterator
+        {
+            bytes section;
+            std::uint64_t offset;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = method_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const method_view *;
+            using reference = method_view;
+
+            method_iterator(bytes section, std::uint64_t offset) : section(section), offset(offset) {}
+
+            method_view operator*() const
+            {
+                return *method_view::parse(*this->section.slice(this->offset, this->section.size() - this->offset));
+            }
+
+            method_iterator &operator++()
+            {
+                this->offset += *this->section.read<std::uint64_t>(this->offset);
+                return *this;
+            }
+
+            method_iterator operator++(int)
+            {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            bool operator==(const method_iterator &other) const
+            {
+                return this->offset == other.offset;
+            }
+
+            bool operator!=(const method_iterator &other) const
+            {
+                return !(*this == other);
+            }
+        };
+
+        class image;
+
+        //The class table: imported class names after a count and the number of supertypes, which follow the class itself
+        class class_table
+        {
+            const image *img;
+
+        public:
+            explicit class_table(const image *img) : img(img) {}
+
+            //Of class indexes from self_class on
+            std::uint32_t size() const;
+
+            std::uint32_t supertype_count() const;
+
+            //Empty for the primitive indexes
+            std::optional<std::string_view> name(std::uint32_t class_index) const;
+
+            std::optional<std::uint32_t> find(std::string_view name) const;
+        };
+
+        //The method, static or instance table: a count, a second word and 16-byte rows of class index and name offset
+        class symbol_table
+        {
+            const image *img;
+            std::uint64_t offset;
+
+        public:
+            symbol_table(const image *img, std::uint64_t offset) : img(img), offset(offset) {}
+
+            std::uint32_t size() const;
+
+            //The static method count for the method table, 0 for the others
+            std::uint32_t second() const;
+
+            std::optional<symbol> row(std::uint32_t i) const;
+
+            //The last row naming name in class_index, as later rows shadow earlier ones
+            std::optional<std::uint32_t> find(std::uint32_t class_index, std::string_view name) const;
+        };
+
+        class constant_pool
+        {
+            const image *img;
+
+        public:
+            explicit constant_pool(const image *img) : img(img) {}
+
+            std::uint32_t size() const;
+
+            std::optional<std::uint64_t> at(std::uint32_t i) const;
+        };
+
+        class bytecode_section
+        {
+            bytes section;
+            std::uint64_t count;
+
+        public:
+            bytecode_section(bytes section, std::uint64_t count) : section(section), count(count) {}
+
+            std::uint64_t size() const
+            {
+                return this->count;
+            }
+
+            //The first method sits after the section's size word
+            method_iterator begin() const
+            {
+                return method_iterator(this->section, sizeof(std::uint64_t));
+            }
+
+            method_iterator end() const
+            {
+                return method_iterator(this->section, this->section.size());
+            }
+        };
+
+        //A method count, then per method the offset of its code from the section start and its size, zero for none
+        class native_section
+        {
+            bytes section;
+
+        public:
+            explicit native_section(bytes section) : section(section) {}
+
+            std::uint64_t size() const
+            {
+                return this->section.read<std::uint64_t>(0).value_or(0);
+            }
+
+            //Whether the offset table fits; the code of each method is checked as it is read
+            bool intact() const
+            {
+                auto count = this->section.read<std::uint64_t>(0);
+                return count and *count < this->section.size() and this->section.contains(0, sizeof(std::uint64_t) * (*count + 1));
+            }
+
+            std::optional<bytes> code(std::uint64_t i) const
+            {
+                if (i >= this->size())
+                {
+                    return {};
+                }
+                auto offset = *this->section.read<std::uint32_t>(sizeof(std::uint64_t) * (i + 1));
+                auto length = *this->section.read<std::uint32_t>(sizeof(std::uint64_t) * (i + 1) + sizeof(std::uint32_t));
+                if (length == 0)
+                {
+                    return {};
+                }
+                return this->section.slice(offset, length);
+            }
+        };
+
+        //A compiled class read in place from its mapping, which must outlive the image and every view taken from it.
+        //open checks the header, the tables and every method layout once, so the views only check indexes after that.
+        class image
+        {
+            bytes file;
+            std::uint64_t offsets[static_cast<unsigned>(section::__COUNT__)];
+            std::uint64_t method_count;
+
+            friend class class_table;
+            friend class symbol_table;
+            friend class constant_pool;
+
+            std::uint64_t at(section which) const
+            {
+                return this->offsets[static_cast<unsigned>(which)];
+            }
+
+            //The string section runs to the native section, if there is one
+            std::uint64_t strings_end() const
+            {
+                return this->at(section::NATIVE) ? this->at(section::NATIVE) : this->file.size();
+            }
+
+            std::uint32_t table_size(section which) const
+            {
+                return *this->file.read<std::uint32_t>(this->at(which));
+            }
+
+            bool table_fits(section which, section next, std::uint64_t row) const
+            {
+                auto count = this->file.read<std::uint32_t>(this->at(which));
+                return count and this->at(next) - this->at(which) >= detail::table_header + *count * row;
+            }
+
+        public:
+            static std::optional<image> open(const char *mmapped_file, std::size_t file_size)
+            {
+                image img;
+                img.file = bytes(mmapped_file, file_size);
+                for (unsigned i = 0; i < static_cast<unsigned>(section::__COUNT__); i++)
+                {
+                    auto offset = img.file.read<std::uint64_t>(i * sizeof(std::uint64_t));
+                    if (!offset)
+                    {
+                        return {};
+                    }
+                    img.offsets[i] = *offset;
+                }
+                //Sections follow each other in file order, which is not header order
+                const section order[] = {section::CLASSES, section::METHODS, section::STATICS, section::INSTANCES, section::CONSTANTS, section::BYTECODE, section::STRINGS};
+                std::uint64_t previous = sizeof(img.offsets);
+                for (auto which : order)
+                {
+                    if (img.at(which) < previous or img.at(which) % sizeof(std::uint32_t))
+                    {
+                        return {};
+                    }
+                    previous = img.at(which);
+                }
+                if (img.at(section::NATIVE) and img.at(section::NATIVE) < previous)
+                {
+                    return {};
+                }
+                if (img.strings_end() < previous or img.strings_end() > file_size)
+                {
+                    return {};
+                }
+                if (auto native = img.native(); native and !native->intact())
+                {
+                    return {};
+                }
+                if (!img.table_fits(section::CLASSES, section::METHODS, sizeof(std::uint64_t)) or !img.table_fits(section::METHODS, section::STATICS, detail::symbol_row) or !img.table_fits(section::STATICS, section::INSTANCES, detail::symbol_row) or !img.table_fits(section::INSTANCES, section::CONSTANTS, detail::symbol_row) or !img.table_fits(section::CONSTANTS, section::BYTECODE, sizeof(std::uint64_t)))
+                {
+                    return {};
+                }
+                auto bytecode = *img.file.slice(img.at(section::BYTECODE), img.at(section::STRINGS) - img.at(section::BYTECODE));
+                if (bytecode.read<std::uint64_t>(0) != bytecode.size())
+                {
+                    return {};
+                }
+                auto classes = img.classes();
+                for (std::uint32_t i = 0; i < classes.size(); i++)
+                {
+                    if (!classes.name(i + self_class))
+                    {
+                        return {};
+                    }
+                }
+                for (auto table : {img.methods(), img.statics(), img.instances()})
+                {
+                    for (std::uint32_t i = 0; i < table.size(); i++)
+                    {
+                        if (!table.row(i))
+                        {
+                            return {};
+                        }
+                    }
+                }
+                img.method_count = 0;
+                for (std::uint64_t offset = sizeof(std::uint64_t); offset < bytecode.size(); img.method_count++)
+                {
+                    auto mtd = method_view::parse(*bytecode.slice(offset, bytecode.size() - offset));
+                    if (!mtd)
+                    {
+                        return {};
+                    }
+                    offset += mtd->size();
+                }
+                return img;
+            }
+
+            bytes raw() const
+            {
+                return this->file;
+            }
+
+            class_table classes() const
+            {
+                return class_table(this);
+            }
+
+            symbol_table methods() const
+            {
+                return symbol_table(this, this->at(section::METHODS));
+            }
+
+            //IMP SVAR lines are filed with the method imports by the parser, so instructions index statics through methods()
+            symbol_table statics() const
+            {
+                return symbol_table(this, this->at(section::STATICS));
+            }
+
+            symbol_table instances() const
+            {
+                return symbol_table(this, this->at(section::INSTANCES));
+            }
+
+            constant_pool constants() const
+            {
+                return constant_pool(this);
+            }
+
+            bytecode_section bytecode() const
+            {
+                return bytecode_section(*this->file.slice(this->at(section::BYTECODE), this->at(section::STRINGS) - this->at(section::BYTECODE)), this->method_count);
+            }
+
+            bytes strings() const
+            {
+                return *this->file.slice(this->at(section::STRINGS), this->strings_end() - this->at(section::STRINGS));
+            }
+
+            std::optional<native_section> native() const
+            {
+                if (!this->at(section::NATIVE))
+                {
+                    return {};
+                }
+                return native_section(*this->file.slice(this->at(section::NATIVE), this->file.size() - this->at(section::NATIVE)));
+            }
+
+            //A length-prefixed string at an offset from the start of the file, which must lie in the string section
+            std::optional<std::string_view> string(std::uint64_t offset) const
+            {
+                if (offset < this->at(section::STRINGS))
+                {
+                    return {};
+                }
+                auto strings = this->strings();
+                offset -= this->at(section::STRINGS);
+                auto length = strings.read<std::uint32_t>(offset);
+                if (!length or !strings.contains(offset + sizeof(std::uint32_t), *length))
+                {
+                    return {};
+                }
+                return std::string_view(strings.data() + offset + sizeof(std::uint32_t), *length);
+            }
+
+            //Bodies carry no names of their own, so they take those of the last rows of the method table the class hosts,
+            //which its PROC lines add in order
+            std::optional<std::string_view> method_name(std::uint64_t body) const
+            {
+                auto table = this->methods();
+                std::uint64_t hosted = 0;
+                for (std::uint32_t i = 0; i < table.size(); i++)
+                {
+                    hosted += table.row(i) and table.row(i)->class_index == self_class;
+                }
+                if (body >= this->method_count or hosted < this->method_count)
+                {
+                    return {};
+                }
+                auto wanted = hosted - this->method_count + body;
+                for (std::uint32_t i = 0; i < table.size(); i++)
+                {
+                    auto row = table.row(i);
+                    if (row and row->class_index == self_class and wanted-- == 0)
+                    {
+                        return row->name;
+                    }
+                }
+                return {};
+            }
+
+            std::optional<method_view> find_method(std::string_view name) const
+            {
+                std::uint64_t body = 0;
+                std::optional<method_view> found;
+                for (auto mtd : this->bytecode())
+                {
+                    if (this->method_name(body++) == name)
+                    {
+                        found = mtd;
+                    }
+                }
+                return found;
+            }
+        };
+
+        inline std::uint32_t class_table::size() const
+        {
+            return this->img->table_size(section::CLASSES);
+        }
+
+        inline std::uint32_t class_table::supertype_count() const
+        {
+            return *this->img->file.read<std::uint32_t>(this->img->at(section::CLASSES) + sizeof(std::uint32_t));
+        }
+
+        inline std::optional<std::string_view> class_table::name(std::uint32_t class_index) const
+        {
+            if (class_index < self_class)
+            {
+                return std::string_view();
+            }
+            if (class_index - self_class >= this->size())
+            {
+                return {};
+            }
+            return this->img->string(*this->img->file.read<std::uint64_t>(this->img->at(section::CLASSES) + detail::table_header + (class_index - self_class) * sizeof(std::uint64_t)));
+        }
+
+        inline std::optional<std::uint32_t> class_table::find(std::string_view name) const
+        {
+            for (std::uint32_t i = 0; i < this->size(); i++)
+            {
+                if (this->name(i + self_class) == name)
+                {
+                    return i + self_class;
+                }
+            }
+            return {};
+        }
+
+        inline std::uint32_t symbol_table::size() const
+        {
+            return *this->img->file.read<std::uint32_t>(this->offset);
+        }
+
+        inline std::uint32_t symbol_table::second() const
+        {
+            return *this->img->file.read<std::uint32_t>(this->offset + sizeof(std::uint32_t));
+        }
+
+        inline std::optional<symbol> symbol_table::row(std::uint32_t i) const
+        {
+            if (i >= this->size())
+            {
+                return {};
+            }
+            auto at = this->offset + detail::table_header + i * detail::symbol_row;
+            auto name = this->img->string(*this->img->file.read<std::uint64_t>(at + sizeof(std::uint32_t) * 2));
+            if (!name)
+            {
+                return {};
+            }
+            return symbol{*this->img->file.read<std::uint32_t>(at), *name};
+        }
+
+        inline std::optional<std::uint32_t> symbol_table::find(std::uint32_t class_index, std::string_view name) const
+        {
+            for (auto i = this->size(); i-- > 0;)
+            {
+                if (auto row = this->row(i); row and row->class_index == class_index and row->name == name)
+                {
+                    return i;
+                }
+            }
+            return {};
+        }
+
+        inline std::uint32_t constant_pool::size() const
+        {
+            return this->img->table_size(section::CONSTANTS);
+        }
+
+        inline std::optional<std::uint64_t> constant_pool::at(std::uint32_t i) const
+        {
+            if (i >= this->size())
+            {
+                return {};
+            }
+            return this->img->file.read<std::uint64_t>(this->img->at(section::CONSTANTS) + detail::table_header + i * sizeof(std::uint64_t));
+        }
+    } // namespace reader
+} // namespace oops_bcode_compiler
+
+#endif /* READER_READER */
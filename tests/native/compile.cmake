@@ -0,0 +1,10 @@
+#Compiles the native fixtures at one optimization level with --emit-native into SCRATCH/O<LEVEL>
+#Expects COMPILER, LEVEL, FIXTURES and SCRATCH
+file(REMOVE_RECURSE ${SCRATCH}/O${LEVEL})
+foreach(cls Loop Switch Pool)
+    execute_process(COMMAND ${COMPILER} --file native.${cls} --build-path ${SCRATCH}/O${LEVEL} -O${LEVEL} --emit-native
+        WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Compiling native.${cls} at -O${LEVEL} failed with ${result}")
+    endif()
+endforeach()
@@ -0,0 +1,297 @@
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../instructions/bytecode.h"
+#include "../../reader/reader.h"
+#include "../../utils/puns.h"
+
+using namespace oops_bcode_compiler;
+using namespace oops_bcode_compiler::bytecode;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failures++;
+        }
+    }
+
+    using native_method = std::uint64_t (*)(std::int32_t *frame, void *context);
+
+    //The context a native method is called with. Its first word must be the slow path, so it stays the first member.
+    struct context
+    {
+        std::uint32_t (*slow_path)(void *context, std::int32_t *frame, std::uint32_t word);
+        reader::method_view mtd;
+        std::size_t slow_calls;
+        std::vector<std::string> unexpected;
+    };
+
+    //Runs the few words the fixtures leave to the slow path the way the VM does, and fails the test on any other
+    std::uint32_t slow_path(void *ctx, std::int32_t *frame, std::uint32_t at)
+    {
+        auto &self = *static_cast<::context *>(ctx);
+        self.slow_calls++;
+        auto word = *self.mtd.word(at);
+        std::uint16_t dest = word, src1 = word >> 16;
+        switch (opcode(word))
+        {
+        case itype::LCSTI:
+            utils::pun_write<std::int64_t>(frame + dest, utils::pun_read<std::int32_t>(frame + src1));
+            return at + 1;
+        case itype::BADR:
+        {
+            std::size_t entries = dest;
+            auto key = utils::pun_read<std::int32_t>(frame + src1);
+            auto head = *self.mtd.word(at + 1);
+            auto offset = static_cast<std::int32_t>(head);
+            if ((word >> 48) & sparse_table)
+            {
+                for (std::size_t i = 0; i < entries; i++)
+                {
+                    auto entry = *self.mtd.word(at + 2 + i);
+                    if (static_cast<std::int32_t>(entry >> 32) == key)
+                    {
+                        offset = static_cast<std::int32_t>(entry);
+                    }
+                }
+            }
+            else if (auto k = static_cast<std::int64_t>(key) - static_cast<std::int32_t>(head >> 32); k >= 0 and static_cast<std::size_t>(k) < entries)
+            {
+                offset = static_cast<std::int32_t>(*self.mtd.word(at + 2 + k / 2) >> (k % 2 * 32));
+            }
+            return at + offset;
+        }
+        default:
+            self.unexpected.push_back("word " + std::to_string(at) + " with opcode " + std::to_string(static_cast<unsigned>(opcode(word))));
+            return ~static_cast<std::uint32_t>(0);
+        }
+    }
+
+    //A compiled class with its native section mapped executable straight from the file
+    class native_class
+    {
+        int fd = -1;
+        const char *file = nullptr;
+        std::size_t file_size = 0;
+        const char *code = nullptr;
+        std::size_t code_offset = 0;
+        std::size_t code_size = 0;
+
+    public:
+        std::optional<reader::image> img;
+
+        explicit native_class(const std::string &filename)
+        {
+            struct stat st;
+            this->fd = ::open(filename.c_str(), O_RDONLY);
+            if (this->fd < 0 or ::fstat(this->fd, &st) < 0 or st.st_size == 0)
+            {
+                return;
+            }
+            this->file_size = st.st_size;
+            auto mapped = ::mmap(nullptr, this->file_size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                return;
+            }
+            this->file = static_cast<const char *>(mapped);
+            this->img = reader::image::open(this->file, this->file_size);
+            if (!this->img or !this->img->native())
+            {
+                return;
+            }
+            //The translator page-aligns the native section, so it maps on its own
+            this->code_offset = utils::pun_read<std::uint64_t>(this->file + static_cast<unsigned>(reader::section::NATIVE) * sizeof(std::uint64_t));
+            this->code_size = this->file_size - this->code_offset;
+            auto executable = ::mmap(nullptr, this->code_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, this->fd, this->code_offset);
+            if (executable == MAP_FAILED)
+            {
+                this->code_size = 0;
+                return;
+            }
+            this->code = static_cast<const char *>(executable);
+        }
+
+        native_class(const native_class &) = delete;
+        native_class &operator=(const native_class &) = delete;
+
+        ~native_class()
+        {
+            if (this->code)
+            {
+                ::munmap(const_cast<char *>(this->code), this->code_size);
+            }
+            if (this->file)
+            {
+                ::munmap(const_cast<char *>(this->file), this->file_size);
+            }
+            if (this->fd >= 0)
+            {
+                ::close(this->fd);
+            }
+        }
+
+        //The body and executable code of the named method, if it has any
+        std::optional<std::pair<reader::method_view, native_method>> find(std::string_view name) const
+        {
+            if (!this->code)
+            {
+                return {};
+            }
+            std::uint64_t body = 0;
+            for (auto mtd : this->img->bytecode())
+            {
+                if (this->img->method_name(body) == name)
+                {
+                    auto bytes = this->img->native()->code(body);
+                    if (!bytes)
+                    {
+                        return {};
+                    }
+                    auto offset = bytes->data() - this->file - this->code_offset;
+                    return std::make_pair(mtd, reinterpret_cast<native_method>(const_cast<char *>(this->code + offset)));
+                }
+                body++;
+            }
+            return {};
+        }
+    };
+
+    //Calls a native method on a fresh frame whose first slots hold the arguments and returns the raw bits of its result
+    template <typename argument>
+    std::optional<std::uint64_t> call(const native_class &cls, const std::string &name, argument arg, std::size_t *slow_calls = nullptr)
+    {
+        auto found = cls.find(name);
+        check(found.has_value(), name + " has native code");
+        if (!found)
+        {
+            return {};
+        }
+        //Slot indexes are 16-bit, so this frame holds any method
+        std::vector<std::int32_t> frame(std::size_t{1} << 17);
+        utils::pun_write(frame.data(), arg);
+        ::context ctx{::slow_path, found->first, 0, {}};
+        auto result = found->second(frame.data(), &ctx);
+        for (auto &word : ctx.unexpected)
+        {
+            check(false, name + " left " + word + " to the slow path");
+        }
+        if (slow_calls)
+        {
+            *slow_calls = ctx.slow_calls;
+        }
+        return result;
+    }
+
+    std::int32_t dense_reference(std::int32_t n)
+    {
+        std::int32_t state = 0, acc = 0;
+        for (std::int32_t i = 0; i < n; i++)
+        {
+            const std::int32_t add[] = {1, 3, -1, 7}, next[] = {2, 3, 1, 4};
+            if (state >= 0 and state < 4)
+            {
+                acc += add[state];
+                state = next[state];
+            }
+            else
+            {
+                acc += 100;
+                state = 0;
+            }
+        }
+        return acc;
+    }
+
+    void loop(const std::string &classes)
+    {
+        ::native_class cls(classes + "/native/Loop.coops");
+        check(cls.img.has_value(), "Loop.coops opens");
+        for (std::int32_t n : {0, 1, 10, 100000})
+        {
+            std::size_t slow_calls = 0;
+            auto result = ::call(cls, "squares", n, &slow_calls);
+            std::int64_t expected = static_cast<std::int64_t>(n - 1) * n * (2 * static_cast<std::int64_t>(n) - 1) / 6;
+            check(result and static_cast<std::int64_t>(*result) == expected, "squares(" + std::to_string(n) + ") is " + std::to_string(expected));
+            check(slow_calls == static_cast<std::size_t>(n), "squares(" + std::to_string(n) + ") takes the slow path once per cast");
+        }
+    }
+
+    void switches(const std::string &classes)
+    {
+        ::native_class cls(classes + "/native/Switch.coops");
+        check(cls.img.has_value(), "Switch.coops opens");
+        for (std::int32_t n : {0, 1, 5, 1000})
+        {
+            auto result = ::call(cls, "dense", n);
+            check(result and static_cast<std::int32_t>(*result) == ::dense_reference(n), "dense(" + std::to_string(n) + ") is " + std::to_string(::dense_reference(n)));
+        }
+        const std::pair<std::int32_t, std::int32_t> keys[] = {{-1000, 1}, {7, 2}, {90000, 3}, {0, 0}, {8, 0}, {-2147483647 - 1, 0}};
+        for (auto [key, expected] : keys)
+        {
+            auto result = ::call(cls, "sparse", key);
+            check(result and static_cast<std::int32_t>(*result) == expected, "sparse(" + std::to_string(key) + ") is " + std::to_string(expected));
+        }
+    }
+
+    void constants(const std::string &classes)
+    {
+        ::native_class cls(classes + "/native/Pool.coops");
+        check(cls.img.has_value(), "Pool.coops opens");
+        for (std::int64_t x : {std::int64_t{0}, std::int64_t{-5}, std::int64_t{1} << 40})
+        {
+            auto result = ::call(cls, "wide", x);
+            auto expected = (x + 1234567890123) ^ -9876543210987;
+            check(result and static_cast<std::int64_t>(*result) == expected, "wide(" + std::to_string(x) + ") is " + std::to_string(expected));
+        }
+        for (double x : {0.0, -3.0, 1e10})
+        {
+            auto result = ::call(cls, "scale", x);
+            auto expected = x * 0.5 + 3.25;
+            check(result and utils::pun_reinterpret<double>(*result) == expected, "scale(" + std::to_string(x) + ") is " + std::to_string(expected));
+        }
+    }
+} // namespace
+
+//Usage: native-tests loop|switch|constants <class directory>
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: native-tests loop|switch|constants <classes>" << std::endl;
+        return 2;
+    }
+    std::string test = argv[1];
+    if (test == "loop")
+    {
+        ::loop(argv[2]);
+    }
+    else if (test == "switch")
+    {
+        ::switches(argv[2]);
+    }
+    else if (test == "constants")
+    {
+        ::constants(argv[2]);
+    }
+    else
+    {
+        std::cerr << "Unknown test " << test << std::endl;
+        return 2;
+    }
+    return ::failures;
+}
@@ -0,0 +1,28 @@
+#Builds inline.Loop instrumented at -O1, runs it for a profile and rebuilds it with that profile. The instrumented build
+#inlines sq, so the profile has no count for its call site, which must leave the profiled build inlining it too.
+#Expects COMPILER, VM, FIXTURES and SCRATCH
+foreach(build instrumented profiled)
+    file(REMOVE_RECURSE ${SCRATCH}/${build})
+    file(MAKE_DIRECTORY ${SCRATCH}/${build})
+endforeach()
+execute_process(COMMAND ${COMPILER} --file inline.Loop --build-path ${SCRATCH}/instrumented -O1 --instrument --log-level debug
+    WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result OUTPUT_VARIABLE instrumented_log ERROR_VARIABLE instrumented_log)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Compiling the instrumented build failed with ${result}")
+endif()
+if(NOT instrumented_log MATCHES "Inlined sq into run")
+    message(FATAL_ERROR "The instrumented build did not inline sq")
+endif()
+execute_process(COMMAND ${VM} --class-path ${SCRATCH}/instrumented --profile-out ${SCRATCH}/inline.prof --run inline.Loop.run 10
+    RESULT_VARIABLE result OUTPUT_VARIABLE output OUTPUT_STRIP_TRAILING_WHITESPACE)
+if(NOT result EQUAL 0 OR NOT output STREQUAL "285")
+    message(FATAL_ERROR "run(10) gave ${output} with status ${result} instead of 285")
+endif()
+execute_process(COMMAND ${COMPILER} --file inline.Loop --build-path ${SCRATCH}/profiled -O1 --profile-use ${SCRATCH}/inline.prof --log-level debug
+    WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result OUTPUT_VARIABLE profiled_log ERROR_VARIABLE profiled_log)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Compiling with the profile failed with ${result}")
+endif()
+if(NOT profiled_log MATCHES "Inlined sq into run")
+    message(FATAL_ERROR "The profiled build stopped inlining sq")
+endif()
@@ -0,0 +1,40 @@
+#Compiles layout.Hot at -O1 with and without hot.prof, whose branch is always taken although the static estimate
+#calls it unlikely. Only the profiled build may invert the branch, and both builds must still compute the same results.
+#Expects COMPILER, VM, FIXTURES and SCRATCH
+foreach(build static profiled)
+    file(REMOVE_RECURSE ${SCRATCH}/${build})
+endforeach()
+execute_process(COMMAND ${COMPILER} --file layout.Hot --build-path ${SCRATCH}/static -O1 --log-level debug
+    WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result OUTPUT_VARIABLE static_log ERROR_VARIABLE static_log)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Compiling without a profile failed with ${result}")
+endif()
+execute_process(COMMAND ${COMPILER} --file layout.Hot --build-path ${SCRATCH}/profiled -O1 --profile-use ${FIXTURES}/hot.prof --log-level debug
+    WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result OUTPUT_VARIABLE profiled_log ERROR_VARIABLE profiled_log)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Compiling with hot.prof failed with ${result}")
+endif()
+if(static_log MATCHES "Inverting BEQI")
+    message(FATAL_ERROR "The static build inverted the branch")
+endif()
+if(NOT profiled_log MATCHES "Profiled branch to rare at line 4 taken with probability 1")
+    message(FATAL_ERROR "hot.prof was not applied to the branch")
+endif()
+if(NOT profiled_log MATCHES "Inverting BEQI at line 4 to fall through to rare")
+    message(FATAL_ERROR "The profiled build did not lay the taken target out as the fallthrough")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${SCRATCH}/static/layout/Hot.coops ${SCRATCH}/profiled/layout/Hot.coops RESULT_VARIABLE different)
+if(NOT different)
+    message(FATAL_ERROR "The profile did not change the emitted code")
+endif()
+foreach(n 0 4)
+    foreach(build static profiled)
+        execute_process(COMMAND ${VM} --class-path ${SCRATCH}/${build} --run layout.Hot.pick ${n} RESULT_VARIABLE result OUTPUT_VARIABLE ${build}_result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "Running the ${build} build on ${n} failed with ${result}")
+        endif()
+    endforeach()
+    if(NOT static_result STREQUAL profiled_result)
+        message(FATAL_ERROR "pick(${n}) is ${static_result} statically but ${profiled_result} with the profile")
+    endif()
+endforeach()
@@ -0,0 +1,19 @@
+#Runs oops-bcode-compiler --profile-merge on two hand-written profiles and compares the sum with merge.expected.prof
+#Expects COMPILER, FIXTURES and SCRATCH
+set(merged ${SCRATCH}/merged.prof)
+file(REMOVE ${merged})
+execute_process(COMMAND ${COMPILER} --profile-merge ${merged} ${FIXTURES}/merge_a.prof ${FIXTURES}/merge_b.prof RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "--profile-merge failed with ${result}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${merged} ${FIXTURES}/merge.expected.prof RESULT_VARIABLE different)
+if(different)
+    file(READ ${merged} contents)
+    message(FATAL_ERROR "Merged profile differs from merge.expected.prof:\n${contents}")
+endif()
+
+#A malformed input fails the merge instead of being skipped
+execute_process(COMMAND ${COMPILER} --profile-merge ${SCRATCH}/bad_merge.prof ${FIXTURES}/merge_a.prof ${FIXTURES}/short_branch.prof RESULT_VARIABLE result OUTPUT_QUIET ERROR_QUIET)
+if(result EQUAL 0)
+    message(FATAL_ERROR "--profile-merge accepted a malformed profile")
+endif()
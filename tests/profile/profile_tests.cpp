@@ -0,0 +1,128 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../../debug/logs.h"
+#include "../../profile/profile.h"
+
+using namespace oops_bcode_compiler;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+            failures++;
+        }
+    }
+
+    std::string read_file(const std::string &filename)
+    {
+        std::ifstream in(filename);
+        std::stringstream contents;
+        contents << in.rdbuf();
+        return contents.str();
+    }
+
+    bool same_profile(const profile::profile &a, const profile::profile &b)
+    {
+        if (a.methods.size() != b.methods.size())
+        {
+            return false;
+        }
+        for (auto &[name, mprof] : a.methods)
+        {
+            auto other = b.methods.find(name);
+            if (other == b.methods.end() or other->second.invocations != mprof.invocations or other->second.calls != mprof.calls or other->second.branches.size() != mprof.branches.size())
+            {
+                return false;
+            }
+            for (auto &[index, counts] : mprof.branches)
+            {
+                auto found = other->second.branches.find(index);
+                if (found == other->second.branches.end() or found->second.taken != counts.taken or found->second.not_taken != counts.not_taken)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    //Loads the hand-written basic.prof, checks what it sums to, then saves and reloads it
+    void round_trip(const std::string &fixtures, const std::string &scratch)
+    {
+        auto loaded = profile::load(fixtures + "/basic.prof");
+        check(std::holds_alternative<profile::profile>(loaded), "basic.prof loads");
+        if (!std::holds_alternative<profile::profile>(loaded))
+        {
+            return;
+        }
+        auto &prof = std::get<profile::profile>(loaded);
+        auto run = prof.find("demo.A", "run");
+        check(run and run->invocations == 12, "repeated method lines add their invocations");
+        check(run and run->branches.at(3).taken == 8 and run->branches.at(3).not_taken == 4, "repeated branch lines add their counts");
+        check(run and run->calls.at(5) == 10, "call counts load");
+        auto helper = prof.find("demo.A", "helper");
+        check(helper and helper->calls.at(2) == 4, "repeated call lines add their counts");
+        check(!prof.find("demo.A", "missing"), "unknown methods are not found");
+        auto saved = scratch + "/round_trip.prof";
+        check(profile::save(prof, saved).empty(), "profile saves");
+        check(::read_file(saved) == ::read_file(fixtures + "/basic.expected.prof"), "saved profile matches basic.expected.prof");
+        auto reloaded = profile::load(saved);
+        check(std::holds_alternative<profile::profile>(reloaded) and ::same_profile(prof, std::get<profile::profile>(reloaded)), "saved profile loads back unchanged");
+    }
+
+    //Every malformed fixture fails to load with an error naming its line
+    void malformed(const std::string &fixtures)
+    {
+        const std::vector<std::pair<std::string, std::string>> cases = {
+            {"missing_header.prof", "at line 1"},
+            {"wrong_version.prof", "at line 1"},
+            {"bad_method.prof", "at line 2"},
+            {"orphan_branch.prof", "at line 2"},
+            {"short_branch.prof", "at line 3"},
+            {"unknown_entry.prof", "at line 3"},
+        };
+        for (auto &[file, where] : cases)
+        {
+            auto loaded = profile::load(fixtures + "/" + file);
+            auto errors = std::get_if<std::vector<std::string>>(&loaded);
+            check(errors and !errors->empty(), file + " is rejected");
+            check(errors and !errors->empty() and errors->front().find(where) != std::string::npos, file + " reports its error " + where);
+        }
+        check(std::holds_alternative<std::vector<std::string>>(profile::load(fixtures + "/does_not_exist.prof")), "a missing profile is rejected");
+    }
+} // namespace
+
+//Usage: profile-tests round-trip|malformed <fixture directory> <scratch directory>
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        std::cerr << "Usage: profile-tests round-trip|malformed <fixtures> <scratch>" << std::endl;
+        return 2;
+    }
+    debug::logger.set_level(debug::logging::level::error);
+    std::string test = argv[1];
+    if (test == "round-trip")
+    {
+        ::round_trip(argv[2], argv[3]);
+    }
+    else if (test == "malformed")
+    {
+        ::malformed(argv[2]);
+    }
+    else
+    {
+        std::cerr << "Unknown test " << test << std::endl;
+        return 2;
+    }
+    return ::failures;
+}
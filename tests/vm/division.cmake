@@ -0,0 +1,34 @@
+#Compiles division.Negative at -O0, -O1 and -O2, checks that -O1 reduces division by -1 and -O2 every negative
+#divisor, and that all three builds divide alike, the most negative dividends included.
+#Expects COMPILER, VM, FIXTURES and SCRATCH
+foreach(level 0 1 2)
+    file(REMOVE_RECURSE ${SCRATCH}/division-O${level})
+    execute_process(COMMAND ${COMPILER} --file division.Negative --build-path ${SCRATCH}/division-O${level} -O${level} --log-level debug
+        WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result OUTPUT_VARIABLE log_O${level} ERROR_VARIABLE log_O${level})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Compiling division.Negative at -O${level} failed with ${result}")
+    endif()
+endforeach()
+if(NOT log_O1 MATCHES "Reducing DIVI by -1 at line 9" OR log_O1 MATCHES "Reducing DIVI by -2")
+    message(FATAL_ERROR "-O1 should reduce division by -1 and nothing else: ${log_O1}")
+endif()
+foreach(reduced "-1 at line 9" "-2 at line 10" "-8 at line 11" "-7 at line 12" "-1 at line 26" "-2 at line 27" "-16 at line 28")
+    if(NOT log_O2 MATCHES "Reducing DIVI by ${reduced}")
+        message(FATAL_ERROR "-O2 did not reduce DIVI by ${reduced}")
+    endif()
+endforeach()
+foreach(case "ints:0" "ints:7" "ints:-7" "ints:-15" "ints:2147483647" "ints:-2147483648" "longs:31" "longs:-31" "longs:9223372036854775807" "longs:-9223372036854775808")
+    string(REPLACE ":" ";" parts "${case}")
+    list(GET parts 0 method)
+    list(GET parts 1 argument)
+    foreach(level 0 1 2)
+        execute_process(COMMAND ${VM} --class-path ${SCRATCH}/division-O${level} --run division.Negative.${method} ${argument}
+            RESULT_VARIABLE result OUTPUT_VARIABLE output_O${level} ERROR_VARIABLE output_O${level})
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${method}(${argument}) at -O${level} failed with ${result}: ${output_O${level}}")
+        endif()
+    endforeach()
+    if(NOT output_O1 STREQUAL output_O0 OR NOT output_O2 STREQUAL output_O0)
+        message(FATAL_ERROR "${method}(${argument}) is ${output_O0} at -O0, ${output_O1} at -O1 and ${output_O2} at -O2")
+    endif()
+endforeach()
@@ -0,0 +1,33 @@
+#Benchmarks fused.Cell at -O0 and at -O1, where its loops fuse into superinstructions and its allocation into VNEWF.
+#Both builds must compute the same results, and the -O1 one must reuse its one non-escaping object on every iteration.
+#Expects COMPILER, VM, FIXTURES and SCRATCH
+foreach(level 0 1)
+    file(REMOVE_RECURSE ${SCRATCH}/fused-O${level})
+    execute_process(COMMAND ${COMPILER} --file fused.Cell --build-path ${SCRATCH}/fused-O${level} -O${level}
+        WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Compiling fused.Cell at -O${level} failed with ${result}")
+    endif()
+    file(WRITE ${SCRATCH}/fused-O${level}/corpus.txt "fused.Cell.cells 1000\nfused.Cell.sums 1000\n")
+    execute_process(COMMAND ${VM} --class-path ${SCRATCH}/fused-O${level} --bench ${SCRATCH}/fused-O${level}/corpus.txt
+        RESULT_VARIABLE result OUTPUT_VARIABLE log_O${level} ERROR_VARIABLE log_O${level})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Benchmarking the -O${level} build failed with ${result}: ${log_O${level}}")
+    endif()
+endforeach()
+foreach(expected "fused.Cell.cells = 499990" "fused.Cell.sums = 333333000")
+    foreach(level 0 1)
+        string(FIND "${log_O${level}}" "${expected}" found)
+        if(found EQUAL -1)
+            message(FATAL_ERROR "The -O${level} build did not give ${expected}: ${log_O${level}}")
+        endif()
+    endforeach()
+endforeach()
+if(NOT log_O1 MATCHES "fused.Cell.cells = [0-9]+: [0-9]+ instructions, 1 invocations, 1 allocations")
+    message(FATAL_ERROR "VNEWF did not reuse its object: ${log_O1}")
+endif()
+foreach(fused IADDI_IBLT VVLLD_VBNEQI IVLLD_IBNEQI IALD_IADD IALD_IMUL)
+    if(NOT log_O1 MATCHES "Opcode ${fused} ")
+        message(FATAL_ERROR "${fused} never ran: ${log_O1}")
+    endif()
+endforeach()
@@ -0,0 +1,28 @@
+#Compiles locals.Zero at -O0, -O1 and -O2. Its methods read DEF'd locals that some paths never write, which the VM
+#defines by zero-filling frames, so every build must verify and run each method as if the locals started at zero.
+#At -O1 and -O2 bump is inlined into the loop in total, where its local must still start at zero on every call.
+#Expects COMPILER, VM, FIXTURES and SCRATCH
+foreach(level 0 1 2)
+    file(REMOVE_RECURSE ${SCRATCH}/locals-O${level})
+    file(MAKE_DIRECTORY ${SCRATCH}/locals-O${level})
+    execute_process(COMMAND ${COMPILER} --file locals.Zero --build-path ${SCRATCH}/locals-O${level} -O${level}
+        WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result OUTPUT_VARIABLE log ERROR_VARIABLE log)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Compiling locals.Zero at -O${level} failed with ${result}")
+    endif()
+    if(log MATCHES "Verification failed")
+        message(FATAL_ERROR "locals.Zero does not verify at -O${level}: ${log}")
+    endif()
+    #Method, argument and expected result, separated by colons
+    foreach(case "reads:5:5" "some:0:0" "some:3:1" "half:0:0" "half:1:1.5" "total:10:45")
+        string(REPLACE ":" ";" parts "${case}")
+        list(GET parts 0 method)
+        list(GET parts 1 argument)
+        list(GET parts 2 expected)
+        execute_process(COMMAND ${VM} --class-path ${SCRATCH}/locals-O${level} --run locals.Zero.${method} ${argument}
+            RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output OUTPUT_STRIP_TRAILING_WHITESPACE)
+        if(NOT result EQUAL 0 OR NOT output STREQUAL expected)
+            message(FATAL_ERROR "${method}(${argument}) at -O${level} gave ${output} with status ${result} instead of ${expected}")
+        endif()
+    endforeach()
+endforeach()
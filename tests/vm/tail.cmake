@@ -0,0 +1,33 @@
+#Compiles tail.Calls at -O1, where its recursive calls become tail invokes, and runs each of them far deeper than the
+#VM's 4096 frames. Inlining is off so that even and odd stay separate methods calling each other.
+#Expects COMPILER, VM, FIXTURES and SCRATCH
+file(REMOVE_RECURSE ${SCRATCH}/tail)
+execute_process(COMMAND ${COMPILER} --file tail.Calls --build-path ${SCRATCH}/tail -O1 --inline-threshold 0
+    WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Compiling tail.Calls failed with ${result}")
+endif()
+#Method, arguments and expected result, separated by colons
+foreach(case "count:100000;0:200000" "even:100001:0" "odd:100001:1" "flip:1;5;100001:4" "start:100000:300000")
+    string(REPLACE ":" ";" parts "${case}")
+    list(GET parts 0 method)
+    list(GET parts -1 expected)
+    list(REMOVE_AT parts 0 -1)
+    execute_process(COMMAND ${VM} --class-path ${SCRATCH}/tail --run tail.Calls.${method} ${parts}
+        RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output OUTPUT_STRIP_TRAILING_WHITESPACE)
+    if(NOT result EQUAL 0 OR NOT output STREQUAL expected)
+        message(FATAL_ERROR "${method}(${parts}) gave ${output} with status ${result} instead of ${expected}")
+    endif()
+endforeach()
+#At -O0 the same calls stay plain invokes, which must end in a stack overflow error rather than a crash
+file(REMOVE_RECURSE ${SCRATCH}/plain)
+execute_process(COMMAND ${COMPILER} --file tail.Calls --build-path ${SCRATCH}/plain -O0
+    WORKING_DIRECTORY ${FIXTURES} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Compiling tail.Calls at -O0 failed with ${result}")
+endif()
+execute_process(COMMAND ${VM} --class-path ${SCRATCH}/plain --run tail.Calls.count 100000 0
+    RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output)
+if(NOT result EQUAL 1 OR NOT output MATCHES "Stack overflow")
+    message(FATAL_ERROR "count(100000, 0) at -O0 gave ${output} with status ${result} instead of a stack overflow")
+endif()
@@ -0,0 +1,640 @@
+#include "verifier.h"
+
+#include <algorithm>
+#include <climits>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../instructions/bytecode.h"
+
+using namespace oops_bcode_compiler::verifier;
+
+namespace
+{
+    typedef oops_bcode_compiler::bytecode::itype itype;
+
+    //What a stack slot holds; the header type codes plus states only the verifier needs
+    enum slot : std::uint8_t
+    {
+        UNSET = 0,
+        INT = 2,
+        LONG = 3,
+        FLOAT = 4,
+        DOUBLE = 5,
+        REF = 6,
+        //Constant or reinterpreted raw bits from LDI/LUI/LDC, RCVT and MOV, readable as either type of their width
+        BITS32 = 7,
+        BITS64 = 8,
+        //Second slot of a long, double or ref
+        HIGH = 9,
+        //Paths disagree on the slot, so it cannot be read
+        CONFLICT = 10
+    };
+
+    //Element kinds count char 0 and short 1, then follow the type codes
+    constexpr std::int8_t unknown_kind = -1;
+
+    //Raw bits on one path and a type of their width on the other can be read as that type; anything else disagrees
+    std::uint8_t join(std::uint8_t a, std::uint8_t b)
+    {
+        if (a == b)
+        {
+            return a;
+        }
+        if ((a == BITS32 and (b == INT or b == FLOAT)) or (a == BITS64 and (b == LONG or b == DOUBLE)))
+        {
+            return b;
+        }
+        if ((b == BITS32 and (a == INT or a == FLOAT)) or (b == BITS64 and (a == LONG or a == DOUBLE)))
+        {
+            return a;
+        }
+        return CONFLICT;
+    }
+
+    struct frame
+    {
+        std::vector<std::uint8_t> slots;
+        //Element kind of the array in a ref slot, known only for arrays allocated by this method
+        std::vector<std::int8_t> kinds;
+
+        bool merge(const frame &other)
+        {
+            bool changed = false;
+            for (std::size_t i = 0; i < this->slots.size(); i++)
+            {
+                if (auto joined = ::join(this->slots[i], other.slots[i]); joined != this->slots[i])
+                {
+                    this->slots[i] = joined;
+                    changed = true;
+                }
+                if (this->kinds[i] != other.kinds[i] and this->kinds[i] != unknown_kind)
+                {
+                    this->kinds[i] = unknown_kind;
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+    };
+
+    unsigned width(std::uint8_t type)
+    {
+        switch (type)
+        {
+        case LONG:
+        case DOUBLE:
+        case BITS64:
+            return sizeof(std::int64_t) / sizeof(std::int32_t);
+        case REF:
+            return sizeof(char *) / sizeof(std::int32_t);
+        default:
+            return 1;
+        }
+    }
+
+    std::uint8_t element_type(unsigned kind)
+    {
+        return static_cast<std::uint8_t>(std::max<unsigned>(kind, INT));
+    }
+
+    //Fused words execute their first instruction's semantics before running into the second word
+    itype unfused(itype type)
+    {
+        for (auto &pair : oops_bcode_compiler::bytecode::fusion_table)
+        {
+            if (pair.fused == type)
+            {
+                return pair.first;
+            }
+        }
+        return type;
+    }
+
+    unsigned offset_in(itype type, itype first)
+    {
+        return static_cast<unsigned>(type) - static_cast<unsigned>(first);
+    }
+
+    bool in_range(itype type, itype first, itype last)
+    {
+        return type >= first and type <= last;
+    }
+
+    class checker
+    {
+    public:
+        checker(const oops_bcode_compiler::compiler::method &mtd) : mtd(mtd)
+        {
+            for (auto &call : mtd.calls)
+            {
+                this->calls[call.instruction_idx] = &call;
+            }
+        }
+
+        std::vector<std::string> run()
+        {
+            std::vector<std::optional<::frame>> states(this->mtd.instructions.size());
+            if (this->mtd.instructions.empty())
+            {
+                return {"method has no instructions"};
+            }
+            ::frame entry{std::vector<std::uint8_t>(this->mtd.stack_size, UNSET), std::vector<std::int8_t>(this->mtd.stack_size, unknown_kind)};
+            this->current = entry;
+            std::uint16_t offset = 0;
+            for (auto type : this->mtd.arg_types)
+            {
+                if (this->mtd.aligned_frame and ::width(type) == 2 and offset % 2)
+                {
+                    offset++;
+                }
+                this->write(offset, type);
+                offset += ::width(type);
+            }
+            for (auto [local, type] : this->mtd.local_types)
+            {
+                this->write(local, type);
+            }
+            if (this->failed)
+            {
+                return {this->error};
+            }
+            states[0] = this->current;
+            std::vector<std::size_t> worklist = {0};
+            while (!worklist.empty())
+            {
+                this->at = worklist.back();
+                worklist.pop_back();
+                auto flow_to = [&](std::size_t succ) {
+                    if (succ >= this->mtd.instructions.size() or this->data_words.count(succ))
+                    {
+                        this->fail("control reaches word " + std::to_string(succ) + ", which does not start an instruction");
+                        return;
+                    }
+                    if (!states[succ])
+                    {
+                        states[succ] = this->current;
+                        worklist.push_back(succ);
+                    }
+                    else if (states[succ]->merge(this->current))
+                    {
+                        worklist.push_back(succ);
+                    }
+                };
+                //A protected instruction may throw before changing anything, reaching its handlers with only the caught slot written
+                for (auto &handler : this->mtd.handlers)
+                {
+                    if (this->at >= handler.begin and this->at < handler.end)
+                    {
+                        this->current = *states[this->at];
+                        this->write(handler.slot, REF);
+                        flow_to(handler.target);
+                    }
+                }
+                this->current = *states[this->at];
+                auto successors = this->failed ? std::vector<std::size_t>{} : this->step();
+                if (this->failed)
+                {
+                    return {this->error};
+                }
+                for (auto succ : successors)
+                {
+                    flow_to(succ);
+                    if (this->failed)
+                    {
+                        return {this->error};
+                    }
+                }
+            }
+            //A branch into data words is only caught above if the call or BADR owning them was reached first
+            for (std::size_t i = 0; i < states.size(); i++)
+            {
+                if (states[i] and this->data_words.count(i))
+                {
+                    this->at = i;
+                    this->fail("control reaches a call argument or jump table word");
+                    return {this->error};
+                }
+            }
+            return {};
+        }
+
+    private:
+        const oops_bcode_compiler::compiler::method &mtd;
+        std::unordered_map<std::uint32_t, const oops_bcode_compiler::compiler::call_descriptor *> calls;
+        //Call argument and jump table words, which follow their instruction but are never executed
+        std::unordered_set<std::size_t> data_words;
+        ::frame current;
+        std::size_t at = 0;
+        bool failed = false;
+        std::string error;
+
+        void fail(const std::string &message)
+        {
+            if (this->failed)
+            {
+                return;
+            }
+            auto type = oops_bcode_compiler::bytecode::opcode(this->mtd.instructions[this->at]);
+            auto name = static_cast<unsigned>(type) < oops_bcode_compiler::bytecode::itype_to_string.size() ? oops_bcode_compiler::bytecode::itype_to_string[static_cast<unsigned>(type)] : "UNKNOWN";
+            this->error = "Word " + std::to_string(this->at) + " (" + name + ") of method " + this->mtd.name + ": " + message;
+            this->failed = true;
+        }
+
+        bool fits(std::uint16_t offset, std::uint8_t type)
+        {
+            if (static_cast<std::size_t>(offset) + ::width(type) > this->current.slots.size())
+            {
+                this->fail("slot " + std::to_string(offset) + " is outside the frame of " + std::to_string(this->current.slots.size()) + " slots");
+                return false;
+            }
+            return true;
+        }
+
+        //Checks the slot holds type; returns the exact type, or the raw bits it held
+        std::uint8_t read(std::uint16_t offset, std::uint8_t type)
+        {
+            if (!this->fits(offset, type))
+            {
+                return type;
+            }
+            auto held = this->current.slots[offset];
+            bool matches = held == type or (held == BITS32 and (type == INT or type == FLOAT)) or (held == BITS64 and (type == LONG or type == DOUBLE));
+            for (unsigned i = 1; i < ::width(type); i++)
+            {
+                matches = matches and this->current.slots[offset + i] == HIGH;
+            }
+            if (!matches)
+            {
+                this->fail("slot " + std::to_string(offset) + (held == UNSET ? " is read before it is written" : held == CONFLICT ? " holds different types on different paths" : " does not hold type " + std::to_string(type)));
+            }
+            return held;
+        }
+
+        void write(std::uint16_t offset, std::uint8_t type, std::int8_t kind = unknown_kind)
+        {
+            if (!this->fits(offset, type))
+            {
+                return;
+            }
+            this->current.slots[offset] = type;
+            this->current.kinds[offset] = kind;
+            for (unsigned i = 1; i < ::width(type); i++)
+            {
+                this->current.slots[offset + i] = HIGH;
+                this->current.kinds[offset + i] = unknown_kind;
+            }
+        }
+
+        //Arithmetic on raw bits keeps them raw, so constants built by LUI then LADDI can still become doubles
+        std::uint8_t result(std::uint8_t type, std::initializer_list<std::uint8_t> held)
+        {
+            for (auto h : held)
+            {
+                if (h != type)
+                {
+                    return ::width(type) == 1 ? BITS32 : BITS64;
+                }
+            }
+            return type;
+        }
+
+        void check_kind(std::uint16_t array, unsigned kind)
+        {
+            auto known = this->current.kinds[array];
+            if (known != unknown_kind and static_cast<unsigned>(known) != kind)
+            {
+                this->fail("array in slot " + std::to_string(array) + " has element kind " + std::to_string(known) + ", not " + std::to_string(kind));
+            }
+        }
+
+        std::size_t target(std::uint64_t word)
+        {
+            auto distance = static_cast<std::size_t>(word & 0xffff);
+            bool backward = (word >> 48) & 0xff;
+            return backward ? this->at + 1 - distance : this->at + 1 + distance;
+        }
+
+        std::size_t call(std::uint64_t word, bool receiver)
+        {
+            auto descriptor = this->calls.find(this->at);
+            if (descriptor == this->calls.end())
+            {
+                this->fail("call has no descriptor");
+                return this->at + 1;
+            }
+            if (receiver)
+            {
+                this->read((word >> 16) & 0xffff, REF);
+            }
+            constexpr auto lanes = sizeof(std::uint64_t) / sizeof(std::uint16_t);
+            auto &types = descriptor->second->argument_types;
+            auto words = (types.size() + lanes - 1) / lanes;
+            if (this->at + words >= this->mtd.instructions.size())
+            {
+                this->fail("argument words run past the end of the method");
+                return this->at + 1;
+            }
+            for (std::size_t i = 0; i < words * lanes; i++)
+            {
+                auto lane = static_cast<std::uint16_t>(this->mtd.instructions[this->at + 1 + i / lanes] >> (i % lanes * CHAR_BIT * sizeof(std::uint16_t)));
+                if (i < types.size())
+                {
+                    this->read(lane, types[i]);
+                }
+                else if (lane)
+                {
+                    this->fail("padding lane " + std::to_string(i) + " of the argument words is not zero");
+                }
+            }
+            for (std::size_t i = 1; i <= words; i++)
+            {
+                this->data_words.insert(this->at + i);
+            }
+            this->write(word & 0xffff, descriptor->second->return_type);
+            return this->at + 1 + words;
+        }
+
+        //Reads the table after a BADR and returns every word it can branch to, its default included
+        std::vector<std::size_t> jump_table(std::uint64_t word)
+        {
+            this->read((word >> 16) & 0xffff, INT);
+            bool sparse = (word >> 48) & oops_bcode_compiler::bytecode::sparse_table;
+            std::size_t entries = word & 0xffff;
+            auto words = 1 + (sparse ? entries : (entries + 1) / 2);
+            if (this->at + words >= this->mtd.instructions.size())
+            {
+                this->fail("jump table runs past the end of the method");
+                return {};
+            }
+            for (std::size_t i = 1; i <= words; i++)
+            {
+                this->data_words.insert(this->at + i);
+            }
+            auto &table = this->mtd.instructions;
+            auto target = [this](std::uint64_t offset) { return this->at + static_cast<std::int32_t>(static_cast<std::uint32_t>(offset)); };
+            std::vector<std::size_t> targets = {target(table[this->at + 1])};
+            for (std::size_t i = 0; i < entries; i++)
+            {
+                if (sparse)
+                {
+                    auto key = static_cast<std::int32_t>(table[this->at + 2 + i] >> 32);
+                    if (i and key <= static_cast<std::int32_t>(table[this->at + 1 + i] >> 32))
+                    {
+                        this->fail("jump table keys are not in ascending order");
+                        return {};
+                    }
+                    targets.push_back(target(table[this->at + 2 + i]));
+                }
+                else
+                {
+                    targets.push_back(target(table[this->at + 2 + i / 2] >> (i % 2 * 32)));
+                }
+            }
+            if (!sparse and entries % 2 and table[this->at + words] >> 32)
+            {
+                this->fail("padding half of the last jump table word is not zero");
+                return {};
+            }
+            std::sort(targets.begin(), targets.end());
+            targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+            return targets;
+        }
+
+        //Applies the instruction at this->at to this->current and returns where control goes next
+        std::vector<std::size_t> step()
+        {
+            auto word = this->mtd.instructions[this->at];
+            auto type = ::unfused(oops_bcode_compiler::bytecode::opcode(word));
+            std::uint16_t dest = word & 0xffff, src1 = (word >> 16) & 0xffff, src2 = (word >> 32) & 0xffff;
+            auto imm24 = static_cast<std::int32_t>(static_cast<std::uint32_t>(word >> 32) << 8) >> 8;
+            std::size_t next = this->at + 1;
+            if (::in_range(type, itype::IADD, itype::DDIV))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IADD) % 4;
+                this->write(dest, this->result(t, {this->read(src1, t), this->read(src2, t)}));
+            }
+            else if (::in_range(type, itype::IMOD, itype::LDIVU))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IMOD) % 2;
+                this->write(dest, this->result(t, {this->read(src1, t), this->read(src2, t)}));
+            }
+            else if (::in_range(type, itype::IADDI, itype::DDIVI))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IADDI) % 4;
+                this->write(dest, this->result(t, {this->read(src1, t)}));
+            }
+            else if (::in_range(type, itype::IMODI, itype::LDIVUI))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IMODI) % 2;
+                this->write(dest, this->result(t, {this->read(src1, t)}));
+            }
+            else if (::in_range(type, itype::INEG, itype::DNEG))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::INEG);
+                this->write(dest, this->result(t, {this->read(src1, t)}));
+            }
+            else if (type == itype::LUI or type == itype::LDC)
+            {
+                this->write(dest, BITS64);
+            }
+            else if (type == itype::LDI)
+            {
+                this->write(dest, BITS32);
+            }
+            else if (type == itype::LNL)
+            {
+                this->write(dest, REF);
+            }
+            else if (::in_range(type, itype::ICSTL, itype::DCSTF))
+            {
+                //Each destination type has three casts, from the other numeric types in order
+                auto idx = ::offset_in(type, itype::ICSTL);
+                std::uint8_t to = INT + idx / 3, from = INT + idx % 3;
+                from += from >= to;
+                this->read(src1, from);
+                this->write(dest, to);
+            }
+            else if ((type == itype::IORI or type == itype::LORI) and imm24 == 0)
+            {
+                //MOV and RCVT: a 64-bit move carries refs along, anything else becomes raw bits
+                if (type == itype::LORI and this->fits(src1, REF) and this->current.slots[src1] == REF)
+                {
+                    auto kind = this->current.kinds[src1];
+                    this->read(src1, REF);
+                    this->write(dest, REF, kind);
+                }
+                else
+                {
+                    auto held = this->fits(src1, type == itype::IORI ? INT : LONG) ? this->current.slots[src1] : static_cast<std::uint8_t>(UNSET);
+                    this->read(src1, type == itype::IORI ? (held == FLOAT ? FLOAT : INT) : (held == DOUBLE ? DOUBLE : LONG));
+                    this->write(dest, type == itype::IORI ? BITS32 : BITS64);
+                }
+            }
+            else if (::in_range(type, itype::IAND, itype::LSRA))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IAND) % 2;
+                this->write(dest, this->result(t, {this->read(src1, t), this->read(src2, t)}));
+            }
+            else if (::in_range(type, itype::IANDI, itype::LSRAI))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IANDI) % 2;
+                this->write(dest, this->result(t, {this->read(src1, t)}));
+            }
+            else if (::in_range(type, itype::IBGE, itype::DBGT))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IBGE) % 4;
+                this->read(src1, t);
+                this->read(src2, t);
+                return {this->target(word), next};
+            }
+            else if (::in_range(type, itype::IBEQ, itype::VBNEQ))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IBEQ) % 5;
+                this->read(src1, t);
+                this->read(src2, t);
+                return {this->target(word), next};
+            }
+            else if (::in_range(type, itype::IBGEI, itype::DBGTI))
+            {
+                this->read(src1, INT + ::offset_in(type, itype::IBGEI) % 4);
+                return {this->target(word), next};
+            }
+            else if (::in_range(type, itype::IBEQI, itype::VBNEQI))
+            {
+                this->read(src1, INT + ::offset_in(type, itype::IBEQI) % 5);
+                return {this->target(word), next};
+            }
+            else if (type == itype::BU)
+            {
+                return {this->target(word)};
+            }
+            else if (type == itype::BADR)
+            {
+                return this->jump_table(word);
+            }
+            else if (::in_range(type, itype::CVLLD, itype::VVLLD))
+            {
+                this->read(src1, REF);
+                this->write(dest, ::element_type(::offset_in(type, itype::CVLLD)));
+            }
+            else if (::in_range(type, itype::CVLSR, itype::VVLSR))
+            {
+                this->read(dest, REF);
+                this->read(src1, ::element_type(::offset_in(type, itype::CVLSR)));
+            }
+            else if (::in_range(type, itype::CALD, itype::VALD))
+            {
+                auto kind = ::offset_in(type, itype::CALD);
+                this->read(src1, REF);
+                this->read(src2, INT);
+                this->check_kind(src1, kind);
+                this->write(dest, ::element_type(kind));
+            }
+            else if (::in_range(type, itype::CASR, itype::VASR))
+            {
+                auto kind = ::offset_in(type, itype::CASR);
+                this->read(dest, REF);
+                this->read(src1, ::element_type(kind));
+                this->read(src2, INT);
+                this->check_kind(dest, kind);
+            }
+            else if (::in_range(type, itype::CSTLD, itype::VSTLD))
+            {
+                this->write(dest, ::element_type(::offset_in(type, itype::CSTLD)));
+            }
+            else if (::in_range(type, itype::CSTSR, itype::VSTSR))
+            {
+                this->read(dest, ::element_type(::offset_in(type, itype::CSTSR)));
+            }
+            else if (type == itype::VNEW or type == itype::VNEWF)
+            {
+                this->write(dest, REF);
+            }
+            else if (::in_range(type, itype::CANEW, itype::VANEW))
+            {
+                this->read(src1, INT);
+                this->write(dest, REF, static_cast<std::int8_t>(::offset_in(type, itype::CANEW)));
+            }
+            else if (type == itype::IOF)
+            {
+                this->read(src1, REF);
+                this->write(dest, INT);
+            }
+            else if (type == itype::SINV or type == itype::TSINV)
+            {
+                next = this->call(word, false);
+            }
+            else if (type == itype::VINV or type == itype::IINV or type == itype::DINV or type == itype::TVINV or type == itype::TIINV or type == itype::TDINV)
+            {
+                next = this->call(word, true);
+            }
+            else if (::in_range(type, itype::IRET, itype::VRET))
+            {
+                std::uint8_t t = INT + ::offset_in(type, itype::IRET);
+                if (t != this->mtd.return_type)
+                {
+                    this->fail("returns type " + std::to_string(t) + " from a method returning " + std::to_string(this->mtd.return_type));
+                }
+                this->read(src1, t);
+                return {};
+            }
+            else if (type == itype::EXC)
+            {
+                this->read(src1, REF);
+                return {};
+            }
+            else if (type != itype::NOP and type != itype::CNT)
+            {
+                this->fail("instruction cannot be verified");
+            }
+            return {next};
+        }
+    };
+} // namespace
+
+std::vector<std::string> oops_bcode_compiler::verifier::verify(const compiler::method &mtd)
+{
+    return ::checker(mtd).run();
+}
+
+std::uint64_t oops_bcode_compiler::verifier::verification_hash(const compiler::method &mtd)
+{
+    std::uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&hash](std::uint64_t value, unsigned bytes) {
+        for (unsigned i = 0; i < bytes; i++)
+        {
+            hash ^= (value >> (i * CHAR_BIT)) & 0xff;
+            hash *= 0x100000001b3;
+        }
+    };
+    mix(mtd.stack_size, sizeof(mtd.stack_size));
+    mix(mtd.return_type, sizeof(mtd.return_type));
+    mix(mtd.aligned_frame, sizeof(mtd.aligned_frame));
+    for (auto type : mtd.arg_types)
+    {
+        mix(type, sizeof(type));
+    }
+    for (auto word : mtd.instructions)
+    {
+        mix(word, sizeof(word));
+    }
+    for (auto &handler : mtd.handlers)
+    {
+        mix(handler.begin, sizeof(handler.begin));
+        mix(handler.end, sizeof(handler.end));
+        mix(handler.target, sizeof(handler.target));
+        mix(handler.slot, sizeof(handler.slot));
+    }
+    for (auto &call : mtd.calls)
+    {
+        mix(call.instruction_idx, sizeof(call.instruction_idx));
+        mix(call.return_type, sizeof(call.return_type));
+        for (auto type : call.argument_types)
+        {
+            mix(type, sizeof(type));
+        }
+    }
+    return hash;
+}
@@ -0,0 +1,27 @@
+#ifndef VERIFIER_VERIFIER
+#define VERIFIER_VERIFIER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../compiler/compiler.h"
+
+namespace oops_bcode_compiler
+{
+    namespace verifier
+    {
+        //Abstractly interprets every path through the encoded words of mtd, tracking the type held by each stack slot
+        //and the element kind of the arrays the method allocates itself. DEF'd locals start out holding their type, as the
+        //VM zero-fills frames. Checks operand types and slot bounds, that other slots are written before they are read,
+        //branch targets, array element kinds, and the argument words of every call against its descriptor in mtd.calls.
+        //Every word in a handler's range also flows to the handler.
+        //Returns the first problem found, so an empty result certifies mtd.
+        std::vector<std::string> verify(const compiler::method &mtd);
+
+        //FNV-1a over the frame layout, the final instruction words, the handler ranges and the call descriptors, stamped next to the verified bit
+        std::uint64_t verification_hash(const compiler::method &mtd);
+    } // namespace verifier
+} // namespace oops_bcode_compiler
+
+#endif /* VERIFIER_VERIFIER */
@@ -0,0 +1,1419 @@
+#include "interpreter.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <type_traits>
+
+#include "../instructions/bytecode.h"
+#include "../utils/puns.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::bytecode;
+using namespace oops_bcode_compiler::vm;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    constexpr std::size_t lanes = sizeof(std::uint64_t) / sizeof(std::uint16_t);
+    //Every frame keeps this many slots free after it, so no 16-bit slot index of a malformed method can leave the stack
+    constexpr std::size_t frame_headroom = std::numeric_limits<std::uint16_t>::max() + 2;
+    constexpr std::size_t max_depth = 4096;
+    //Unoptimized builds give each interpreter frame several kilobytes of native stack, which can run out before max_depth
+    constexpr std::size_t native_stack_budget = std::size_t{6} << 20;
+    constexpr std::size_t max_array_length = std::size_t{1} << 28;
+    constexpr std::size_t unresolved = std::numeric_limits<std::size_t>::max();
+
+    template <typename primitive>
+    primitive get(const std::int32_t *frame, std::uint16_t slot)
+    {
+        return oops_bcode_compiler::utils::pun_read<primitive>(frame + slot);
+    }
+
+    template <typename primitive>
+    void set(std::int32_t *frame, std::uint16_t slot, primitive value)
+    {
+        oops_bcode_compiler::utils::pun_write(frame + slot, value);
+    }
+
+    bool is_wide(std::uint8_t type)
+    {
+        return type == 3 or type == 5 or type == 6;
+    }
+
+    std::int64_t sign_extend(std::uint64_t value, unsigned bits)
+    {
+        auto sign = static_cast<std::uint64_t>(1) << (bits - 1);
+        return static_cast<std::int64_t>((value ^ sign) - sign);
+    }
+
+    //A unit without WIDE stands for the word with its opcode, src2, src1 and dest bytes and everything else zero
+    std::uint64_t expand(std::uint32_t unit)
+    {
+        return static_cast<std::uint64_t>(unit >> 24) << 56 | static_cast<std::uint64_t>(unit >> 16 & 0xff) << 32 | static_cast<std::uint64_t>(unit >> 8 & 0xff) << 16 | (unit & 0xff);
+    }
+
+    //Reads the instruction at pc and moves pc past it; a WIDE unit cut off by the end of the body reads as a lone WIDE
+    template <bool compact>
+    std::uint64_t fetch(const oops_bcode_compiler::vm::method &mtd, std::size_t &pc)
+    {
+        if constexpr (compact)
+        {
+            auto unit = mtd.units[pc++];
+            if (unit >> 24 != static_cast<unsigned>(itype::WIDE))
+            {
+                return ::expand(unit);
+            }
+            if (pc + 2 > mtd.length)
+            {
+                return static_cast<std::uint64_t>(itype::WIDE) << 56;
+            }
+            auto word = mtd.units[pc] | static_cast<std::uint64_t>(mtd.units[pc + 1]) << 32;
+            pc += 2;
+            return word;
+        }
+        else
+        {
+            return mtd.words[pc++];
+        }
+    }
+
+    //Word k of the call arguments or jump table starting at pc, which takes two units in a compact body
+    template <bool compact>
+    std::uint64_t data(const oops_bcode_compiler::vm::method &mtd, std::size_t pc, std::size_t k)
+    {
+        if constexpr (compact)
+        {
+            return mtd.units[pc + k * 2] | static_cast<std::uint64_t>(mtd.units[pc + k * 2 + 1]) << 32;
+        }
+        else
+        {
+            return mtd.words[pc + k];
+        }
+    }
+
+    //pc is already past the branch, as its distance counts from the next instruction
+    std::size_t jump(std::uint64_t word, std::size_t pc)
+    {
+        auto distance = static_cast<std::size_t>(word & 0xffff);
+        return (word >> 48) & 0xff ? pc - distance : pc + distance;
+    }
+
+    //Division and remainder wrap on the one overflowing quotient instead of trapping
+    template <typename integer>
+    integer divide(integer dividend, integer divisor)
+    {
+        return divisor == -1 ? static_cast<integer>(0 - static_cast<std::make_unsigned_t<integer>>(dividend)) : dividend / divisor;
+    }
+
+    template <typename integer>
+    integer remainder(integer dividend, integer divisor)
+    {
+        return divisor == -1 ? 0 : dividend % divisor;
+    }
+
+    //Floating point to integer casts saturate and take NaN to 0
+    template <typename integer, typename floating>
+    integer saturate(floating value)
+    {
+        if (value != value)
+        {
+            return 0;
+        }
+        if (value <= static_cast<floating>(std::numeric_limits<integer>::min()))
+        {
+            return std::numeric_limits<integer>::min();
+        }
+        if (value >= static_cast<floating>(std::numeric_limits<integer>::max()))
+        {
+            return std::numeric_limits<integer>::max();
+        }
+        return static_cast<integer>(value);
+    }
+
+    //Native stack taken since base, assuming it grows down as on every platform the VM targets
+    std::size_t native_stack_used(std::uintptr_t base)
+    {
+        char marker;
+        return base - reinterpret_cast<std::uintptr_t>(&marker);
+    }
+
+    bool inherits(const oops_bcode_compiler::vm::runtime_class *cls, const std::string &class_name)
+    {
+        if (cls->image.name == class_name)
+        {
+            return true;
+        }
+        return std::any_of(cls->supertypes.begin(), cls->supertypes.end(), [&class_name](auto super) { return ::inherits(super, class_name); });
+    }
+} // namespace
+
+std::uint64_t oops_bcode_compiler::vm::statistics::instructions() const
+{
+    return std::accumulate(this->opcodes.begin(), this->opcodes.end(), std::uint64_t{0});
+}
+
+oops_bcode_compiler::vm::machine::machine(std::string class_path, std::size_t stack_slots) : class_path(class_path), stack(stack_slots + ::frame_headroom), stack_top(0), depth(0), native_base(0), tail_target(nullptr, nullptr), pending(nullptr), stats{}
+{
+}
+
+oops_bcode_compiler::vm::machine::~machine()
+{
+    for (auto &cls : this->classes)
+    {
+        platform::close_file_mapping(cls.second->image.mapping);
+    }
+}
+
+runtime_class *oops_bcode_compiler::vm::machine::find_class(const std::string &name)
+{
+    if (auto found = this->classes.find(name); found != this->classes.end())
+    {
+        return found->second.get();
+    }
+    auto loaded = vm::load(name, this->class_path);
+    if (std::holds_alternative<std::vector<std::string>>(loaded))
+    {
+        auto &errors = std::get<std::vector<std::string>>(loaded);
+        this->errors.insert(this->errors.end(), errors.begin(), errors.end());
+        return nullptr;
+    }
+    auto cls = std::make_unique<runtime_class>();
+    cls->image = std::move(std::get<loaded_class>(loaded));
+    auto raw = cls.get();
+    //Registered before its supertypes load, so a cycle through them ends here instead of recursing forever
+    this->classes[name] = std::move(cls);
+    for (std::uint32_t i = 0; i < raw->image.supertype_count; i++)
+    {
+        auto super_index = self_class + 1 + i;
+        auto super = super_index < raw->image.classes.size() ? this->find_class(raw->image.classes[super_index]) : nullptr;
+        if (!super)
+        {
+            this->errors.push_back("Supertype " + std::to_string(i) + " of " + name + " could not be loaded");
+            platform::close_file_mapping(raw->image.mapping);
+            this->classes.erase(name);
+            return nullptr;
+        }
+        raw->supertypes.push_back(super);
+    }
+    if (!raw->supertypes.empty())
+    {
+        raw->fields = raw->supertypes.front()->fields;
+    }
+    for (auto &row : raw->image.instances)
+    {
+        if (row.class_index == self_class and raw->fields.find(row.name) == raw->fields.end())
+        {
+            auto slot = raw->fields.size();
+            raw->fields[row.name] = slot;
+        }
+    }
+    for (auto &row : raw->image.statics)
+    {
+        if (row.class_index == self_class)
+        {
+            raw->statics[row.name] = 0;
+        }
+    }
+    raw->class_targets.resize(raw->image.classes.size());
+    raw->method_targets.resize(raw->image.methods.size());
+    raw->static_targets.resize(raw->image.methods.size());
+    raw->field_targets.resize(raw->image.instances.size(), ::unresolved);
+    logger.builder(logging::level::debug) << "Linked " << name << " with " << raw->fields.size() << " fields" << logging::logbuilder::end;
+    return raw;
+}
+
+runtime_class *oops_bcode_compiler::vm::machine::class_at(runtime_class &from, std::uint32_t class_index)
+{
+    if (class_index >= from.class_targets.size() or class_index < self_class)
+    {
+        this->errors.push_back("Class index " + std::to_string(class_index) + " is out of range in " + from.image.name);
+        return nullptr;
+    }
+    if (!from.class_targets[class_index])
+    {
+        from.class_targets[class_index] = class_index == self_class ? &from : this->find_class(from.image.classes[class_index]);
+    }
+    return from.class_targets[class_index];
+}
+
+std::pair<runtime_class *, oops_bcode_compiler::vm::method *> oops_bcode_compiler::vm::machine::method_at(runtime_class &from, std::uint32_t row)
+{
+    if (row >= from.method_targets.size())
+    {
+        this->errors.push_back("Method row " + std::to_string(row) + " is out of range in " + from.image.name);
+        return {};
+    }
+    if (!from.method_targets[row].second)
+    {
+        auto host = this->class_at(from, from.image.methods[row].class_index);
+        if (!host)
+        {
+            return {};
+        }
+        //Static and direct invokes alike run whatever the host class dispatches the name to
+        from.method_targets[row] = this->dispatch(*host, from.image.methods[row].name);
+    }
+    return from.method_targets[row];
+}
+
+std::pair<runtime_class *, oops_bcode_compiler::vm::method *> oops_bcode_compiler::vm::machine::dispatch(runtime_class &receiver, const std::string &name)
+{
+    if (auto cached = receiver.vtable.find(name); cached != receiver.vtable.end())
+    {
+        return cached->second;
+    }
+    std::pair<runtime_class *, method *> target{};
+    if (auto body = receiver.image.body_indexes.find(name); body != receiver.image.body_indexes.end())
+    {
+        target = {&receiver, &receiver.image.bodies[body->second]};
+    }
+    else
+    {
+        //Only the class the lookup started from reports a missing method
+        auto errors = this->errors.size();
+        for (auto super : receiver.supertypes)
+        {
+            if (target = this->dispatch(*super, name); target.second)
+            {
+                break;
+            }
+        }
+        this->errors.resize(errors);
+    }
+    if (!target.second)
+    {
+        this->errors.push_back("Class " + receiver.image.name + " has no method " + name);
+        return {};
+    }
+    return receiver.vtable[name] = target;
+}
+
+std::uint64_t *oops_bcode_compiler::vm::machine::static_at(runtime_class &from, std::uint32_t row)
+{
+    //IMP SVAR lines are filed with the method imports by the parser
+    if (row >= from.static_targets.size())
+    {
+        this->errors.push_back("Static row " + std::to_string(row) + " is out of range in " + from.image.name);
+        return nullptr;
+    }
+    if (!from.static_targets[row])
+    {
+        auto host = this->class_at(from, from.image.methods[row].class_index);
+        if (!host)
+        {
+            return nullptr;
+        }
+        auto found = host->statics.find(from.image.methods[row].name);
+        if (found == host->statics.end())
+        {
+            this->errors.push_back("Class " + host->image.name + " has no static variable " + from.image.methods[row].name);
+            return nullptr;
+        }
+        from.static_targets[row] = &found->second;
+    }
+    return from.static_targets[row];
+}
+
+std::size_t oops_bcode_compiler::vm::machine::field_at(runtime_class &from, std::uint32_t row)
+{
+    if (row >= from.field_targets.size())
+    {
+        this->errors.push_back("Instance row " + std::to_string(row) + " is out of range in " + from.image.name);
+        return ::unresolved;
+    }
+    if (from.field_targets[row] == ::unresolved)
+    {
+        auto host = this->class_at(from, from.image.instances[row].class_index);
+        if (!host)
+        {
+            return ::unresolved;
+        }
+        auto found = host->fields.find(from.image.instances[row].name);
+        if (found == host->fields.end())
+        {
+            this->errors.push_back("Class " + host->image.name + " has no instance variable " + from.image.instances[row].name);
+            return ::unresolved;
+        }
+        from.field_targets[row] = found->second;
+    }
+    return from.field_targets[row];
+}
+
+bool oops_bcode_compiler::vm::machine::is_instance(const object *obj, const std::string &class_name)
+{
+    return obj and obj->cls and ::inherits(obj->cls, class_name);
+}
+
+oops_bcode_compiler::vm::object *oops_bcode_compiler::vm::machine::allocate(runtime_class *cls, std::size_t slots)
+{
+    this->stats.allocations++;
+    this->heap.push_back(std::make_unique<object>(object{cls, std::vector<std::uint64_t>(slots)}));
+    return this->heap.back().get();
+}
+
+std::uint64_t oops_bcode_compiler::vm::machine::call(runtime_class &cls, method &mtd, std::int32_t *frame)
+{
+    this->depth++;
+    std::pair<runtime_class *, method *> target(&cls, &mtd);
+    std::uint64_t result;
+    //A tail invoke returns once it has set its callee's frame up over this one, and the callee then runs here at the same depth
+    do
+    {
+        this->stats.invocations++;
+        this->tail_target = {nullptr, nullptr};
+        result = target.second->compact ? this->execute<true>(*target.first, *target.second, frame) : this->execute<false>(*target.first, *target.second, frame);
+        target = this->tail_target;
+    } while (target.second);
+    this->depth--;
+    return result;
+}
+
+template <bool compact>
+std::uint64_t oops_bcode_compiler::vm::machine::execute(runtime_class &cls, method &mtd, std::int32_t *frame)
+{
+    //Indexed by opcode
+    static void *handlers[256];
+    static bool filled = false;
+    if (!filled)
+    {
+        std::fill(std::begin(handlers), std::end(handlers), &&malformed);
+#define handle(name) handlers[static_cast<unsigned>(itype::name)] = &&op_##name
+        handle(NOP);
+        handle(IADD);
+        handle(LADD);
+        handle(FADD);
+        handle(DADD);
+        handle(ISUB);
+        handle(LSUB);
+        handle(FSUB);
+        handle(DSUB);
+        handle(IMUL);
+        handle(LMUL);
+        handle(FMUL);
+        handle(DMUL);
+        handle(IDIV);
+        handle(LDIV);
+        handle(FDIV);
+        handle(DDIV);
+        handle(IMOD);
+        handle(LMOD);
+        handle(IDIVU);
+        handle(LDIVU);
+        handle(IADDI);
+        handle(LADDI);
+        handle(FADDI);
+        handle(DADDI);
+        handle(ISUBI);
+        handle(LSUBI);
+        handle(FSUBI);
+        handle(DSUBI);
+        handle(IMULI);
+        handle(LMULI);
+        handle(FMULI);
+        handle(DMULI);
+        handle(IDIVI);
+        handle(LDIVI);
+        handle(FDIVI);
+        handle(DDIVI);
+        handle(IMODI);
+        handle(LMODI);
+        handle(IDIVUI);
+        handle(LDIVUI);
+        handle(INEG);
+        handle(LNEG);
+        handle(FNEG);
+        handle(DNEG);
+        handle(LUI);
+        handle(LDI);
+        handle(LNL);
+        handle(ICSTL);
+        handle(ICSTF);
+        handle(ICSTD);
+        handle(LCSTI);
+        handle(LCSTF);
+        handle(LCSTD);
+        handle(FCSTI);
+        handle(FCSTL);
+        handle(FCSTD);
+        handle(DCSTI);
+        handle(DCSTL);
+        handle(DCSTF);
+        handle(IAND);
+        handle(LAND);
+        handle(IOR);
+        handle(LOR);
+        handle(IXOR);
+        handle(LXOR);
+        handle(ISLL);
+        handle(LSLL);
+        handle(ISRL);
+        handle(LSRL);
+        handle(ISRA);
+        handle(LSRA);
+        handle(IANDI);
+        handle(LANDI);
+        handle(IORI);
+        handle(LORI);
+        handle(IXORI);
+        handle(LXORI);
+        handle(ISLLI);
+        handle(LSLLI);
+        handle(ISRLI);
+        handle(LSRLI);
+        handle(ISRAI);
+        handle(LSRAI);
+        handle(IBGE);
+        handle(LBGE);
+        handle(FBGE);
+        handle(DBGE);
+        handle(IBLT);
+        handle(LBLT);
+        handle(FBLT);
+        handle(DBLT);
+        handle(IBLE);
+        handle(LBLE);
+        handle(FBLE);
+        handle(DBLE);
+        handle(IBGT);
+        handle(LBGT);
+        handle(FBGT);
+        handle(DBGT);
+        handle(IBEQ);
+        handle(LBEQ);
+        handle(FBEQ);
+        handle(DBEQ);
+        handle(VBEQ);
+        handle(IBNEQ);
+        handle(LBNEQ);
+        handle(FBNEQ);
+        handle(DBNEQ);
+        handle(VBNEQ);
+        handle(IBGEI);
+        handle(LBGEI);
+        handle(FBGEI);
+        handle(DBGEI);
+        handle(IBLTI);
+        handle(LBLTI);
+        handle(FBLTI);
+        handle(DBLTI);
+        handle(IBLEI);
+        handle(LBLEI);
+        handle(FBLEI);
+        handle(DBLEI);
+        handle(IBGTI);
+        handle(LBGTI);
+        handle(FBGTI);
+        handle(DBGTI);
+        handle(IBEQI);
+        handle(LBEQI);
+        handle(FBEQI);
+        handle(DBEQI);
+        handle(VBEQI);
+        handle(IBNEQI);
+        handle(LBNEQI);
+        handle(FBNEQI);
+        handle(DBNEQI);
+        handle(VBNEQI);
+        handle(BADR);
+        handle(BU);
+        handle(CVLLD);
+        handle(SVLLD);
+        handle(IVLLD);
+        handle(LVLLD);
+        handle(FVLLD);
+        handle(DVLLD);
+        handle(VVLLD);
+        handle(CVLSR);
+        handle(SVLSR);
+        handle(IVLSR);
+        handle(LVLSR);
+        handle(FVLSR);
+        handle(DVLSR);
+        handle(VVLSR);
+        handle(CALD);
+        handle(SALD);
+        handle(IALD);
+        handle(LALD);
+        handle(FALD);
+        handle(DALD);
+        handle(VALD);
+        handle(CASR);
+        handle(SASR);
+        handle(IASR);
+        handle(LASR);
+        handle(FASR);
+        handle(DASR);
+        handle(VASR);
+        handle(CSTLD);
+        handle(SSTLD);
+        handle(ISTLD);
+        handle(LSTLD);
+        handle(FSTLD);
+        handle(DSTLD);
+        handle(VSTLD);
+        handle(CSTSR);
+        handle(SSTSR);
+        handle(ISTSR);
+        handle(LSTSR);
+        handle(FSTSR);
+        handle(DSTSR);
+        handle(VSTSR);
+        handle(VNEW);
+        handle(CANEW);
+        handle(SANEW);
+        handle(IANEW);
+        handle(LANEW);
+        handle(FANEW);
+        handle(DANEW);
+        handle(VANEW);
+        handle(IOF);
+        handle(VINV);
+        handle(SINV);
+        handle(IINV);
+        handle(IRET);
+        handle(LRET);
+        handle(FRET);
+        handle(DRET);
+        handle(VRET);
+        handle(EXC);
+        handle(IADDI_IBLT);
+        handle(IADDI_IBLE);
+        handle(IADDI_IBNEQ);
+        handle(LADDI_LBLT);
+        handle(IALD_IADD);
+        handle(IALD_ISUB);
+        handle(IALD_IMUL);
+        handle(DALD_DADD);
+        handle(DALD_DMUL);
+        handle(IVLLD_IBEQI);
+        handle(IVLLD_IBNEQI);
+        handle(IVLLD_IBLT);
+        handle(IVLLD_IBGE);
+        handle(VVLLD_VBEQI);
+        handle(VVLLD_VBNEQI);
+        handle(CNT);
+        handle(TVINV);
+        handle(TSINV);
+        handle(TIINV);
+        handle(DINV);
+        handle(TDINV);
+        handle(VNEWF);
+        handle(LDC);
+#undef handle
+        filled = true;
+    }
+    constexpr std::size_t stride = compact ? 2 : 1;
+    auto &opcodes = this->stats.opcodes;
+    std::size_t pc = 0, at = 0;
+    std::uint64_t word = 0;
+
+#define dest static_cast<std::uint16_t>(word)
+#define src1 static_cast<std::uint16_t>(word >> 16)
+#define src2 static_cast<std::uint16_t>(word >> 32)
+#define flags static_cast<std::uint8_t>(word >> 48)
+#define imm24 ::sign_extend(word >> 32 & 0xffffff, 24)
+#define index24 static_cast<std::uint32_t>(word >> 32 & 0xffffff)
+#define index32 static_cast<std::uint32_t>(word >> 16)
+#define imm16 static_cast<std::int16_t>(word >> 32)
+#define next                                \
+    at = pc;                                \
+    if (pc >= mtd.length)                   \
+    {                                       \
+        goto overrun;                       \
+    }                                       \
+    word = ::fetch<compact>(mtd, pc);       \
+    opcodes[word >> 56]++;                  \
+    goto *handlers[word >> 56]
+#define fail(error)                                                                                               \
+    {                                                                                                             \
+        std::stringstream error_builder;                                                                          \
+        error_builder << error << " at instruction " << at << " of " << cls.image.name << "." << mtd.name;        \
+        this->errors.push_back(error_builder.str());                                                              \
+        return 0;                                                                                                 \
+    }
+#define binary(name, type, op)                                                   \
+    op_##name : ::set<type>(frame, dest, ::get<type>(frame, src1) op ::get<type>(frame, src2)); \
+    next;
+//Continues a fused word with its second word, which runs straight from the first one's handler instead of through handlers
+#define chain(second)                                               \
+    at = pc;                                                        \
+    if (pc >= mtd.length)                                           \
+    {                                                               \
+        goto overrun;                                               \
+    }                                                               \
+    word = ::fetch<compact>(mtd, pc);                               \
+    opcodes[word >> 56]++;                                          \
+    if (word >> 56 != static_cast<unsigned>(itype::second))         \
+    {                                                               \
+        goto malformed;                                             \
+    }                                                               \
+    goto op_##second
+#define binary_immediate_then(name, type, op, then)                                                 \
+    op_##name : ::set<type>(frame, dest, ::get<type>(frame, src1) op static_cast<type>(imm24));    \
+    then;
+#define binary_immediate(name, type, op) binary_immediate_then(name, type, op, next)
+#define division(name, type, operation)                                                          \
+    op_##name : if (::get<type>(frame, src2) == 0) fail("Division by zero");                   \
+    ::set<type>(frame, dest, operation(::get<type>(frame, src1), ::get<type>(frame, src2)));   \
+    next;
+#define division_immediate(name, type, operation)                                               \
+    op_##name : if (imm24 == 0) fail("Division by zero");                                     \
+    ::set<type>(frame, dest, operation(::get<type>(frame, src1), static_cast<type>(imm24)));  \
+    next;
+#define cast(name, to, from, conversion)                                              \
+    op_##name : ::set<to>(frame, dest, conversion(::get<from>(frame, src1)));         \
+    next;
+#define shift(name, type, op, mask)                                                                              \
+    op_##name : ::set<type>(frame, dest, ::get<type>(frame, src1) op(::get<std::uint32_t>(frame, src2) & mask)); \
+    next;
+#define shift_immediate(name, type, op, mask)                                                           \
+    op_##name : ::set<type>(frame, dest, ::get<type>(frame, src1) op(static_cast<unsigned>(imm24) & mask)); \
+    next;
+#define branch(name, type, op)                                      \
+    op_##name : if (::get<type>(frame, src1) op ::get<type>(frame, src2)) \
+    {                                                               \
+        pc = ::jump(word, pc);                                      \
+    }                                                               \
+    next;
+#define branch_immediate(name, type, op)                                      \
+    op_##name : if (::get<type>(frame, src1) op static_cast<type>(imm16)) \
+    {                                                                         \
+        pc = ::jump(word, pc);                                                \
+    }                                                                         \
+    next;
+#define load_object(name, from)                                  \
+    auto name = ::get<object *>(frame, from);                    \
+    if (!name)                                                   \
+    {                                                            \
+        fail("Null dereference");                                \
+    }
+#define field_then(name, object_slot, body, then)                               \
+    op_##name:                                                                  \
+    {                                                                           \
+        load_object(obj, object_slot);                                          \
+        auto field = this->field_at(cls, index24);                              \
+        if (field == ::unresolved)                                              \
+        {                                                                       \
+            return 0;                                                           \
+        }                                                                       \
+        if (!obj->cls or field >= obj->slots.size())                            \
+        {                                                                       \
+            fail("Object has no instance variable " << index24);               \
+        }                                                                       \
+        auto &value = obj->slots[field];                                        \
+        body;                                                                   \
+    }                                                                           \
+    then;
+#define field(name, object_slot, body) field_then(name, object_slot, body, next)
+#define element_then(name, array_slot, body, then)                                           \
+    op_##name:                                                                               \
+    {                                                                                        \
+        load_object(array, array_slot);                                                      \
+        auto index = ::get<std::int32_t>(frame, src2);                                       \
+        if (array->cls)                                                                      \
+        {                                                                                    \
+            fail("Object is not an array");                                                  \
+        }                                                                                    \
+        if (index < 0 or static_cast<std::size_t>(index) >= array->slots.size())             \
+        {                                                                                    \
+            fail("Index " << index << " is out of bounds for length " << array->slots.size()); \
+        }                                                                                    \
+        auto &value = array->slots[index];                                                   \
+        body;                                                                                \
+    }                                                                                        \
+    then;
+#define element(name, array_slot, body) element_then(name, array_slot, body, next)
+//IVLLD also reads the length of an array, which has no instance variables
+#define int_field(name, then)                                                                  \
+    op_##name:                                                                                 \
+    {                                                                                          \
+        load_object(obj, src1);                                                                \
+        if (!obj->cls)                                                                         \
+        {                                                                                      \
+            ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(obj->slots.size()));  \
+            then;                                                                              \
+        }                                                                                      \
+    }                                                                                          \
+    goto op_##name##_field;                                                                    \
+    field_then(name##_field, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)), then);
+#define static_variable(name, body)                     \
+    op_##name:                                          \
+    {                                                   \
+        auto variable = this->static_at(cls, index32);  \
+        if (!variable)                                  \
+        {                                               \
+            return 0;                                   \
+        }                                               \
+        auto &value = *variable;                        \
+        body;                                           \
+    }                                                   \
+    next;
+#define new_array(name)                                              \
+    op_##name:                                                       \
+    {                                                                \
+        auto length = ::get<std::int32_t>(frame, src1);              \
+        if (length < 0 or static_cast<std::size_t>(length) > ::max_array_length) \
+        {                                                            \
+            fail("Array length " << length << " is out of range");   \
+        }                                                            \
+        ::set(frame, dest, this->allocate(nullptr, static_cast<std::size_t>(length)));         \
+    }                                                                \
+    next;
+//Copies the arguments named by the data words at pc into a fresh frame after the caller's and runs target there
+#define invoke(target, receiver)                                                                                                \
+    {                                                                                                                           \
+        auto &callee = *target.second;                                                                                          \
+        std::size_t first = receiver != nullptr;                                                                                \
+        if (callee.arg_types.size() < first)                                                                                    \
+        {                                                                                                                       \
+            fail("Method " << callee.name << " takes no receiver");                                                            \
+        }                                                                                                                       \
+        auto passed = callee.arg_types.size() - first;                                                                          \
+        auto data_words = (passed + ::lanes - 1) / ::lanes;                                                                     \
+        if (pc + data_words * stride > mtd.length)                                                                              \
+        {                                                                                                                       \
+            goto overrun;                                                                                                       \
+        }                                                                                                                       \
+        if (this->depth >= ::max_depth or ::native_stack_used(this->native_base) > ::native_stack_budget or this->stack.size() - this->stack_top < callee.stack_size + ::frame_headroom) \
+        {                                                                                                                       \
+            fail("Stack overflow");                                                                                             \
+        }                                                                                                                       \
+        auto callee_frame = this->stack.data() + this->stack_top;                                                               \
+        std::fill(callee_frame, callee_frame + callee.stack_size, 0);                                                           \
+        if (first)                                                                                                              \
+        {                                                                                                                       \
+            ::set(callee_frame, callee.arg_slots[0], receiver);                                                                 \
+        }                                                                                                                       \
+        for (std::size_t i = 0; i < passed; i++)                                                                                \
+        {                                                                                                                       \
+            auto slot = static_cast<std::uint16_t>(::data<compact>(mtd, pc, i / ::lanes) >> (i % ::lanes * 16));                \
+            std::copy_n(frame + slot, ::is_wide(callee.arg_types[first + i]) ? 2 : 1, callee_frame + callee.arg_slots[first + i]); \
+        }                                                                                                                       \
+        pc += data_words * stride;                                                                                              \
+        auto caller_top = this->stack_top;                                                                                      \
+        this->stack_top += callee.stack_size;                                                                                   \
+        auto result = this->call(*target.first, callee, callee_frame);                                                          \
+        this->stack_top = caller_top;                                                                                           \
+        if (this->pending)                                                                                                      \
+        {                                                                                                                       \
+            goto unwind;                                                                                                        \
+        }                                                                                                                       \
+        if (!this->errors.empty())                                                                                              \
+        {                                                                                                                       \
+            return 0;                                                                                                           \
+        }                                                                                                                       \
+        if (::is_wide(callee.return_type))                                                                                      \
+        {                                                                                                                       \
+            ::set<std::uint64_t>(frame, dest, result);                                                                          \
+        }                                                                                                                       \
+        else                                                                                                                    \
+        {                                                                                                                       \
+            ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(result));                                              \
+        }                                                                                                                       \
+    }                                                                                                                           \
+    next;
+//Rebuilds this method's frame as the callee's and returns, leaving call to run target on it in place of this method
+#define tail_invoke(target, receiver)                                                                                           \
+    {                                                                                                                           \
+        auto &callee = *target.second;                                                                                          \
+        std::size_t first = receiver != nullptr;                                                                                \
+        if (callee.arg_types.size() < first)                                                                                    \
+        {                                                                                                                       \
+            fail("Method " << callee.name << " takes no receiver");                                                            \
+        }                                                                                                                       \
+        auto passed = callee.arg_types.size() - first;                                                                          \
+        auto data_words = (passed + ::lanes - 1) / ::lanes;                                                                     \
+        if (pc + data_words * stride > mtd.length)                                                                              \
+        {                                                                                                                       \
+            goto overrun;                                                                                                       \
+        }                                                                                                                       \
+        auto base = static_cast<std::size_t>(frame - this->stack.data());                                                       \
+        if (this->stack.size() - base < callee.stack_size + ::frame_headroom)                                                   \
+        {                                                                                                                       \
+            fail("Stack overflow");                                                                                             \
+        }                                                                                                                       \
+        /*The callee's slots may overlap the arguments, so they are gathered before the frame is cleared*/                      \
+        this->tail_arguments.clear();                                                                                           \
+        for (std::size_t i = 0; i < passed; i++)                                                                                \
+        {                                                                                                                       \
+            auto slot = static_cast<std::uint16_t>(::data<compact>(mtd, pc, i / ::lanes) >> (i % ::lanes * 16));                \
+            this->tail_arguments.insert(this->tail_arguments.end(), frame + slot, frame + slot + (::is_wide(callee.arg_types[first + i]) ? 2 : 1)); \
+        }                                                                                                                       \
+        std::fill(frame, frame + callee.stack_size, 0);                                                                         \
+        if (first)                                                                                                              \
+        {                                                                                                                       \
+            ::set(frame, callee.arg_slots[0], receiver);                                                                        \
+        }                                                                                                                       \
+        for (std::size_t i = 0, copied = 0; i < passed; i++)                                                                    \
+        {                                                                                                                       \
+            std::size_t width = ::is_wide(callee.arg_types[first + i]) ? 2 : 1;                                                 \
+            std::copy_n(this->tail_arguments.data() + copied, width, frame + callee.arg_slots[first + i]);                      \
+            copied += width;                                                                                                    \
+        }                                                                                                                       \
+        this->stack_top = base + callee.stack_size;                                                                             \
+        this->tail_target = target;                                                                                             \
+        return 0;                                                                                                               \
+    }
+#define virtual_invoke(opcode, how)                                                         \
+    op_##opcode:                                                                            \
+    {                                                                                     \
+        load_object(receiver, src1);                                                      \
+        if (index24 >= cls.image.methods.size())                                          \
+        {                                                                                 \
+            fail("Method row " << index24 << " is out of range");                         \
+        }                                                                                 \
+        if (!receiver->cls)                                                               \
+        {                                                                                 \
+            fail("Arrays have no methods");                                               \
+        }                                                                                 \
+        auto target = this->dispatch(*receiver->cls, cls.image.methods[index24].name);   \
+        if (!target.second)                                                               \
+        {                                                                                 \
+            return 0;                                                                     \
+        }                                                                                 \
+        how(target, receiver);                                                            \
+    }
+#define static_invoke(opcode, how)                      \
+    op_##opcode:                                        \
+    {                                                   \
+        auto target = this->method_at(cls, index32);    \
+        if (!target.second)                             \
+        {                                               \
+            return 0;                                   \
+        }                                               \
+        object *receiver = nullptr;                     \
+        how(target, receiver);                          \
+    }
+#define direct_invoke(opcode, how)                      \
+    op_##opcode:                                        \
+    {                                                   \
+        load_object(receiver, src1);                    \
+        auto target = this->method_at(cls, index24);    \
+        if (!target.second)                             \
+        {                                               \
+            return 0;                                   \
+        }                                               \
+        how(target, receiver);                          \
+    }
+
+    next;
+
+    op_NOP:
+    next;
+    binary(IADD, std::uint32_t, +);
+    binary(LADD, std::uint64_t, +);
+    binary(FADD, float, +);
+    binary(DADD, double, +);
+    binary(ISUB, std::uint32_t, -);
+    binary(LSUB, std::uint64_t, -);
+    binary(FSUB, float, -);
+    binary(DSUB, double, -);
+    binary(IMUL, std::uint32_t, *);
+    binary(LMUL, std::uint64_t, *);
+    binary(FMUL, float, *);
+    binary(DMUL, double, *);
+    division(IDIV, std::int32_t, ::divide);
+    division(LDIV, std::int64_t, ::divide);
+    binary(FDIV, float, /);
+    binary(DDIV, double, /);
+    division(IMOD, std::int32_t, ::remainder);
+    division(LMOD, std::int64_t, ::remainder);
+    division(IDIVU, std::uint32_t, std::divides<std::uint32_t>{});
+    division(LDIVU, std::uint64_t, std::divides<std::uint64_t>{});
+    binary_immediate(IADDI, std::uint32_t, +);
+    binary_immediate(LADDI, std::uint64_t, +);
+    binary_immediate_then(IADDI_IBLT, std::uint32_t, +, chain(IBLT));
+    binary_immediate_then(IADDI_IBLE, std::uint32_t, +, chain(IBLE));
+    binary_immediate_then(IADDI_IBNEQ, std::uint32_t, +, chain(IBNEQ));
+    binary_immediate_then(LADDI_LBLT, std::uint64_t, +, chain(LBLT));
+    binary_immediate(FADDI, float, +);
+    binary_immediate(DADDI, double, +);
+    binary_immediate(ISUBI, std::uint32_t, -);
+    binary_immediate(LSUBI, std::uint64_t, -);
+    binary_immediate(FSUBI, float, -);
+    binary_immediate(DSUBI, double, -);
+    binary_immediate(IMULI, std::uint32_t, *);
+    binary_immediate(LMULI, std::uint64_t, *);
+    binary_immediate(FMULI, float, *);
+    binary_immediate(DMULI, double, *);
+    division_immediate(IDIVI, std::int32_t, ::divide);
+    division_immediate(LDIVI, std::int64_t, ::divide);
+    binary_immediate(FDIVI, float, /);
+    binary_immediate(DDIVI, double, /);
+    division_immediate(IMODI, std::int32_t, ::remainder);
+    division_immediate(LMODI, std::int64_t, ::remainder);
+    division_immediate(IDIVUI, std::uint32_t, std::divides<std::uint32_t>{});
+    division_immediate(LDIVUI, std::uint64_t, std::divides<std::uint64_t>{});
+    op_INEG:
+    ::set<std::uint32_t>(frame, dest, 0 - ::get<std::uint32_t>(frame, src1));
+    next;
+    op_LNEG:
+    ::set<std::uint64_t>(frame, dest, 0 - ::get<std::uint64_t>(frame, src1));
+    next;
+    op_FNEG:
+    ::set<float>(frame, dest, -::get<float>(frame, src1));
+    next;
+    op_DNEG:
+    ::set<double>(frame, dest, -::get<double>(frame, src1));
+    next;
+    op_LUI:
+    ::set<std::uint64_t>(frame, dest, (word >> 16 & 0xffffffffff) << 24);
+    next;
+    op_LDI:
+    ::set<std::uint32_t>(frame, dest, index32);
+    next;
+    op_LNL:
+    ::set<std::uint64_t>(frame, dest, 0);
+    next;
+    cast(ICSTL, std::uint32_t, std::uint64_t, static_cast<std::uint32_t>);
+    cast(ICSTF, std::int32_t, float, (::saturate<std::int32_t, float>));
+    cast(ICSTD, std::int32_t, double, (::saturate<std::int32_t, double>));
+    cast(LCSTI, std::int64_t, std::int32_t, static_cast<std::int64_t>);
+    cast(LCSTF, std::int64_t, float, (::saturate<std::int64_t, float>));
+    cast(LCSTD, std::int64_t, double, (::saturate<std::int64_t, double>));
+    cast(FCSTI, float, std::int32_t, static_cast<float>);
+    cast(FCSTL, float, std::int64_t, static_cast<float>);
+    cast(FCSTD, float, double, static_cast<float>);
+    cast(DCSTI, double, std::int32_t, static_cast<double>);
+    cast(DCSTL, double, std::int64_t, static_cast<double>);
+    cast(DCSTF, double, float, static_cast<double>);
+    binary(IAND, std::uint32_t, &);
+    binary(LAND, std::uint64_t, &);
+    binary(IOR, std::uint32_t, |);
+    binary(LOR, std::uint64_t, |);
+    binary(IXOR, std::uint32_t, ^);
+    binary(LXOR, std::uint64_t, ^);
+    shift(ISLL, std::uint32_t, <<, 31);
+    shift(LSLL, std::uint64_t, <<, 63);
+    shift(ISRL, std::uint32_t, >>, 31);
+    shift(LSRL, std::uint64_t, >>, 63);
+    shift(ISRA, std::int32_t, >>, 31);
+    shift(LSRA, std::int64_t, >>, 63);
+    binary_immediate(IANDI, std::uint32_t, &);
+    binary_immediate(LANDI, std::uint64_t, &);
+    binary_immediate(IORI, std::uint32_t, |);
+    binary_immediate(LORI, std::uint64_t, |);
+    binary_immediate(IXORI, std::uint32_t, ^);
+    binary_immediate(LXORI, std::uint64_t, ^);
+    shift_immediate(ISLLI, std::uint32_t, <<, 31);
+    shift_immediate(LSLLI, std::uint64_t, <<, 63);
+    shift_immediate(ISRLI, std::uint32_t, >>, 31);
+    shift_immediate(LSRLI, std::uint64_t, >>, 63);
+    shift_immediate(ISRAI, std::int32_t, >>, 31);
+    shift_immediate(LSRAI, std::int64_t, >>, 63);
+    branch(IBGE, std::int32_t, >=);
+    branch(LBGE, std::int64_t, >=);
+    branch(FBGE, float, >=);
+    branch(DBGE, double, >=);
+    branch(IBLT, std::int32_t, <);
+    branch(LBLT, std::int64_t, <);
+    branch(FBLT, float, <);
+    branch(DBLT, double, <);
+    branch(IBLE, std::int32_t, <=);
+    branch(LBLE, std::int64_t, <=);
+    branch(FBLE, float, <=);
+    branch(DBLE, double, <=);
+    branch(IBGT, std::int32_t, >);
+    branch(LBGT, std::int64_t, >);
+    branch(FBGT, float, >);
+    branch(DBGT, double, >);
+    branch(IBEQ, std::int32_t, ==);
+    branch(LBEQ, std::int64_t, ==);
+    branch(FBEQ, float, ==);
+    branch(DBEQ, double, ==);
+    branch(VBEQ, std::uint64_t, ==);
+    branch(IBNEQ, std::int32_t, !=);
+    branch(LBNEQ, std::int64_t, !=);
+    branch(FBNEQ, float, !=);
+    branch(DBNEQ, double, !=);
+    branch(VBNEQ, std::uint64_t, !=);
+    branch_immediate(IBGEI, std::int32_t, >=);
+    branch_immediate(LBGEI, std::int64_t, >=);
+    branch_immediate(FBGEI, float, >=);
+    branch_immediate(DBGEI, double, >=);
+    branch_immediate(IBLTI, std::int32_t, <);
+    branch_immediate(LBLTI, std::int64_t, <);
+    branch_immediate(FBLTI, float, <);
+    branch_immediate(DBLTI, double, <);
+    branch_immediate(IBLEI, std::int32_t, <=);
+    branch_immediate(LBLEI, std::int64_t, <=);
+    branch_immediate(FBLEI, float, <=);
+    branch_immediate(DBLEI, double, <=);
+    branch_immediate(IBGTI, std::int32_t, >);
+    branch_immediate(LBGTI, std::int64_t, >);
+    branch_immediate(FBGTI, float, >);
+    branch_immediate(DBGTI, double, >);
+    branch_immediate(IBEQI, std::int32_t, ==);
+    branch_immediate(LBEQI, std::int64_t, ==);
+    branch_immediate(FBEQI, float, ==);
+    branch_immediate(DBEQI, double, ==);
+    branch_immediate(VBEQI, std::uint64_t, ==);
+    branch_immediate(IBNEQI, std::int32_t, !=);
+    branch_immediate(LBNEQI, std::int64_t, !=);
+    branch_immediate(FBNEQI, float, !=);
+    branch_immediate(DBNEQI, double, !=);
+    branch_immediate(VBNEQI, std::uint64_t, !=);
+    op_BADR:
+    {
+        std::size_t entries = dest;
+        bool sparse = flags & sparse_table;
+        auto table = 1 + (sparse ? entries : (entries + 1) / 2);
+        if (pc + table * stride > mtd.length)
+        {
+            goto overrun;
+        }
+        auto key = ::get<std::int32_t>(frame, src1);
+        auto head = ::data<compact>(mtd, pc, 0);
+        auto offset = static_cast<std::int32_t>(head);
+        if (sparse)
+        {
+            std::size_t low = 0, high = entries;
+            while (low < high)
+            {
+                auto middle = (low + high) / 2;
+                auto entry = ::data<compact>(mtd, pc, 1 + middle);
+                auto entry_key = static_cast<std::int32_t>(entry >> 32);
+                if (entry_key == key)
+                {
+                    offset = static_cast<std::int32_t>(entry);
+                    break;
+                }
+                if (entry_key < key)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+        }
+        else if (auto k = static_cast<std::int64_t>(key) - static_cast<std::int32_t>(head >> 32); k >= 0 and static_cast<std::size_t>(k) < entries)
+        {
+            offset = static_cast<std::int32_t>(::data<compact>(mtd, pc, 1 + k / 2) >> (k % 2 * 32));
+        }
+        //Offsets count from the BADR itself; one leaving the body fails at the next fetch
+        pc = static_cast<std::size_t>(static_cast<std::int64_t>(at) + offset);
+    }
+    next;
+    op_BU:
+    pc = ::jump(word, pc);
+    next;
+    field(CVLLD, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint16_t>(value)));
+    field(SVLLD, src1, ::set<std::int32_t>(frame, dest, static_cast<std::int16_t>(value)));
+    int_field(IVLLD, next);
+    field(LVLLD, src1, ::set<std::uint64_t>(frame, dest, value));
+    field(FVLLD, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)));
+    field(DVLLD, src1, ::set<std::uint64_t>(frame, dest, value));
+    field(VVLLD, src1, ::set<std::uint64_t>(frame, dest, value));
+    int_field(IVLLD_IBEQI, chain(IBEQI));
+    int_field(IVLLD_IBNEQI, chain(IBNEQI));
+    int_field(IVLLD_IBLT, chain(IBLT));
+    int_field(IVLLD_IBGE, chain(IBGE));
+    field_then(VVLLD_VBEQI, src1, ::set<std::uint64_t>(frame, dest, value), chain(VBEQI));
+    field_then(VVLLD_VBNEQI, src1, ::set<std::uint64_t>(frame, dest, value), chain(VBNEQI));
+    field(CVLSR, dest, value = ::get<std::uint32_t>(frame, src1) & 0xffff);
+    field(SVLSR, dest, value = ::get<std::uint32_t>(frame, src1) & 0xffff);
+    field(IVLSR, dest, value = ::get<std::uint32_t>(frame, src1));
+    field(LVLSR, dest, value = ::get<std::uint64_t>(frame, src1));
+    field(FVLSR, dest, value = ::get<std::uint32_t>(frame, src1));
+    field(DVLSR, dest, value = ::get<std::uint64_t>(frame, src1));
+    field(VVLSR, dest, value = ::get<std::uint64_t>(frame, src1));
+    element(CALD, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint16_t>(value)));
+    element(SALD, src1, ::set<std::int32_t>(frame, dest, static_cast<std::int16_t>(value)));
+    element(IALD, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)));
+    element(LALD, src1, ::set<std::uint64_t>(frame, dest, value));
+    element(FALD, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)));
+    element(DALD, src1, ::set<std::uint64_t>(frame, dest, value));
+    element(VALD, src1, ::set<std::uint64_t>(frame, dest, value));
+    element_then(IALD_IADD, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)), chain(IADD));
+    element_then(IALD_ISUB, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)), chain(ISUB));
+    element_then(IALD_IMUL, src1, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)), chain(IMUL));
+    element_then(DALD_DADD, src1, ::set<std::uint64_t>(frame, dest, value), chain(DADD));
+    element_then(DALD_DMUL, src1, ::set<std::uint64_t>(frame, dest, value), chain(DMUL));
+    element(CASR, dest, value = ::get<std::uint32_t>(frame, src1) & 0xffff);
+    element(SASR, dest, value = ::get<std::uint32_t>(frame, src1) & 0xffff);
+    element(IASR, dest, value = ::get<std::uint32_t>(frame, src1));
+    element(LASR, dest, value = ::get<std::uint64_t>(frame, src1));
+    element(FASR, dest, value = ::get<std::uint32_t>(frame, src1));
+    element(DASR, dest, value = ::get<std::uint64_t>(frame, src1));
+    element(VASR, dest, value = ::get<std::uint64_t>(frame, src1));
+    static_variable(CSTLD, ::set<std::uint32_t>(frame, dest, static_cast<std::uint16_t>(value)));
+    static_variable(SSTLD, ::set<std::int32_t>(frame, dest, static_cast<std::int16_t>(value)));
+    static_variable(ISTLD, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)));
+    static_variable(LSTLD, ::set<std::uint64_t>(frame, dest, value));
+    static_variable(FSTLD, ::set<std::uint32_t>(frame, dest, static_cast<std::uint32_t>(value)));
+    static_variable(DSTLD, ::set<std::uint64_t>(frame, dest, value));
+    static_variable(VSTLD, ::set<std::uint64_t>(frame, dest, value));
+    static_variable(CSTSR, value = ::get<std::uint32_t>(frame, dest) & 0xffff);
+    static_variable(SSTSR, value = ::get<std::uint32_t>(frame, dest) & 0xffff);
+    static_variable(ISTSR, value = ::get<std::uint32_t>(frame, dest));
+    static_variable(LSTSR, value = ::get<std::uint64_t>(frame, dest));
+    static_variable(FSTSR, value = ::get<std::uint32_t>(frame, dest));
+    static_variable(DSTSR, value = ::get<std::uint64_t>(frame, dest));
+    static_variable(VSTSR, value = ::get<std::uint64_t>(frame, dest));
+    op_VNEW:
+    {
+        auto target = this->class_at(cls, index24);
+        if (!target)
+        {
+            return 0;
+        }
+        ::set(frame, dest, this->allocate(target, target->fields.size()));
+    }
+    next;
+    op_VNEWF:
+    {
+        //The object this word made last time in this frame is dead by now, so it is cleared and handed out again
+        auto target = this->class_at(cls, index24);
+        if (!target)
+        {
+            return 0;
+        }
+        auto &reused = this->frame_objects[{frame, &mtd, at}];
+        if (reused and reused->cls == target)
+        {
+            std::fill(reused->slots.begin(), reused->slots.end(), 0);
+        }
+        else
+        {
+            reused = this->allocate(target, target->fields.size());
+        }
+        ::set(frame, dest, reused);
+    }
+    next;
+    new_array(CANEW);
+    new_array(SANEW);
+    new_array(IANEW);
+    new_array(LANEW);
+    new_array(FANEW);
+    new_array(DANEW);
+    new_array(VANEW);
+    op_IOF:
+    {
+        if (index24 >= cls.image.classes.size())
+        {
+            fail("Class index " << index24 << " is out of range");
+        }
+        ::set<std::uint32_t>(frame, dest, this->is_instance(::get<object *>(frame, src1), cls.image.classes[index24]));
+    }
+    next;
+    virtual_invoke(VINV, invoke);
+    virtual_invoke(IINV, invoke);
+    static_invoke(SINV, invoke);
+    direct_invoke(DINV, invoke);
+    virtual_invoke(TVINV, tail_invoke);
+    virtual_invoke(TIINV, tail_invoke);
+    static_invoke(TSINV, tail_invoke);
+    direct_invoke(TDINV, tail_invoke);
+    op_IRET:
+    op_FRET:
+    return ::get<std::uint32_t>(frame, src1);
+    op_LRET:
+    op_DRET:
+    op_VRET:
+    return ::get<std::uint64_t>(frame, src1);
+    op_EXC:
+    {
+        load_object(thrown, src1);
+        this->pending = thrown;
+    }
+    goto unwind;
+    op_CNT:
+    if (index32 >= mtd.counts.size())
+    {
+        fail("Counter " << index32 << " is out of range");
+    }
+    mtd.counts[index32]++;
+    next;
+    op_LDC:
+    if (index32 >= cls.image.constants.size())
+    {
+        fail("Constant " << index32 << " is out of range");
+    }
+    ::set<std::uint64_t>(frame, dest, cls.image.constants[index32]);
+    next;
+
+malformed:
+    fail("Malformed instruction " << itype_to_string[std::min<unsigned>(word >> 56, static_cast<unsigned>(itype::__COUNT__) - 1)]);
+overrun:
+    fail("Ran past the end of the method");
+unwind:
+    //Handlers are listed innermost first
+    for (auto &handler : mtd.handlers)
+    {
+        if (at >= handler.begin and at < handler.end and handler.class_index < cls.image.classes.size() and this->is_instance(this->pending, cls.image.classes[handler.class_index]))
+        {
+            ::set(frame, handler.slot, this->pending);
+            this->pending = nullptr;
+            pc = handler.target;
+            next;
+        }
+    }
+    return 0;
+
+#undef direct_invoke
+#undef static_invoke
+#undef virtual_invoke
+#undef tail_invoke
+#undef invoke
+#undef new_array
+#undef static_variable
+#undef int_field
+#undef element
+#undef element_then
+#undef field
+#undef field_then
+#undef load_object
+#undef branch_immediate
+#undef branch
+#undef shift_immediate
+#undef shift
+#undef cast
+#undef division_immediate
+#undef division
+#undef binary_immediate
+#undef binary_immediate_then
+#undef chain
+#undef binary
+#undef fail
+#undef next
+#undef imm16
+#undef index32
+#undef index24
+#undef imm24
+#undef flags
+#undef src2
+#undef src1
+#undef dest
+}
+
+std::variant<std::string, std::vector<std::string>> oops_bcode_compiler::vm::machine::run(const std::string &class_name, const std::string &method_name, const std::vector<std::string> &args)
+{
+    auto fail = [this](std::string error) {
+        this->errors.push_back(error);
+        auto errors = std::move(this->errors);
+        this->errors.clear();
+        this->pending = nullptr;
+        return errors;
+    };
+    auto cls = this->find_class(class_name);
+    if (!cls)
+    {
+        return fail("Class " + class_name + " could not be loaded");
+    }
+    auto target = this->dispatch(*cls, method_name);
+    if (!target.second)
+    {
+        return fail("Method " + method_name + " could not be found");
+    }
+    auto &mtd = *target.second;
+    if (!mtd.is_static)
+    {
+        return fail("Method " + class_name + "." + method_name + " is not static");
+    }
+    if (args.size() != mtd.arg_types.size())
+    {
+        return fail("Method " + class_name + "." + method_name + " takes " + std::to_string(mtd.arg_types.size()) + " arguments, not " + std::to_string(args.size()));
+    }
+    if (this->stack.size() - this->stack_top < mtd.stack_size + ::frame_headroom)
+    {
+        return fail("Stack overflow");
+    }
+    auto frame = this->stack.data() + this->stack_top;
+    std::fill(frame, frame + mtd.stack_size, 0);
+    for (std::size_t i = 0; i < args.size(); i++)
+    {
+        std::istringstream in(args[i]);
+        bool parsed = false;
+        switch (mtd.arg_types[i])
+        {
+#define parse_arg(type_code, type)                               \
+    case type_code:                                              \
+    {                                                            \
+        type value;                                              \
+        if ((parsed = static_cast<bool>(in >> value) and in.eof())) \
+        {                                                        \
+            ::set(frame, mtd.arg_slots[i], value);               \
+        }                                                        \
+        break;                                                   \
+    }
+            parse_arg(2, std::int32_t);
+            parse_arg(3, std::int64_t);
+            parse_arg(4, float);
+            parse_arg(5, double);
+#undef parse_arg
+        }
+        if (!parsed)
+        {
+            return fail("Argument " + std::to_string(i) + " '" + args[i] + "' does not match type " + std::to_string(mtd.arg_types[i]));
+        }
+    }
+    this->stack_top += mtd.stack_size;
+    char marker;
+    this->native_base = reinterpret_cast<std::uintptr_t>(&marker);
+    auto result = this->call(*target.first, mtd, frame);
+    this->stack_top -= mtd.stack_size;
+    if (this->pending)
+    {
+        return fail("Uncaught exception of class " + (this->pending->cls ? this->pending->cls->image.name : std::string("array")));
+    }
+    if (!this->errors.empty())
+    {
+        auto errors = std::move(this->errors);
+        this->errors.clear();
+        return errors;
+    }
+    std::stringstream out;
+    switch (mtd.return_type)
+    {
+    case 3:
+        out << static_cast<std::int64_t>(result);
+        break;
+    case 4:
+        out.precision(std::numeric_limits<float>::max_digits10);
+        out << utils::pun_reinterpret<float>(static_cast<std::uint32_t>(result));
+        break;
+    case 5:
+        out.precision(std::numeric_limits<double>::max_digits10);
+        out << utils::pun_reinterpret<double>(result);
+        break;
+    case 6:
+    {
+        auto obj = utils::pun_reinterpret<object *>(result);
+        if (!obj)
+        {
+            out << "null";
+        }
+        else if (obj->cls)
+        {
+            out << obj->cls->image.name << " object";
+        }
+        else
+        {
+            out << "array of length " << obj->slots.size();
+        }
+        break;
+    }
+    default:
+        out << static_cast<std::int32_t>(result);
+        break;
+    }
+    return out.str();
+}
+
+void oops_bcode_compiler::vm::machine::record_counters(profile::profile &prof) const
+{
+    for (auto &cls : this->classes)
+    {
+        for (auto &body : cls.second->image.bodies)
+        {
+            if (!body.counters.empty())
+            {
+                profile::record_counters(prof, cls.first + "." + body.name, body.counters, body.counts);
+            }
+        }
+    }
+}
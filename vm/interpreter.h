@@ -0,0 +1,111 @@
+#ifndef VM_INTERPRETER
+#define VM_INTERPRETER
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "loader.h"
+#include "../profile/profile.h"
+
+namespace oops_bcode_compiler
+{
+    namespace vm
+    {
+        struct runtime_class;
+
+        //Objects and arrays alike; an array has no class and one slot per element
+        struct object
+        {
+            runtime_class *cls;
+            std::vector<std::uint64_t> slots;
+        };
+
+        struct runtime_class
+        {
+            loaded_class image;
+            //Superclass first, then the interfaces
+            std::vector<runtime_class *> supertypes;
+            //Slot of every field by name, the superclass's included at the same slots
+            std::unordered_map<std::string, std::size_t> fields;
+            std::unordered_map<std::string, std::uint64_t> statics;
+            //Resolved on first use, by class index, method row and instance row
+            std::vector<runtime_class *> class_targets;
+            std::vector<std::pair<runtime_class *, method *>> method_targets;
+            std::vector<std::uint64_t *> static_targets;
+            std::vector<std::size_t> field_targets;
+            //Virtual dispatch by method name, filled as receivers of this class show up
+            std::unordered_map<std::string, std::pair<runtime_class *, method *>> vtable;
+        };
+
+        struct statistics
+        {
+            std::uint64_t invocations;
+            std::uint64_t allocations;
+            //Instructions run by opcode; a fused pair counts once as its fused opcode and once as its second word
+            std::array<std::uint64_t, 256> opcodes;
+
+            std::uint64_t instructions() const;
+        };
+
+        //Runs compiled classes straight from their mappings, loading each from the class path on first use.
+        //Objects live until the machine goes away, and a runtime error ends the whole run instead of throwing into the program.
+        //Bodies always run from their words or units: predecoded records and the native section are left unread.
+        class machine
+        {
+            std::string class_path;
+            std::unordered_map<std::string, std::unique_ptr<runtime_class>> classes;
+            std::vector<std::unique_ptr<object>> heap;
+            //What each VNEWF word last allocated, by frame, method and word; it never escapes, so it is dead when the word reruns
+            std::map<std::tuple<const std::int32_t *, const method *, std::size_t>, object *> frame_objects;
+            //Frames are carved from here in 32-bit slots
+            std::vector<std::int32_t> stack;
+            std::size_t stack_top;
+            std::size_t depth;
+            //Where run entered the interpreter on the native stack
+            std::uintptr_t native_base;
+            //Set by a tail invoke that has rebuilt the frame for its callee, which call then runs in place of the caller
+            std::pair<runtime_class *, method *> tail_target;
+            std::vector<std::int32_t> tail_arguments;
+            //Thrown by EXC and not caught yet
+            object *pending;
+            std::vector<std::string> errors;
+
+            runtime_class *find_class(const std::string &name);
+            runtime_class *class_at(runtime_class &from, std::uint32_t class_index);
+            std::pair<runtime_class *, method *> method_at(runtime_class &from, std::uint32_t row);
+            std::pair<runtime_class *, method *> dispatch(runtime_class &receiver, const std::string &name);
+            std::uint64_t *static_at(runtime_class &from, std::uint32_t row);
+            std::size_t field_at(runtime_class &from, std::uint32_t row);
+            bool is_instance(const object *obj, const std::string &class_name);
+            object *allocate(runtime_class *cls, std::size_t slots);
+
+            std::uint64_t call(runtime_class &cls, method &mtd, std::int32_t *frame);
+
+            template <bool compact>
+            std::uint64_t execute(runtime_class &cls, method &mtd, std::int32_t *frame);
+
+        public:
+            statistics stats;
+
+            machine(std::string class_path, std::size_t stack_slots);
+
+            ~machine();
+
+            //Runs class_name.method_name with args parsed by the method's argument types and returns its result as text
+            std::variant<std::string, std::vector<std::string>> run(const std::string &class_name, const std::string &method_name, const std::vector<std::string> &args);
+
+            //Adds what the CNT words of every instrumented method loaded so far counted to prof
+            void record_counters(profile::profile &prof) const;
+        };
+    } // namespace vm
+} // namespace oops_bcode_compiler
+
+#endif /* VM_INTERPRETER */
@@ -0,0 +1,126 @@
+#include "loader.h"
+
+#include <sstream>
+
+#include "../reader/reader.h"
+#include "../debug/logs.h"
+
+using namespace oops_bcode_compiler::vm;
+using namespace oops_bcode_compiler::debug;
+
+namespace
+{
+    std::vector<oops_bcode_compiler::vm::import> read_imports(const oops_bcode_compiler::reader::symbol_table &table)
+    {
+        std::vector<oops_bcode_compiler::vm::import> out;
+        for (std::uint32_t i = 0; i < table.size(); i++)
+        {
+            auto row = table.row(i);
+            out.push_back({row ? row->class_index : 0, row ? std::string(row->name) : std::string()});
+        }
+        return out;
+    }
+
+    //Fills in what the interpreter needs of mtd, or returns false if its arguments overflow its frame
+    bool read_method(const oops_bcode_compiler::reader::method_view &view, oops_bcode_compiler::vm::method &mtd)
+    {
+        mtd.return_type = view.return_type();
+        mtd.is_static = view.is_static();
+        mtd.aligned_frame = view.aligned_frame();
+        mtd.compact = view.compact();
+        mtd.length = view.length();
+        mtd.stack_size = view.stack_size();
+        std::uint16_t slot = 0;
+        for (std::uint16_t i = 0; i < view.argument_count(); i++)
+        {
+            auto type = *view.argument_type(i);
+            bool wide = type == 3 or type == 5 or type == 6;
+            //Same layout as the compiler's, which pads an aligned frame before every 8-byte argument at an odd slot
+            if (mtd.aligned_frame and wide and slot % 2)
+            {
+                slot++;
+            }
+            mtd.arg_types.push_back(type);
+            mtd.arg_slots.push_back(slot);
+            slot += wide ? 2 : 1;
+        }
+        if (slot > mtd.stack_size)
+        {
+            return false;
+        }
+        //The mapping is page aligned and bodies start on whole words, so the code is read in place
+        auto code = view.code().data();
+        mtd.words = mtd.compact ? nullptr : reinterpret_cast<const std::uint64_t *>(code);
+        mtd.units = mtd.compact ? reinterpret_cast<const std::uint32_t *>(code) : nullptr;
+        for (std::uint64_t i = 0; i < view.counter_count(); i++)
+        {
+            auto counter = *view.counter(i);
+            mtd.counters.push_back({static_cast<oops_bcode_compiler::profile::counter_kind>(counter.kind), counter.source_index});
+        }
+        mtd.counts.resize(mtd.counters.size());
+        for (std::uint64_t i = 0; i < view.handler_count(); i++)
+        {
+            auto handler = *view.exception_handler(i);
+            mtd.handlers.push_back({handler.begin, handler.end, handler.target, handler.slot, handler.class_index});
+        }
+        return true;
+    }
+} // namespace
+
+std::variant<loaded_class, std::vector<std::string>> oops_bcode_compiler::vm::load(const std::string &name, const std::string &class_path)
+{
+    auto mapping = platform::open_compiled_class(name, class_path);
+    if (!mapping)
+    {
+        return std::vector<std::string>{"Unable to open compiled class " + name + " under " + class_path};
+    }
+    auto image = reader::image::open(mapping->mmapped_file, mapping->file_size);
+    if (!image)
+    {
+        platform::close_file_mapping(*mapping);
+        return std::vector<std::string>{"Compiled class " + name + " is truncated or malformed"};
+    }
+    loaded_class cls{name, *mapping, {}, 0, {}, {}, {}, {}, {}, {}};
+    auto classes = image->classes();
+    cls.supertype_count = classes.supertype_count();
+    cls.classes.resize(self_class);
+    for (std::uint32_t i = 0; i < classes.size(); i++)
+    {
+        cls.classes.push_back(std::string(classes.name(i + self_class).value_or("")));
+    }
+    cls.methods = ::read_imports(image->methods());
+    cls.statics = ::read_imports(image->statics());
+    cls.instances = ::read_imports(image->instances());
+    auto constants = image->constants();
+    for (std::uint32_t i = 0; i < constants.size(); i++)
+    {
+        cls.constants.push_back(*constants.at(i));
+    }
+    if (cls.classes.size() <= self_class or cls.classes[self_class] != name)
+    {
+        platform::close_file_mapping(*mapping);
+        return std::vector<std::string>{"Compiled class " + name + " is malformed"};
+    }
+    for (auto view : image->bytecode())
+    {
+        auto body_name = image->method_name(cls.bodies.size());
+        if (!body_name)
+        {
+            platform::close_file_mapping(*mapping);
+            return std::vector<std::string>{"Compiled class " + name + " has more bodies than methods"};
+        }
+        method mtd{};
+        mtd.name = *body_name;
+        if (!::read_method(view, mtd))
+        {
+            std::stringstream error_builder;
+            error_builder << "Method " << mtd.name << " of " << name << " has more arguments than its frame holds";
+            platform::close_file_mapping(*mapping);
+            return std::vector<std::string>{error_builder.str()};
+        }
+        cls.body_indexes[mtd.name] = cls.bodies.size();
+        cls.bodies.push_back(std::move(mtd));
+    }
+    logger.builder(logging::level::debug) << "Loaded " << name << " with " << cls.bodies.size() << " methods" << logging::logbuilder::end;
+    return cls;
+}
@@ -0,0 +1,78 @@
+#ifndef VM_LOADER
+#define VM_LOADER
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "../platform_specific/files.h"
+#include "../reader/reader.h"
+#include "../profile/profile.h"
+
+namespace oops_bcode_compiler
+{
+    namespace vm
+    {
+        using reader::self_class;
+
+        //A (class index, name) row of the method, static or instance import table
+        struct import
+        {
+            std::uint32_t class_index;
+            std::string name;
+        };
+
+        struct handler
+        {
+            std::uint16_t begin;
+            std::uint16_t end;
+            std::uint16_t target;
+            std::uint16_t slot;
+            std::uint32_t class_index;
+        };
+
+        struct method
+        {
+            std::string name;
+            std::uint8_t return_type;
+            bool is_static;
+            bool aligned_frame;
+            bool compact;
+            std::uint16_t stack_size;
+            std::vector<std::uint8_t> arg_types;
+            //The frame slot each argument starts at
+            std::vector<std::uint16_t> arg_slots;
+            //Into the mapping; units is set instead of words for a compact body
+            const std::uint64_t *words;
+            const std::uint32_t *units;
+            std::uint16_t length;
+            std::vector<handler> handlers;
+            std::vector<profile::counter> counters;
+            //What CNT counted so far
+            std::vector<std::uint64_t> counts;
+        };
+
+        struct loaded_class
+        {
+            std::string name;
+            platform::file_mapping mapping;
+            //Class names by class index, empty for the primitives
+            std::vector<std::string> classes;
+            std::uint32_t supertype_count;
+            std::vector<import> methods;
+            std::vector<import> statics;
+            std::vector<import> instances;
+            std::vector<std::uint64_t> constants;
+            std::vector<method> bodies;
+            std::unordered_map<std::string, std::size_t> body_indexes;
+        };
+
+        //Maps name from class_path and copies out its tables, naming each method body as reader::image::method_name does.
+        //The code itself stays in the mapping.
+        std::variant<loaded_class, std::vector<std::string>> load(const std::string &name, const std::string &class_path);
+    } // namespace vm
+} // namespace oops_bcode_compiler
+
+#endif /* VM_LOADER */
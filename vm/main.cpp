@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../debug/logs.h"
+#include "../instructions/bytecode.h"
+#include "../platform_specific/files.h"
+#include "../profile/profile.h"
+#include "interpreter.h"
+
+using namespace oops_bcode_compiler;
+
+namespace
+{
+    constexpr std::size_t stack_slots = std::size_t{1} << 20;
+
+    struct run_request
+    {
+        std::string class_name;
+        std::string method_name;
+        std::vector<std::string> args;
+    };
+
+    //Splits Class.method at its last dot
+    std::optional<::run_request> parse_target(const std::string &target, std::vector<std::string> args)
+    {
+        auto dot = target.rfind('.');
+        if (dot == std::string::npos or dot == 0 or dot + 1 == target.size())
+        {
+            return {};
+        }
+        return ::run_request{target.substr(0, dot), target.substr(dot + 1), std::move(args)};
+    }
+
+    //Reads a whole argument as a count, or nothing if any of it is not a digit or it does not fit
+    std::optional<std::size_t> parse_count(std::string_view text)
+    {
+        std::size_t value;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (text.empty() or error != std::errc() or end != text.data() + text.size())
+        {
+            return {};
+        }
+        return value;
+    }
+
+    void report_errors(const std::vector<std::string> &errors)
+    {
+        for (auto &error : errors)
+        {
+            debug::logger.builder(debug::logging::level::error) << error << debug::logging::logbuilder::end;
+        }
+    }
+
+    std::vector<std::string> save_counters(const vm::machine &machine, const std::string &output)
+    {
+        profile::profile prof;
+        machine.record_counters(prof);
+        return profile::save(prof, output);
+    }
+} // namespace
+
+int run_once(const std::string &class_path, const ::run_request &request, const char *profile_out)
+{
+    vm::machine machine(class_path, ::stack_slots);
+    auto result = machine.run(request.class_name, request.method_name, request.args);
+    if (std::holds_alternative<std::vector<std::string>>(result))
+    {
+        auto &errors = std::get<std::vector<std::string>>(result);
+        ::report_errors(errors);
+        return errors.size();
+    }
+    std::cout << std::get<std::string>(result) << std::endl;
+    if (profile_out)
+    {
+        auto errors = ::save_counters(machine, profile_out);
+        ::report_errors(errors);
+        return errors.size();
+    }
+    return 0;
+}
+
+//Runs every Class.method line of the corpus repeat times in a fresh machine and reports its speed and opcode mix.
+//Lines hold the method, then its arguments, separated by spaces; '#' starts a comment.
+int run_benchmark(const std::string &class_path, const std::string &corpus, std::size_t repeat, const char *profile_out)
+{
+    std::ifstream in(corpus);
+    if (!in)
+    {
+        debug::logger.builder(debug::logging::level::error) << "Benchmark corpus '" << corpus << "' could not be opened!" << debug::logging::logbuilder::end;
+        return 1;
+    }
+    std::vector<::run_request> requests;
+    std::string line;
+    for (std::size_t line_number = 1; std::getline(in, line); line_number++)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string target, arg;
+        if (!(tokens >> target))
+        {
+            continue;
+        }
+        std::vector<std::string> args;
+        while (tokens >> arg)
+        {
+            args.push_back(arg);
+        }
+        auto request = ::parse_target(target, std::move(args));
+        if (!request)
+        {
+            debug::logger.builder(debug::logging::level::error) << "Expected Class.method at line " << line_number << " of " << corpus << debug::logging::logbuilder::end;
+            return 1;
+        }
+        requests.push_back(std::move(*request));
+    }
+    vm::statistics total{};
+    double total_seconds = 0;
+    profile::profile counters;
+    for (auto &request : requests)
+    {
+        vm::machine machine(class_path, ::stack_slots);
+        std::string result;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < repeat; i++)
+        {
+            auto ran = machine.run(request.class_name, request.method_name, request.args);
+            if (std::holds_alternative<std::vector<std::string>>(ran))
+            {
+                auto &errors = std::get<std::vector<std::string>>(ran);
+                ::report_errors(errors);
+                return errors.size();
+            }
+            result = std::move(std::get<std::string>(ran));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        auto instructions = machine.stats.instructions();
+        debug::logger.builder(debug::logging::level::info) << request.class_name << "." << request.method_name << " = " << result << ": " << instructions << " instructions, " << machine.stats.invocations << " invocations, " << machine.stats.allocations << " allocations in " << seconds << "s, " << (seconds > 0 ? instructions / seconds / 1e6 : 0) << " M instructions/s" << debug::logging::logbuilder::end;
+        total_seconds += seconds;
+        total.invocations += machine.stats.invocations;
+        total.allocations += machine.stats.allocations;
+        for (std::size_t i = 0; i < total.opcodes.size(); i++)
+        {
+            total.opcodes[i] += machine.stats.opcodes[i];
+        }
+        if (profile_out)
+        {
+            machine.record_counters(counters);
+        }
+    }
+    auto instructions = total.instructions();
+    debug::logger.builder(debug::logging::level::info) << "Total: " << instructions << " instructions in " << total_seconds << "s, " << (total_seconds > 0 ? instructions / total_seconds / 1e6 : 0) << " M instructions/s" << debug::logging::logbuilder::end;
+    std::vector<std::pair<std::uint64_t, std::size_t>> mix;
+    for (std::size_t i = 0; i < total.opcodes.size(); i++)
+    {
+        if (total.opcodes[i])
+        {
+            mix.emplace_back(total.opcodes[i], i);
+        }
+    }
+    std::sort(mix.rbegin(), mix.rend());
+    for (auto &entry : mix)
+    {
+        auto name = entry.second < bytecode::itype_to_string.size() ? bytecode::itype_to_string[entry.second] : "UNKNOWN";
+        debug::logger.builder(debug::logging::level::info) << "Opcode " << name << " " << entry.first << " " << 100.0 * entry.first / instructions << "%" << debug::logging::logbuilder::end;
+    }
+    if (profile_out)
+    {
+        auto errors = profile::save(counters, profile_out);
+        ::report_errors(errors);
+        return errors.size();
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const int arg_count = argc;
+    std::unordered_map<std::string, int> args;
+    //--run takes the rest of the command line, so its arguments may look like flags
+    int run_at = arg_count;
+    for (int i = 1; i < arg_count; i++)
+    {
+        if (std::string(argv[i]) == "--run")
+        {
+            run_at = i;
+            break;
+        }
+        args[argv[i]] = i;
+    }
+    auto level = args.find("--log-level");
+    if (level == args.end() || level->second + 1 >= run_at)
+    {
+        debug::logger.set_level(debug::logging::level::warning);
+    }
+    else
+    {
+        static const std::vector<std::string> levels = {"debug", "info", "warning", "error"};
+        if (auto lvl = std::find(levels.begin(), levels.end(), argv[level->second + 1]); lvl != levels.end())
+        {
+            debug::logger.set_level(static_cast<debug::logging::level>(lvl - levels.begin()));
+        }
+        else
+        {
+            debug::logger.set_level(debug::logging::level::warning);
+        }
+    }
+    std::string class_path;
+    auto path = args.find("--class-path");
+    if (path == args.end())
+    {
+        path = args.find("-cp");
+    }
+    if (path == args.end() or path->second + 1 >= run_at)
+    {
+        class_path = platform::get_working_path();
+    }
+    else
+    {
+        class_path = argv[path->second + 1];
+    }
+    const char *profile_out = nullptr;
+    if (auto out = args.find("--profile-out"); out != args.end())
+    {
+        if (out->second + 1 >= run_at)
+        {
+            debug::logger.builder(debug::logging::level::error) << "No profile output argument provided!" << debug::logging::logbuilder::end;
+            return 1;
+        }
+        profile_out = argv[out->second + 1];
+    }
+    if (auto bench = args.find("--bench"); bench != args.end())
+    {
+        if (bench->second + 1 >= run_at)
+        {
+            debug::logger.builder(debug::logging::level::error) << "No benchmark corpus argument provided!" << debug::logging::logbuilder::end;
+            return 1;
+        }
+        std::size_t repeat = 1;
+        if (auto repeats = args.find("--repeat"); repeats != args.end() and repeats->second + 1 < run_at)
+        {
+            auto parsed = ::parse_count(argv[repeats->second + 1]);
+            if (!parsed)
+            {
+                debug::logger.builder(debug::logging::level::error) << "Invalid repeat count '" << argv[repeats->second + 1] << "'!" << debug::logging::logbuilder::end;
+                return 1;
+            }
+            repeat = std::max<std::size_t>(*parsed, 1);
+        }
+        if (level == args.end())
+        {
+            debug::logger.set_level(debug::logging::level::info);
+        }
+        return run_benchmark(class_path, argv[bench->second + 1], repeat, profile_out);
+    }
+    if (run_at + 1 >= arg_count)
+    {
+        debug::logger.builder(debug::logging::level::error) << "No --run Class.method argument provided!" << debug::logging::logbuilder::end;
+        return 1;
+    }
+    auto request = ::parse_target(argv[run_at + 1], std::vector<std::string>(argv + run_at + 2, argv + arg_count));
+    if (!request)
+    {
+        debug::logger.builder(debug::logging::level::error) << "Expected Class.method after --run, not " << argv[run_at + 1] << debug::logging::logbuilder::end;
+        return 1;
+    }
+    return run_once(class_path, *request, profile_out);
+}